@@ -3,6 +3,20 @@ points =0
 local Object = {}
 Object.__index = Object
 
+-- a ufo from the left or the right, half of the ticks spawn nothing
+local function spawnUfo()
+    local state = randi(0,3)
+
+    if (state==0) then
+        local ovni = scene.instantiate("ufo", -20, randi(0,WindowWidth), state)
+        ovni:setState("Prefab",true)
+    elseif (state==1) then
+        local ovni = scene.instantiate("ufo", WindowWidth+20, randi(0,WindowHeight), state)
+        ovni:setState("Prefab",true)
+
+    end
+end
+
 function Object:OnReady()
     
     assets.loadGraph("nave", "assets/playerShip1_orange.png")
@@ -14,6 +28,16 @@ function Object:OnReady()
     assets.loadGraph("explosion", "assets/exp2.png")
     assets.loadGraph("bg", "assets/FloorTexture.png")
 
+    -- killed bullets and explosions are reused instead of rebuilt
+    scene.setPool("bullet", 64)
+    scene.setPool("explosion", 16)
+
+    -- set up once outside the scene, every ufo is a native copy of it
+    local ufo = scene.createGameObject("ufo", 0, 0, 0, 0, false)
+    ufo:addComponent("Sprite","ufo")
+    ufo:addScript("assets/scripts/shooter/ovni.lua")
+    scene.registerPrefab("ufo", ufo)
+
 
     local p = scene.createGameObject("Player",1)
     p:setPosition(400,200)
@@ -35,32 +59,14 @@ function Object:OnReady()
     scene.setState("Collisions",false)
     scene.setState("Stats",false)
 
-
-    
-end
+    -- stops with the scene when it is paused, cancelled when this object goes
+    timer.every(self, 0.3, spawnUfo)
 
 
-function Object:update(dt)
-    
-    if (randi(0,200) <= 5) then
-        local state = randi(0,3)
-
-        if (state==0) then
-           local ovni = scene.createGameObject("ufo",state, -20, randi(0,WindowWidth))
-            ovni:addComponent("Sprite","ufo")
-            ovni:addScript("assets/scripts/shooter/ovni.lua")
-            ovni:setState("Prefab",true)
-        elseif (state==1) then
-            local ovni = scene.createGameObject("ufo",state,WindowWidth+20,randi(0,WindowHeight))
-            ovni:addComponent("Sprite","ufo")
-            ovni:addScript("assets/scripts/shooter/ovni.lua")
-            ovni:setState("Prefab",true)
-
-        end
-    end
     
 end
 
+
 function Object:render()
     canvas.drawGraphTiled("bg", 0,0,WindowWidth,WindowHeight, 0,0,112,128,0,0,0,1.0)
     canvas.drawText("SCORE: "..points,WindowWidth/2-70,20,22)
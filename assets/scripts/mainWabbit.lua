@@ -7,6 +7,9 @@ Object.__index = Object
 
 function Object:OnReady()
     
+    -- wabbits are isolated, their update runs on these
+    workers.start()
+
    -- for i=1, 5000 do
         local layer =math.floor(math.random()*6)
         local bullet = scene.createGameObject("wabbit",layer)
@@ -18,8 +21,44 @@ function Object:OnReady()
 end
 
 
+-- main state plus the worker states, where the isolated wabbits keep their tables
+local function heapKB()
+    collectgarbage("collect")
+    workers.collect()
+    local kb = collectgarbage("count")
+    for i, worker in ipairs(workers.stats()) do
+        kb = kb + worker.kb
+    end
+    return kb
+end
+
+-- press B: spawn a batch and report the lua heap cost of each wabbit
+local function measure(count)
+    local before = heapKB()
+    for i=1, count do
+        local layer =math.floor(math.random()*8)
+        local bullet = scene.createGameObject("wabbit",layer)
+        bullet:addSprite("wabbit")
+        bullet:addScript("assets/scripts/wabbit/wabbit.lua")
+    end
+    local after = heapKB()
+    print(string.format("%d wabbits: %.0f bytes per object", count, (after - before) * 1024 / count))
+end
+
+
 function Object:update(dt)
     
+    if (Key.pressed(KEY.B)) then
+        measure(1000)
+    end
+
+    -- press W: per worker update time of the last frame
+    if (Key.pressed(KEY.W)) then
+        for i, worker in ipairs(workers.stats()) do
+            print(string.format("worker %d: %d wabbits %.2f ms", i, worker.scripts, worker.ms))
+        end
+    end
+    
     if (Mouse.down(0)) then
         local x = Mouse.getX()
         local y = Mouse.getY()
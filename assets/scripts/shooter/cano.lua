@@ -56,14 +56,16 @@ function Object:update(dt)
 
         
 
-        local bullet = scene.createGameObject("bullet",0)
+        local bullet, reused = scene.createGameObject("bullet",0)
         local x,y =self:getWorldPoint(5,-10)
 
     
         bullet:setRotation(self:getWorldRotation()+90)
         bullet:setPosition(x,y)
-        bullet:addSprite("bala")
-        bullet:addScript("assets/scripts/shooter/bullet.lua") 
+        if not reused then
+            bullet:addSprite("bala")
+            bullet:addScript("assets/scripts/shooter/bullet.lua")
+        end
        
     end
 
@@ -4,10 +4,8 @@ Object.__index = Object
 
 function Object:OnReady()
     
-  self.animation = self:addComponent("Animator")
-  self.animation:add("boom","explosion",4,4,16,25)
-  --self.animation:setAnimation("boom")
-  self.animation:setMode(2)
+  -- the Animator is set up where the explosion is created, a pooled one comes back stopped
+  self.animation = self:getAnimator()
   self.animation:play()
   
   self:centerPivot()
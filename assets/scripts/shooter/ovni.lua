@@ -14,7 +14,6 @@ function Object:OnReady()
     self.anim =0
     self.pump=0
     self.energia=5
-    self.timer =5
     
     
 
@@ -23,6 +22,15 @@ function Object:OnReady()
 end
 
 
+-- red while hit, the wait costs nothing per frame
+local function flash(self)
+    self:setSpriteColor(255,0,0,255)
+    wait(0.1)
+    self:setSpriteColor(255,255,255,255)
+    self.panic = false
+end
+
+
 function Object:update(dt)
      
     self.anim= self.anim  + dt *1.2
@@ -30,23 +38,12 @@ function Object:update(dt)
 
     self:faceTo(self.player)
     self:advance(self.speed)
-    if (self.panic) then
-        self:setSpriteColor(255,0,0,0)
-        self.panic=false
-        self.timer = self.timer  -1 * (dt *100)
-    else
-        self:setSpriteColor(255,255,255,255)
-        if (self.timer <= 0) then
-            self.timer = 0;
-            self.panic = false
-        end
-    end
-
     if self:place_meeting(self:getX(),self:getY(),"bullet") then
-        self:setSpriteColor(255,0,0,255)
-        self.panic=true
         self.energia = self.energia - 1
-        self.timer = 5
+        if not self.panic then
+            self.panic=true
+            startCoroutine(self, flash, self)
+        end
     end
 
     
@@ -57,9 +54,14 @@ function Object:update(dt)
     self:kill()
     points = points + 1
 
-    local explode = scene.createGameObject("explosion",5, self:getX(),self:getY())
-    explode:addComponent("Sprite","explosion")
-    explode:addScript("assets/scripts/shooter/explode.lua")
+    local explode, reused = scene.createGameObject("explosion",5, self:getX(),self:getY())
+    if not reused then
+        explode:addComponent("Sprite","explosion")
+        local animation = explode:addComponent("Animator")
+        animation:add("boom","explosion",4,4,16,25)
+        animation:setMode(2)
+        explode:addScript("assets/scripts/shooter/explode.lua")
+    end
     explode:setPosition(self:getX(),self:getY())
     explode:setState("Prefab",true)
  end
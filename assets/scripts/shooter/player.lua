@@ -39,9 +39,14 @@ function Object:update(dt)
 --local x_move = Key.check(KEY.right) - Key.check(KEY.left)
 
   if (Key.pressed(KEY.Q)) then
-    local explode = scene.createGameObject("explosion",5, self:getX(),self:getY())
-    explode:addComponent("Sprite","explosion")
-    explode:addScript("assets/scripts/shooter/explode.lua")
+    local explode, reused = scene.createGameObject("explosion",5, self:getX(),self:getY())
+    if not reused then
+        explode:addComponent("Sprite","explosion")
+        local animation = explode:addComponent("Animator")
+        animation:add("boom","explosion",4,4,16,25)
+        animation:setMode(2)
+        explode:addScript("assets/scripts/shooter/explode.lua")
+    end
     explode:setPosition(self:getX(),self:getY())
     explode:setState("Prefab",true)
 
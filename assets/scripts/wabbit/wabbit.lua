@@ -4,6 +4,9 @@ local Utils = require("utils")
 local Object = {}
 Object.__index = Object
 
+-- runs in a worker lua state once workers.start() was called, update in parallel
+Object.isolated = true
+
 function Object:OnReady()
 
    
@@ -21,7 +24,6 @@ function Object:OnReady()
     self.y = Mouse.getY()
     self.speedX=  (math.random() * 5) -2.5
     self.speedY=  (math.random() * 5) - 2.5 
-    self:setPosition( self.x,self.y) 
     self.angle =0
     --self:setDebug( flags.SHOW_BOX | flags.SHOW_ORIGIN)
 
@@ -48,7 +50,7 @@ function Object:OnReady()
 end
 
 
-function Object:update(dt)
+local function step(self, dt)
     
     local speed = (dt *100)
     
@@ -78,8 +80,8 @@ function Object:update(dt)
     self.data.rotation = self.angle
 
 
-  self:setPosition(self.x, self.y)
-  self:setRotation(self:getRotation() +5.1)
+  -- x, y and rotation write straight to the transform
+  self.rotation = self.rotation + 5.1
   
     
 
@@ -92,4 +94,12 @@ end
 
 
 
+-- batch mode: one call per frame for every wabbit instead of update per object
+function Object.updateAll(wabbits, dt)
+    for i = 1, #wabbits do
+        step(wabbits[i], dt)
+    end
+end
+
+
 return Object
\ No newline at end of file
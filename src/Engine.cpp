@@ -1,8 +1,18 @@
 #include "Engine.hpp"
 #include "wrapper.hpp"
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <sstream>
+#include <cstdio>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
 
@@ -12,6 +22,19 @@ ComponentID GetUniqueComponentID() noexcept
     return lastID++;
 }
 
+// methods live in one table per class, shared through the metatable, so each
+// object table only holds its own fields (pointer, name, ...)
+static void BindLuaClass(lua_State *L, const char *className, const luaL_Reg *methods)
+{
+    if (luaL_newmetatable(L, className))
+    {
+        lua_newtable(L);
+        luaL_setfuncs(L, methods, 0);
+        lua_setfield(L, -2, "__index");
+    }
+    lua_setmetatable(L, -2);
+}
+
 //*********************************************************************************************************************
 //**                         TransformComponent                                                                              **
 //*********************************************************************************************************************
@@ -153,7 +176,7 @@ SpriteComponent::SpriteComponent(const std::string &fileName) : Component()
     clip.height = 1;
     graphID = fileName;
 
-    graph = Assets::Instance().getGraph(fileName);
+    graph = Assets::Instance().retainGraph(fileName);
     if (graph)
     {
         clip.x = 0;
@@ -163,6 +186,51 @@ SpriteComponent::SpriteComponent(const std::string &fileName) : Component()
     }
 }
 
+void SpriteComponent::OnDestroy()
+{
+    Assets::Instance().releaseGraph(graph);
+    graph = nullptr;
+}
+
+Component *SpriteComponent::Clone() const
+{
+    SpriteComponent *copy = new SpriteComponent(*this);
+    Assets::Instance().retainGraph(graph);
+    return copy;
+}
+
+void TileLayerComponent::OnDestroy()
+{
+    Assets::Instance().releaseGraph(graph);
+    graph = nullptr;
+}
+
+void SpriteComponent::OnReset()
+{
+    // the graph it was created with, an animation may have left another one
+    Graph *original = Assets::Instance().retainGraph(graphID);
+    if (original != nullptr)
+        SetGraph(original);
+    Assets::Instance().releaseGraph(original);
+
+    color = WHITE;
+    FlipX = false;
+    FlipY = false;
+    clip.x = 0;
+    clip.y = 0;
+    clip.width = graph ? graph->width : 1;
+    clip.height = graph ? graph->height : 1;
+}
+
+void SpriteComponent::SetGraph(Graph *graph)
+{
+    if (this->graph == graph)
+        return;
+    Assets::Instance().retainGraph(graph);
+    Assets::Instance().releaseGraph(this->graph);
+    this->graph = graph;
+}
+
 void SpriteComponent::OnInit()
 {
     object->centerOrigin();
@@ -269,4697 +337,7925 @@ void SpriteComponent::BindLua(lua_State *L)
     lua_pushstring(L, graphID.c_str());
     lua_setfield(L, -2, "graph");
 
-    lua_pushcfunction(L, &SetSpriteColor);
-    lua_setfield(L, -2, "setColor");
+    static const luaL_Reg methods[] = {
+        {"setColor", SetSpriteColor},
+        {nullptr, nullptr}};
+    BindLuaClass(L, "SpriteComponent", methods);
     lua_pop(L, 1);
     lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
 }
 
-TileLayerComponent::TileLayerComponent(int width, int height, int tileWidth, int tileHeight, int spacing, int margin, const std::string &fileName) : tileWidth(tileWidth), tileHeight(tileHeight), spacing(spacing), margin(margin), width(width), height(height)
+//*********************************************************************************************************************
+//**                         TextLayout                                                                             **
+//*********************************************************************************************************************
+
+TextLayout::TextLayout()
 {
+    hasFont = false;
+    size = 10;
+    spacing = 1;
+    lineHeight = 15;
+    width = 0;
+    height = 0;
+}
 
-    graph = Assets::Instance().getGraph(fileName.c_str());
-    if (!graph)
-    {
-        Log(LOG_ERROR, "TileLayerComponent::TileLayerComponent  %s ", fileName.c_str());
-        isLoad = false;
-    }
-    isLoad = true;
-    graphID = fileName;
-    worldWidth = width * tileWidth;
-    worldHeight = height * tileHeight;
-    // tileMap.reserve(width * height + 1);
-    for (int i = 0; i < width * height; i++)
+void TextLayout::CheckFont()
+{
+    if (hasFont)
+        return;
+    // same font and metrics as DrawText
+    font = GetFontDefault();
+    hasFont = true;
+    lineHeight = (font.baseSize + font.baseSize / 2.0f) * (size / (float)font.baseSize);
+}
+
+void TextLayout::SetFont(Font font, float size, float spacing)
+{
+    this->font = font;
+    this->size = size;
+    this->spacing = spacing;
+    hasFont = true;
+    lineHeight = (font.baseSize + font.baseSize / 2.0f) * (size / (float)font.baseSize);
+    Layout(0);
+}
+
+void TextLayout::SetSize(int fontSize)
+{
+    if (fontSize < 10)
+        fontSize = 10;
+    if (!hasFont)
     {
-        tileMap.push_back(-1);
+        size = (float)fontSize;
+        spacing = (float)(fontSize / 10);
+        return;
     }
+    if ((int)size == fontSize)
+        return;
+    SetFont(font, (float)fontSize, (float)(fontSize / 10));
 }
 
-namespace TileBind
+void TextLayout::BuildGlyph(Glyph &glyph)
 {
+    float scale = size / (float)font.baseSize;
+    int index = GetGlyphIndex(font, glyph.codepoint);
+    Rectangle rec = font.recs[index];
+    GlyphInfo info = font.glyphs[index];
 
-    int SetTile(lua_State *L)
+    if (glyph.codepoint == '\n')
     {
-        TileLayerComponent *tile = nullptr;
-        if (lua_gettop(L) != 4)
-        {
-            Log(LOG_ERROR, "setTile function requires 3 arguments");
-            return 0;
-        }
+        glyph.advance = 0;
+        glyph.visible = false;
+        return;
+    }
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "TileComponent");
-            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            Log(LOG_ERROR, "[setTile] argument is not a table");
-            return 0;
-        }
+    if (info.advanceX == 0)
+        glyph.advance = rec.width * scale + spacing;
+    else
+        glyph.advance = info.advanceX * scale + spacing;
 
-        if (tile != nullptr)
-        {
-            int x = lua_tointeger(L, 2);
-            int y = lua_tointeger(L, 3);
-            int tileID = lua_tointeger(L, 4);
-            tile->setTile(x, y, tileID);
-        }
+    glyph.visible = (glyph.codepoint != ' ' && glyph.codepoint != '\t');
+    if (!glyph.visible)
+        return;
 
-        return 0;
-    }
+    float padding = (float)font.glyphPadding;
+    float texWidth = (float)font.texture.width;
+    float texHeight = (float)font.texture.height;
 
-    int GetTile(lua_State *L)
-    {
-        TileLayerComponent *tile = nullptr;
-        if (lua_gettop(L) != 3)
-        {
-            Log(LOG_ERROR, "getTile function requires 2 arguments");
-            return 0;
-        }
+    float left = (rec.x - padding) / texWidth;
+    float right = (rec.x + rec.width + padding) / texWidth;
+    float top = (rec.y - padding) / texHeight;
+    float bottom = (rec.y + rec.height + padding) / texHeight;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "TileComponent");
-            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            Log(LOG_ERROR, "[getTile] argument is not a table");
-            return 0;
-        }
+    float x1 = glyph.x + (info.offsetX - padding) * scale;
+    float y1 = glyph.y + (info.offsetY - padding) * scale;
+    float x2 = x1 + (rec.width + 2 * padding) * scale;
+    float y2 = y1 + (rec.height + 2 * padding) * scale;
 
-        if (tile != nullptr)
-        {
-            int x = lua_tointeger(L, 2);
-            int y = lua_tointeger(L, 3);
-            int tileID = tile->getTile(x, y);
-            lua_pushinteger(L, tileID);
-            return 1;
-        }
+    rQuad &quad = glyph.quad;
+    quad.tex = font.texture;
+    quad.blend = 0;
 
-        return 0;
-    }
+    quad.v[1].x = x1;
+    quad.v[1].y = y1;
+    quad.v[1].tx = left;
+    quad.v[1].ty = top;
 
-    int LoadStringTiles(lua_State *L)
-    {
-        TileLayerComponent *tile = nullptr;
-        if (lua_gettop(L) != 2 && lua_gettop(L) != 3)
-        {
-            Log(LOG_ERROR, "loadStringTiles function requires 1/2 arguments");
-            return 0;
-        }
+    quad.v[0].x = x1;
+    quad.v[0].y = y2;
+    quad.v[0].tx = left;
+    quad.v[0].ty = bottom;
 
-        if (lua_istable(L, 1))
+    quad.v[3].x = x2;
+    quad.v[3].y = y2;
+    quad.v[3].tx = right;
+    quad.v[3].ty = bottom;
+
+    quad.v[2].x = x2;
+    quad.v[2].y = y1;
+    quad.v[2].tx = right;
+    quad.v[2].ty = top;
+
+    quad.v[0].z = quad.v[1].z = quad.v[2].z = quad.v[3].z = 0.0f;
+}
+
+void TextLayout::Layout(size_t from)
+{
+    if (!hasFont)
+        return;
+
+    for (size_t i = from; i < glyphs.size(); i++)
+    {
+        Glyph &glyph = glyphs[i];
+        if (i == 0)
         {
-            lua_getfield(L, 1, "TileComponent");
-            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+            glyph.x = 0;
+            glyph.y = 0;
         }
         else
         {
-            Log(LOG_ERROR, "[loadStringTiles] argument is not a table");
-            return 0;
-        }
-
-        if (tile != nullptr)
-        {
-            const char *str = lua_tostring(L, 2);
-            if (str==nullptr)
+            const Glyph &prev = glyphs[i - 1];
+            if (prev.codepoint == '\n')
             {
-                Log(LOG_ERROR, "[loadStringTiles] argument is not a string");
-                return 0;
+                glyph.x = 0;
+                glyph.y = prev.y + lineHeight;
             }
-            int shift = 0;
-            if (lua_gettop(L) == 3)
+            else
             {
-                shift = lua_tointeger(L, 3);
+                glyph.x = prev.x + prev.advance;
+                glyph.y = prev.y;
             }
-            tile->loadFromString(str,shift);
         }
-
-        return 0;
+        glyph.codepoint = codepoints[i];
+        BuildGlyph(glyph);
     }
 
-    int BuildSolids(lua_State *L)
+    width = 0;
+    height = glyphs.empty() ? 0 : size;
+    for (size_t i = 0; i < glyphs.size(); i++)
     {
-        TileLayerComponent *tile = nullptr;
-        if (lua_gettop(L) != 1)
-        {
-            Log(LOG_ERROR, "buildSolids function requires GameObject argument");
-            return 0;
-        }
-
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "TileComponent");
-            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); 
-        }
-        else
-        {
-            Log(LOG_ERROR, "[buildSolids] argument is not a table");
-            return 0;
-        }
-
-        if (tile != nullptr)
-        {
-            
-            tile->createSolids();
-        }
-
-        return 0;
+        width = std::max(width, glyphs[i].x + glyphs[i].advance - spacing);
+        height = std::max(height, glyphs[i].y + size);
     }
-
-
 }
-void TileLayerComponent::BindLua(lua_State *L)
-{
 
-    using namespace TileBind;
-    lua_newtable(L);                              // Cria uma nova tabela vazia
-    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);   // Armazena o referenciador da tabela no registro do Lua
-    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref); // Recupera a tabela do objeto
-    lua_pushlightuserdata(L, this);               // Empilha o ponteiro do GameObject
-    lua_setfield(L, -2, "TileComponent");
+void TextLayout::SetText(const char *value)
+{
+    if (value == nullptr)
+        value = "";
+    if (text == value)
+        return;
+    text = value;
 
-    lua_pushcfunction(L, &SetTile);
-    lua_setfield(L, -2, "setTile");
+    CheckFont();
 
-    lua_pushcfunction(L, &GetTile);
-    lua_setfield(L, -2, "getTile");
+    codepoints.clear();
+    const char *p = text.c_str();
+    while (*p)
+    {
+        int bytes = 0;
+        codepoints.push_back(GetCodepoint(p, &bytes));
+        p += (bytes > 0) ? bytes : 1;
+    }
 
-    lua_pushcfunction(L, &LoadStringTiles);
-    lua_setfield(L, -2, "loadString");
+    bool sameLength = (codepoints.size() == glyphs.size());
+    size_t count = std::min(codepoints.size(), glyphs.size());
+    size_t from = count;
 
-    lua_pushcfunction(L, &BuildSolids);
-    lua_setfield(L, -2, "buildSolids");
+    for (size_t i = 0; i < count; i++)
+    {
+        Glyph &glyph = glyphs[i];
+        if (glyph.codepoint == codepoints[i])
+            continue;
 
-    // lua_pushstring(L, graphID.c_str());
-    // lua_setfield(L, -2, "graph");
+        if (sameLength && glyph.codepoint != '\n' && codepoints[i] != '\n')
+        {
+            // digits: same advance, the rest of the line does not move
+            float advance = glyph.advance;
+            glyph.codepoint = codepoints[i];
+            BuildGlyph(glyph);
+            if (glyph.advance == advance)
+                continue;
+        }
+        from = i;
+        break;
+    }
 
-    // lua_pushcfunction(L, &SetSpriteColor);
-    // lua_setfield(L, -2, "setColor");
+    glyphs.resize(codepoints.size());
+    if (!sameLength || from < count)
+        Layout(from);
+}
 
-    lua_pop(L, 1);
-    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+void TextLayout::SetNumber(long value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%ld", value);
+    SetText(buffer);
 }
 
-void TileLayerComponent::PaintRectangle(int x, int y, int w, int h, int id)
+void TextLayout::Draw(float x, float y, Color color)
 {
-    if (!isLoad || !isWithinBounds(x, y))
-        return;
-    for (int i = x; i < x + w; ++i)
+    for (size_t i = 0; i < glyphs.size(); i++)
     {
-        for (int j = y; j < y + h; ++j)
+        if (!glyphs[i].visible)
+            continue;
+        rQuad quad = glyphs[i].quad;
+        for (int j = 0; j < 4; j++)
         {
-            setTile(i, j, id);
+            quad.v[j].x += x;
+            quad.v[j].y += y;
+            quad.v[j].col = color;
         }
+        RenderQuad(&quad);
     }
 }
 
-void TileLayerComponent::PaintCircle(int x, int y, int radius, int id)
+void TextLayout::Draw(const Matrix2D *matrix, Color color)
 {
-    if (!isLoad || !isWithinBounds(x, y))
-        return;
-
-    int rsq = radius * radius;
-    for (int i = x - radius; i <= x + radius; ++i)
+    for (size_t i = 0; i < glyphs.size(); i++)
     {
-        for (int j = y - radius; j <= y + radius; ++j)
+        if (!glyphs[i].visible)
+            continue;
+        rQuad quad = glyphs[i].quad;
+        for (int j = 0; j < 4; j++)
         {
-            int dx = i - x;
-            int dy = j - y;
-            if (dx * dx + dy * dy <= rsq)
-            {
-                setTile(i, j, id);
-            }
+            float x = quad.v[j].x;
+            float y = quad.v[j].y;
+            quad.v[j].x = matrix->a * x + matrix->c * y + matrix->tx;
+            quad.v[j].y = matrix->d * y + matrix->b * x + matrix->ty;
+            quad.v[j].col = color;
         }
+        RenderQuad(&quad);
     }
 }
-void TileLayerComponent::OnInit()
+
+//*********************************************************************************************************************
+//**                         TextComponent                                                                          **
+//*********************************************************************************************************************
+
+TextComponent::TextComponent(const std::string &text, int size) : Component()
 {
-            object->originX=0;
-            object->originY=0;
-            object->width=width*tileWidth;
-            object->height=height*tileHeight;
-            object->bound.x=0;
-            object->bound.y=0;
-            object->bound.width=width*tileWidth;
-            object->bound.height=height*tileHeight;
-           // object->setDebug( SHOW_BOX |  SHOW_BOUND );
+    depth = 1;
+    color = WHITE;
+    initialText = text;
+    layout.SetSize(size);
+    layout.SetText(text);
+}
 
+void TextComponent::OnReset()
+{
+    color = WHITE;
+    layout.SetText(initialText);
 }
 
-void TileLayerComponent::OnDebug()
+Component *TextComponent::Clone() const
 {
-    Log(LOG_INFO, "TileLayerComponent::OnDebug");
+    return new TextComponent(*this);
+}
 
-    if (!isLoad)
-        return;
+void TextComponent::OnDraw()
+{
+    Matrix2D mat = object->transform->GetWorldTransformation();
+    layout.Draw(&mat, color);
+}
 
-    DrawRectangle(0,0,width*tileWidth,height*tileHeight, RED);
+void TextComponent::OnDebug()
+{
+    Matrix2D mat = object->transform->GetWorldTransformation();
+    Vec2 p = mat.TransformCoords(0, 0);
+    DrawRectangleLines((int)p.x, (int)p.y, (int)layout.GetWidth(), (int)layout.GetHeight(), BLUE);
 }
 
-void TileLayerComponent::OnDraw()
+namespace TextBind
 {
-    //  Log(LOG_INFO, "TileLayerComponent::OnDraw");
-    if (!isLoad || !graph)
-        return;
-    if (width == 0 || height == 0 || tileWidth == 0 || tileHeight == 0)
+    static TextComponent *getText(lua_State *L, const char *name)
     {
-        Log(LOG_ERROR, "TileLayerComponent::OnDraw %d %d  %d %d", width, height, tileWidth, tileHeight);
-        isLoad = false;
-        return;
+        TextComponent *text = nullptr;
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "TextComponent");
+            text = static_cast<TextComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+        }
+        if (text == nullptr)
+        {
+            luaL_error(L, "[%s] argument is not a text component", name);
+        }
+        return text;
     }
 
-    Scene *scene = Scene::Instance();
-
-
-    // auto startTime = std::chrono::high_resolution_clock::now();
-
-    
-
+    static int SetText(lua_State *L)
+    {
+        TextComponent *text = getText(L, "setText");
+        if (lua_type(L, 2) == LUA_TNUMBER)
+        {
+            double value = lua_tonumber(L, 2);
+            if (value == (double)(long)value)
+            {
+                text->layout.SetNumber((long)value);
+                return 0;
+            }
+        }
+        text->layout.SetText(lua_tostring(L, 2));
+        return 0;
+    }
 
-//loop in view
-float zoom = scene->camera.zoom;
-Vector2 offset = scene->camera.offset;
-Vector2 target = scene->camera.target;
-Rectangle cameraView = {
-    -offset.x/zoom + target.x - (scene->windowSize.x/2.0f/zoom),
-    -offset.y/zoom + target.y - (scene->windowSize.y/2.0f/zoom),
-    (float)scene->windowSize.x/zoom + (offset.x/zoom),
-    (float)scene->windowSize.y/zoom + (offset.y/zoom)
-};
+    static int SetNumber(lua_State *L)
+    {
+        TextComponent *text = getText(L, "setNumber");
+        text->layout.SetNumber((long)luaL_checknumber(L, 2));
+        return 0;
+    }
 
-int startX = (int)(cameraView.x / tileWidth);
-int startY = (int)(cameraView.y / tileHeight);
-int endX = (int)((cameraView.x + cameraView.width) / tileWidth) + 1;
-int endY = (int)((cameraView.y + cameraView.height) / tileHeight) + 1;
+    static int GetTextString(lua_State *L)
+    {
+        TextComponent *text = getText(L, "getText");
+        lua_pushstring(L, text->layout.GetText().c_str());
+        return 1;
+    }
 
-    startX = Clamp(startX, 0, width);
-    startY = Clamp(startY, 0, height);
-    endX = Clamp(endX, 0, width);
-    endY = Clamp(endY, 0, height);
+    static int SetSize(lua_State *L)
+    {
+        TextComponent *text = getText(L, "setSize");
+        text->layout.SetSize((int)luaL_checkinteger(L, 2));
+        return 0;
+    }
 
-    for (int i = startY; i < endY; i++)
+    static int SetColor(lua_State *L)
     {
-        for (int j = startX; j < endX; j++)
+        TextComponent *text = getText(L, "setColor");
+        if (lua_gettop(L) < 4)
         {
-            float posX = (float)(j * tileWidth);
-            float posY = (float)(i * tileHeight);
-            Rectangle tileRect = {posX, posY, tileWidth, tileHeight};
-            if (!scene->inView(tileRect))
-                    continue;
-
-            int tile = getTile(j, i);
-            if (tile != -1)
-            {
-
-                RenderTile(graph->texture,
-                           posX, posY,
-                           tileWidth, tileHeight,
-                           getClip(tile),
-                           false, false, 0);
-                    
-            }
-            // 736
+            return luaL_error(L, "[setColor] function requires 3/4 arguments");
         }
+        text->color.r = (unsigned char)lua_tointeger(L, 2);
+        text->color.g = (unsigned char)lua_tointeger(L, 3);
+        text->color.b = (unsigned char)lua_tointeger(L, 4);
+        if (lua_gettop(L) >= 5)
+            text->color.a = (unsigned char)lua_tointeger(L, 5);
+        return 0;
     }
-//  auto endTime = std::chrono::high_resolution_clock::now();
-// auto deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() / 1000000.0f;
-   
-//     Log(LOG_INFO, "loop in view %f",deltaTime);
 
+    static int GetSize(lua_State *L)
+    {
+        TextComponent *text = getText(L, "getSize");
+        lua_pushnumber(L, text->layout.GetWidth());
+        lua_pushnumber(L, text->layout.GetHeight());
+        return 2;
+    }
+}
 
-// //loop all
+void TextComponent::BindLua(lua_State *L)
+{
+    using namespace TextBind;
+    lua_newtable(L);
+    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+    lua_pushlightuserdata(L, this);
+    lua_setfield(L, -2, "TextComponent");
+
+    static const luaL_Reg methods[] = {
+        {"setText",   SetText},
+        {"setNumber", SetNumber},
+        {"getText",   GetTextString},
+        {"setSize",   SetSize},
+        {"getSize",   GetSize},
+        {"setColor",  SetColor},
+        {nullptr, nullptr}};
+    BindLuaClass(L, "TextComponent", methods);
+    lua_pop(L, 1);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+}
 
-//   startTime = std::chrono::high_resolution_clock::now();
+//*********************************************************************************************************************
+//**                         ParallaxComponent                                                                      **
+//*********************************************************************************************************************
 
+ParallaxComponent::ParallaxComponent() : Component()
+{
+    depth = 0;
+    color = WHITE;
+}
 
-//     for (int i = 0; i < height; i++)
-//     {
-//         for (int j = 0; j < width; j++)
-//         {
-//                float  posX=(float)(j * tileWidth );
-//                float  posY=(float)(i * tileHeight);
-//                Rectangle tileRect = {posX, posY, tileWidth, tileHeight};
-//                if (!scene->inView(tileRect))
-//                     continue;
-                
-                
+void ParallaxComponent::Add(const std::string &graphID, float factorX, float factorY, int repeat)
+{
+    ParallaxLayer layer;
+    layer.graphID = graphID;
+    layer.graph = Assets::Instance().retainGraph(graphID);
+    layer.factorX = factorX;
+    layer.factorY = factorY;
+    layer.repeat = repeat;
+    backgrounds.push_back(layer);
+}
 
-//                      int tile= getTile(j,i) ;
-//                      if (tile!=-1)
-//                      {
+void ParallaxComponent::Clear()
+{
+    for (auto &layer : backgrounds)
+        Assets::Instance().releaseGraph(layer.graph);
+    backgrounds.clear();
+}
 
-//                         RenderTile(graph->texture,
-//                                     posX,posY,
-//                                     tileWidth,tileHeight,
-//                                     getClip(tile),
-//                                     false,false,0);
-                        
-//                     }
-//                     //115 ;)
+void ParallaxComponent::OnDestroy()
+{
+    Clear();
+}
 
-//         }
-//     }
-//  endTime = std::chrono::high_resolution_clock::now();
-//  deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() / 1000000.0f;
+Component *ParallaxComponent::Clone() const
+{
+    ParallaxComponent *copy = new ParallaxComponent(*this);
+    for (auto &layer : backgrounds)
+        Assets::Instance().retainGraph(layer.graph);
+    return copy;
+}
 
-//     Log(LOG_INFO, "loop all %f",deltaTime);
+void ParallaxComponent::OnDraw()
+{
+    Scene *scene = Scene::Instance();
+    if (scene == nullptr)
+        return;
 
+    const Camera2D &camera = scene->camera;
+    Vector2 view = GetScreenToWorld2D({0, 0}, camera);
+    float viewWidth = GetScreenWidth() / camera.zoom;
+    float viewHeight = GetScreenHeight() / camera.zoom;
 
+    float baseX = object->getWorldX();
+    float baseY = object->getWorldY();
 
+    for (auto &layer : backgrounds)
+    {
+        if (layer.graph == nullptr)
+            continue;
 
-  
+        float width = layer.graph->width * object->transform->scale.x;
+        float height = layer.graph->height * object->transform->scale.y;
+        if (width <= 0 || height <= 0)
+            continue;
 
-    //  //   Log(LOG_INFO, "TileLayerComponent::OnDraw %d %d  %d %d", width, height,tileWidth, tileHeight);
+        float x = baseX + view.x * (1.0f - layer.factorX);
+        float y = baseY + view.y * (1.0f - layer.factorY);
+
+        // repeated layers are drawn as copies side by side: the texture is shared with
+        // sprites and reloaded by the cache, its wrap mode is left alone
+        float startX = x;
+        float endX = x + width;
+        float startY = y;
+        float endY = y + height;
+        if (layer.repeat & RepeatX)
+        {
+            startX = x + floorf((view.x - x) / width) * width;
+            endX = view.x + viewWidth;
+        }
+        if (layer.repeat & RepeatY)
+        {
+            startY = y + floorf((view.y - y) / height) * height;
+            endY = view.y + viewHeight;
+        }
+
+        for (float tileY = startY; tileY < endY; tileY += height)
+        {
+            if (tileY + height < view.y || tileY > view.y + viewHeight)
+                continue;
+            for (float tileX = startX; tileX < endX; tileX += width)
+            {
+                if (tileX + width < view.x || tileX > view.x + viewWidth)
+                    continue;
+                RenderUV(layer.graph->texture, tileX, tileY, width, height, 0, 0, 1, 1, color, 0);
+            }
+        }
+    }
 }
 
-void TileLayerComponent::loadFromArray(const int *tiles)
+namespace ParallaxBind
 {
-    tileMap.clear();
-    int arraSize = (tileWidth * tileHeight);
-    for (int i = 0; i < arraSize; i++)
+    static ParallaxComponent *getParallax(lua_State *L, const char *name)
     {
-        tileMap.push_back(tiles[i]);
+        ParallaxComponent *parallax = nullptr;
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "ParallaxComponent");
+            parallax = static_cast<ParallaxComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+        }
+        if (parallax == nullptr)
+        {
+            luaL_error(L, "[%s] argument is not a parallax component", name);
+        }
+        return parallax;
     }
-}
-void TileLayerComponent::loadFromCSVFile(const std::string &filename)
-{
-    //    m_tileMap.clear();
-    //    std::string tmp;
-    //    char delim = ','; // Ddefine the delimiter to split by
-    //    std::ifstream myFile(filename);
-    //    std::getline(myFile,tmp,delim);
-    //    while (std::getline(myFile,tmp,delim))
-    //   {
-    //      int index = std::stoi(tmp);
-    //      m_tileMap.push_back(index);
-    //    }
 
-    if (!FileInPath(filename))
+    static int Add(lua_State *L)
     {
-        Log(LOG_ERROR, "The file  %s dont exists ", filename.c_str());
-        return;
+        ParallaxComponent *parallax = getParallax(L, "add");
+        if (lua_gettop(L) < 3)
+        {
+            return luaL_error(L, "[add] function requires 2/4 arguments (graph, factorX, [factorY], [repeat])");
+        }
+        const char *graph = luaL_checkstring(L, 2);
+        float factorX = luaL_checknumber(L, 3);
+        float factorY = factorX;
+        if (lua_gettop(L) >= 4)
+            factorY = luaL_checknumber(L, 4);
+
+        int repeat = RepeatX;
+        if (lua_gettop(L) >= 5)
+        {
+            const char *mode = luaL_checkstring(L, 5);
+            if (strcmp(mode, "none") == 0)
+                repeat = RepeatNone;
+            else if (strcmp(mode, "x") == 0)
+                repeat = RepeatX;
+            else if (strcmp(mode, "y") == 0)
+                repeat = RepeatY;
+            else if (strcmp(mode, "xy") == 0)
+                repeat = RepeatBoth;
+            else
+                return luaL_error(L, "[add] unknown repeat mode %s (none, x, y, xy)", mode);
+        }
+        parallax->Add(graph, factorX, factorY, repeat);
+        return 0;
     }
-    std::string path = GetPath(filename);
-    char *text = LoadFileText(path.c_str());
 
-    if (text == nullptr)
+    static int Clear(lua_State *L)
     {
-        Log(LOG_ERROR, " Reading  %s", filename.c_str());
-        return;
+        ParallaxComponent *parallax = getParallax(L, "clear");
+        parallax->Clear();
+        return 0;
     }
 
-    std::istringstream file(text);
-    tileMap.clear();
-    tileMap.reserve(width * height);
-
-    std::string line;
-    while (std::getline(file, line))
+    static int SetColor(lua_State *L)
     {
-        std::istringstream lineStream(line);
-        std::string cell;
-        while (std::getline(lineStream, cell, ','))
+        ParallaxComponent *parallax = getParallax(L, "setColor");
+        if (lua_gettop(L) < 4)
         {
-            int tile = std::stoi(cell);
-            tileMap.push_back(tile);
+            return luaL_error(L, "[setColor] function requires 3/4 arguments");
         }
+        parallax->color.r = (unsigned char)lua_tointeger(L, 2);
+        parallax->color.g = (unsigned char)lua_tointeger(L, 3);
+        parallax->color.b = (unsigned char)lua_tointeger(L, 4);
+        if (lua_gettop(L) >= 5)
+            parallax->color.a = (unsigned char)lua_tointeger(L, 5);
+        return 0;
     }
+}
 
-    UnloadFileText(text);
+void ParallaxComponent::BindLua(lua_State *L)
+{
+    lua_newtable(L);
+    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+    lua_pushlightuserdata(L, this);
+    lua_setfield(L, -2, "ParallaxComponent");
+
+    static const luaL_Reg methods[] = {
+        {"add",      ParallaxBind::Add},
+        {"clear",    ParallaxBind::Clear},
+        {"setColor", ParallaxBind::SetColor},
+        {nullptr, nullptr}};
+    BindLuaClass(L, "ParallaxComponent", methods);
+    lua_pop(L, 1);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
 }
 
-void TileLayerComponent::loadFromString(const std::string &text,int shift)
+TileLayerComponent::TileLayerComponent(int width, int height, int tileWidth, int tileHeight, int spacing, int margin, const std::string &fileName) : tileWidth(tileWidth), tileHeight(tileHeight), spacing(spacing), margin(margin), width(width), height(height)
 {
-    std::istringstream file(text);
-    tileMap.clear();
-    tileMap.reserve(width * height);
 
-    std::string line;
-    while (std::getline(file, line))
+    graph = Assets::Instance().retainGraph(fileName);
+    if (!graph)
     {
-        std::istringstream lineStream(line);
-        std::string cell;
-        while (std::getline(lineStream, cell, ','))
-        {
-            int tile = std::stoi(cell) + shift;
-            tileMap.push_back(tile);
-        }
+        Log(LOG_ERROR, "TileLayerComponent::TileLayerComponent  %s ", fileName.c_str());
+        isLoad = false;
     }
-}
-
-std::string TileLayerComponent::getCSV() const
-{
-    std::ostringstream csvStream;
-    for (size_t i = 0; i < tileMap.size(); ++i)
+    isLoad = true;
+    graphID = fileName;
+    worldWidth = width * tileWidth;
+    worldHeight = height * tileHeight;
+    // tileMap.reserve(width * height + 1);
+    for (int i = 0; i < width * height; i++)
     {
-        csvStream << tileMap[i];
-
-        if (i < tileMap.size() - 1)
-        {
-            csvStream << ",";
-        }
+        tileMap.push_back(-1);
     }
-    return csvStream.str();
 }
 
-void TileLayerComponent::saveToCSVFile(const std::string &filename)
+namespace TileBind
 {
-    std::ostringstream file;
 
-    for (int y = 0; y < height; ++y)
+    int SetTile(lua_State *L)
     {
-        for (int x = 0; x < width; ++x)
+        TileLayerComponent *tile = nullptr;
+        if (lua_gettop(L) != 4)
         {
-            int tile = tileMap[y * width + x];
-            file << tile;
-            if (x < width - 1)
-            {
-                file << ",";
-            }
+            Log(LOG_ERROR, "setTile function requires 3 arguments");
+            return 0;
         }
-        file << "\n";
-    }
 
-    std::string fileContent = file.str();
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "TileComponent");
+            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+        }
+        else
+        {
+            Log(LOG_ERROR, "[setTile] argument is not a table");
+            return 0;
+        }
 
-    bool success = SaveFileText(filename.c_str(), const_cast<char *>(fileContent.c_str()));
+        if (tile != nullptr)
+        {
+            int x = lua_tointeger(L, 2);
+            int y = lua_tointeger(L, 3);
+            int tileID = lua_tointeger(L, 4);
+            tile->setTile(x, y, tileID);
+        }
 
-    if (!success)
-    {
-        Log(LOG_ERROR, "Saving file: %s", filename.c_str());
+        return 0;
     }
-}
-
-void TileLayerComponent::setTile(int x, int y, int tile)
-{
-    if (!isLoad || !isWithinBounds(x, y))
-        return;
-
-    int index = (int)(x + y * width);
-    tileMap[index] = tile;
-}
-int TileLayerComponent::getTile(int x, int y)
-{
-    if (!isLoad || !isWithinBounds(x, y))
-        return -1;
-    int index = (int)(x + y * width);
-    return tileMap[index];
-}
 
-void TileLayerComponent::createSolids()
-{
-     int count=0;
-     for (int x = 0; x < width; x++)
+    int GetTile(lua_State *L)
+    {
+        TileLayerComponent *tile = nullptr;
+        if (lua_gettop(L) != 3)
         {
-            for (int y = 0; y < height; y++)
-            {
-                int tile= getTile(x,y) ;
-                if (tile!=-1)
-                {
-                    if (tile>=1)
-                    {
-
-                     GameObject *solid = new GameObject("solid",2);
-                    solid->solid=true;
-                    solid->prefab=true;
-                    solid->transform->position.x=x*tileWidth,
-                    solid->transform->position.y=y*tileHeight;
-
-                    solid->width = tileWidth;
-                    solid->height= tileHeight;
-
-                    solid->originX=0;// (tileWidth/2) + (tileWidth/2)  +14;
-                    solid->originY=0;// (tileHeight/2) + (tileHeight/2)+14;
-                    solid->transform->pivot.x=0;
-                    solid->transform->pivot.y=0;
+            Log(LOG_ERROR, "getTile function requires 2 arguments");
+            return 0;
+        }
 
-                    solid->UpdateWorld();
-              
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "TileComponent");
+            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+        }
+        else
+        {
+            Log(LOG_ERROR, "[getTile] argument is not a table");
+            return 0;
+        }
 
-     
+        if (tile != nullptr)
+        {
+            int x = lua_tointeger(L, 2);
+            int y = lua_tointeger(L, 3);
+            int tileID = tile->getTile(x, y);
+            lua_pushinteger(L, tileID);
+            return 1;
+        }
 
-                    
-//                    solid->setDebug( SHOW_BOX );
+        return 0;
+    }
 
-                    Scene::Instance()->AddGameObject(solid);
+    int LoadStringTiles(lua_State *L)
+    {
+        TileLayerComponent *tile = nullptr;
+        if (lua_gettop(L) != 2 && lua_gettop(L) != 3)
+        {
+            Log(LOG_ERROR, "loadStringTiles function requires 1/2 arguments");
+            return 0;
+        }
 
-                    }
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "TileComponent");
+            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+        }
+        else
+        {
+            Log(LOG_ERROR, "[loadStringTiles] argument is not a table");
+            return 0;
+        }
 
-                    count++;
-                }
+        if (tile != nullptr)
+        {
+            const char *str = lua_tostring(L, 2);
+            if (str==nullptr)
+            {
+                Log(LOG_ERROR, "[loadStringTiles] argument is not a string");
+                return 0;
+            }
+            int shift = 0;
+            if (lua_gettop(L) == 3)
+            {
+                shift = lua_tointeger(L, 3);
             }
+            tile->loadFromString(str,shift);
         }
-        
-}
 
-Rectangle TileLayerComponent::getClip(int id)
-{
-    Rectangle clip;
-    if (!graph || !isLoad)
-    {
-        Log(LOG_ERROR, "TileLayerComponent::getClip - Graph is null");
-        return clip;
+        return 0;
     }
 
-    int columns = (int)floor(graph->width / tileWidth);
-    // int rows = (int)floor(graph->height / tileHeight);
+    int BuildSolids(lua_State *L)
+    {
+        TileLayerComponent *tile = nullptr;
+        if (lua_gettop(L) != 1)
+        {
+            Log(LOG_ERROR, "buildSolids function requires GameObject argument");
+            return 0;
+        }
 
-    int pRow = id / columns;
-    int pFrame = id % columns;
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "TileComponent");
+            tile = static_cast<TileLayerComponent *>(lua_touserdata(L, -1));
+            lua_pop(L, 1); 
+        }
+        else
+        {
+            Log(LOG_ERROR, "[buildSolids] argument is not a table");
+            return 0;
+        }
 
-    float sourcex = margin + (spacing + tileWidth) * pFrame;
-    float sourcey = margin + (spacing + tileHeight) * pRow;
+        if (tile != nullptr)
+        {
+            
+            tile->createSolids();
+        }
 
-    clip.x = sourcex;
-    clip.y = sourcey;
-    clip.width = tileWidth;
-    clip.height = tileHeight;
+        return 0;
+    }
 
-    return clip;
-}
 
-void TileLayerComponent::clear()
-{
-    tileMap.clear();
 }
-
-void TileLayerComponent::addTile(int index)
+void TileLayerComponent::BindLua(lua_State *L)
 {
-    tileMap.push_back(index);
-}
 
-//*********************************************************************************************************************
-//**                         ANIMATION                                                                              **
-//*********************************************************************************************************************
+    using namespace TileBind;
+    lua_newtable(L);                              // Cria uma nova tabela vazia
+    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);   // Armazena o referenciador da tabela no registro do Lua
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref); // Recupera a tabela do objeto
+    lua_pushlightuserdata(L, this);               // Empilha o ponteiro do GameObject
+    lua_setfield(L, -2, "TileComponent");
 
-Animation::Animation(const std::string &graphID, int rows, int columns, int frameCount, float frameDuration) : frameCount(frameCount),
-                                                                                                               currentFrame(0),
-                                                                                                               frameDuration(frameDuration),
-                                                                                                               currentTime(0),
-                                                                                                               isReversed(false), rows(rows),
-                                                                                                               columns(columns)
+    // lua_pushstring(L, graphID.c_str());
+    // lua_setfield(L, -2, "graph");
 
-{
-    this->graphID = graphID;
-    graph = Assets::Instance().getGraph(graphID);
-    if (graph)
-    {
-        imageWidth = graph->texture.width;
-        imageHeight = graph->texture.height;
-        // Log(LOG_INFO, "Animation::Animation() : graphID %s %d %d", graphID.c_str(), imageWidth, imageHeight);
-    }
-    else
-    {
-        Log(LOG_ERROR, "Animation::Animation() : graphID not found %s", graphID.c_str());
-    }
+    // lua_pushcfunction(L, &SetSpriteColor);
+    // lua_setfield(L, -2, "setColor");
+
+    static const luaL_Reg methods[] = {
+        {"setTile",     SetTile},
+        {"getTile",     GetTile},
+        {"loadString",  LoadStringTiles},
+        {"buildSolids", BuildSolids},
+        {nullptr, nullptr}};
+    BindLuaClass(L, "TileLayerComponent", methods);
+    lua_pop(L, 1);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
 }
 
-Rectangle Animation::GetFrame()
+void TileLayerComponent::PaintRectangle(int x, int y, int w, int h, int id)
 {
-    Rectangle rect;
-    if (graph == nullptr)
+    if (!isLoad || !isWithinBounds(x, y))
+        return;
+    for (int i = x; i < x + w; ++i)
     {
-        Log(LOG_ERROR, "Animation::GetFrame() : graph is null");
-        return rect;
+        for (int j = y; j < y + h; ++j)
+        {
+            setTile(i, j, id);
+        }
     }
-    rect.width = imageWidth / columns;
-    rect.height = imageHeight / rows;
-    rect.x = (currentFrame % columns) * rect.width;
-    rect.y = (currentFrame / columns) * rect.height;
-    return rect;
 }
 
-void Animation::Update(float deltaTime, AnimationMode mode)
+void TileLayerComponent::PaintCircle(int x, int y, int radius, int id)
 {
-    if (!graph)
+    if (!isLoad || !isWithinBounds(x, y))
         return;
-    currentTime += deltaTime;
 
-    if (mode == AnimationMode::Loop)
+    int rsq = radius * radius;
+    for (int i = x - radius; i <= x + radius; ++i)
     {
-        while (currentTime >= frameDuration)
+        for (int j = y - radius; j <= y + radius; ++j)
         {
-            currentFrame = (currentFrame + 1) % frameCount;
-            currentTime -= frameDuration;
-        }
-    }
-    else if (mode == AnimationMode::PingPong)
-    {
-        int frameIndex = currentFrame;
-        int frameIncrement = isReversed ? -1 : 1;
-
-        while (currentTime >= frameDuration)
-        {
-            frameIndex += frameIncrement;
-
-            if (frameIndex < 0)
-            {
-                frameIndex = 1;
-                isReversed = false;
-            }
-            else if (frameIndex >= frameCount)
-            {
-                frameIndex = frameCount - 2;
-                isReversed = true;
-            }
-
-            currentTime -= frameDuration;
-        }
-
-        currentFrame = frameIndex;
-    }
-    else if (mode == AnimationMode::Stop)
-    {
-        if (currentFrame < frameCount - 1)
-        {
-            while (currentTime >= frameDuration)
-            {
-                currentFrame++;
-                currentTime -= frameDuration;
-            }
-        }
-    }
-    else if (mode == AnimationMode::Once)
-    {
-        if (currentFrame < frameCount - 1)
-        {
-            while (currentTime >= frameDuration)
-            {
-                currentFrame++;
-                currentTime -= frameDuration;
-            }
+            int dx = i - x;
+            int dy = j - y;
+            if (dx * dx + dy * dy <= rsq)
+            {
+                setTile(i, j, id);
+            }
         }
     }
 }
+void TileLayerComponent::OnInit()
+{
+            object->originX=0;
+            object->originY=0;
+            object->width=width*tileWidth;
+            object->height=height*tileHeight;
+            object->bound.x=0;
+            object->bound.y=0;
+            object->bound.width=width*tileWidth;
+            object->bound.height=height*tileHeight;
+           // object->setDebug( SHOW_BOX |  SHOW_BOUND );
 
-//*********************************************************************************************************************
-//**                         ANIMATOR                                                                               **
-//*********************************************************************************************************************
+}
 
-Animator::Animator() : Component(), currentAnimation(""), nextAnimation(""),
-                       isPlaying(true),
-                       mode(AnimationMode::Loop)
+Component *TileLayerComponent::Clone() const
 {
-    sprite = nullptr;
-    object = nullptr;
-    currentFrame = 0;
-    frameCount = 0;
-    frameDuration = 0;
-    currentTime = 0;
-    isReversed = false;
-    isLoad = true;
+    TileLayerComponent *copy = new TileLayerComponent(*this);
+    Assets::Instance().retainGraph(graph);
+    return copy;
 }
 
-void Animator::OnDestroy()
+void TileLayerComponent::OnDebug()
 {
-    for (auto &pair : animations)
-    {
-        delete pair.second;
-    }
-    animations.clear();
+    Log(LOG_INFO, "TileLayerComponent::OnDebug");
+
+    if (!isLoad)
+        return;
+
+    DrawRectangle(0,0,width*tileWidth,height*tileHeight, RED);
 }
 
-namespace BindAnimator
+void TileLayerComponent::OnDraw()
 {
-    static int SetAnimation(lua_State *L)
+    //  Log(LOG_INFO, "TileLayerComponent::OnDraw");
+    if (!isLoad || !graph)
+        return;
+    if (width == 0 || height == 0 || tileWidth == 0 || tileHeight == 0)
     {
+        Log(LOG_ERROR, "TileLayerComponent::OnDraw %d %d  %d %d", width, height, tileWidth, tileHeight);
+        isLoad = false;
+        return;
+    }
 
-        if (lua_gettop(L) <= 1)
-        {
-            return luaL_error(L, "setAnimation function requires 1/2 arguments");
-        }
-        Animator *animator = nullptr;
-
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+    Scene *scene = Scene::Instance();
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[setAnimation] animator is null");
-            }
 
-            const char *name = lua_tostring(L, 2);
-            bool now = false;
+    // auto startTime = std::chrono::high_resolution_clock::now();
 
-            if (lua_gettop(L) == 3)
-            {
-                now = lua_toboolean(L, 3);
-            }
+    
 
-            animator->SetAnimation(name, now);
-        }
-        else
-        {
-            return luaL_error(L, "setAnimation Invalid argument type, expected table");
-        }
 
-        return 0;
-    }
+//loop in view
+float zoom = scene->camera.zoom;
+Vector2 offset = scene->camera.offset;
+Vector2 target = scene->camera.target;
+Rectangle cameraView = {
+    -offset.x/zoom + target.x - (scene->windowSize.x/2.0f/zoom),
+    -offset.y/zoom + target.y - (scene->windowSize.y/2.0f/zoom),
+    (float)scene->windowSize.x/zoom + (offset.x/zoom),
+    (float)scene->windowSize.y/zoom + (offset.y/zoom)
+};
 
-    static int SetMode(lua_State *L)
-    {
+int startX = (int)(cameraView.x / tileWidth);
+int startY = (int)(cameraView.y / tileHeight);
+int endX = (int)((cameraView.x + cameraView.width) / tileWidth) + 1;
+int endY = (int)((cameraView.y + cameraView.height) / tileHeight) + 1;
 
-        if (lua_gettop(L) != 2)
-        {
-            return luaL_error(L, "setMode function requires 1 arguments");
-        }
-        Animator *animator = nullptr;
+    startX = Clamp(startX, 0, width);
+    startY = Clamp(startY, 0, height);
+    endX = Clamp(endX, 0, width);
+    endY = Clamp(endY, 0, height);
 
-        if (lua_istable(L, 1))
+    for (int i = startY; i < endY; i++)
+    {
+        for (int j = startX; j < endX; j++)
         {
+            float posX = (float)(j * tileWidth);
+            float posY = (float)(i * tileHeight);
+            Rectangle tileRect = {posX, posY, tileWidth, tileHeight};
+            if (!scene->inView(tileRect))
+                    continue;
 
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (animator == nullptr)
+            int tile = getTile(j, i);
+            if (tile != -1)
             {
-                return luaL_error(L, "[setMode] animator is null");
-            }
 
-            int m = lua_tointeger(L, 2);
-            AnimationMode mode = AnimationMode::Loop;
-            if (m == 0)
-            {
-                mode = AnimationMode::Loop;
-            }
-            else if (m == 1)
-            {
-                mode = AnimationMode::PingPong;
-            }
-            else if (m == 2)
-            {
-                mode = AnimationMode::Stop;
-            }
-            else if (m == 3)
-            {
-                mode = AnimationMode::Once;
+                RenderTile(graph->texture,
+                           posX, posY,
+                           tileWidth, tileHeight,
+                           getClip(tile),
+                           false, false, 0);
+                    
             }
-            animator->SetMode(mode);
-        }
-        else
-        {
-            return luaL_error(L, "setMode Invalid argument type, expected table");
+            // 736
         }
-
-        return 0;
     }
+//  auto endTime = std::chrono::high_resolution_clock::now();
+// auto deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() / 1000000.0f;
+   
+//     Log(LOG_INFO, "loop in view %f",deltaTime);
 
-    static int Play(lua_State *L)
-    {
 
-        Animator *animator = nullptr;
+// //loop all
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+//   startTime = std::chrono::high_resolution_clock::now();
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[play] animator is null");
-            }
 
-            animator->Play();
-        }
-        else
-        {
-            return luaL_error(L, "play Invalid argument type, expected table");
-        }
-        return 0;
-    }
+//     for (int i = 0; i < height; i++)
+//     {
+//         for (int j = 0; j < width; j++)
+//         {
+//                float  posX=(float)(j * tileWidth );
+//                float  posY=(float)(i * tileHeight);
+//                Rectangle tileRect = {posX, posY, tileWidth, tileHeight};
+//                if (!scene->inView(tileRect))
+//                     continue;
+                
+                
 
-    static int Stop(lua_State *L)
-    {
+//                      int tile= getTile(j,i) ;
+//                      if (tile!=-1)
+//                      {
 
-        Animator *animator = nullptr;
+//                         RenderTile(graph->texture,
+//                                     posX,posY,
+//                                     tileWidth,tileHeight,
+//                                     getClip(tile),
+//                                     false,false,0);
+                        
+//                     }
+//                     //115 ;)
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+//         }
+//     }
+//  endTime = std::chrono::high_resolution_clock::now();
+//  deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() / 1000000.0f;
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[stop] animator is null");
-            }
+//     Log(LOG_INFO, "loop all %f",deltaTime);
 
-            animator->Stop();
-        }
-        else
-        {
-            return luaL_error(L, "stop Invalid argument type, expected table");
-        }
-        return 0;
-    }
 
-    static int Pause(lua_State *L)
-    {
 
-        Animator *animator = nullptr;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+  
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[pause] animator is null");
-            }
+    //  //   Log(LOG_INFO, "TileLayerComponent::OnDraw %d %d  %d %d", width, height,tileWidth, tileHeight);
+}
 
-            animator->Pause();
-        }
-        else
-        {
-            return luaL_error(L, "pause Invalid argument type, expected table");
-        }
-        return 0;
+void TileLayerComponent::loadFromArray(const int *tiles)
+{
+    tileMap.clear();
+    int arraSize = (tileWidth * tileHeight);
+    for (int i = 0; i < arraSize; i++)
+    {
+        tileMap.push_back(tiles[i]);
     }
+}
+void TileLayerComponent::loadFromCSVFile(const std::string &filename)
+{
+    //    m_tileMap.clear();
+    //    std::string tmp;
+    //    char delim = ','; // Ddefine the delimiter to split by
+    //    std::ifstream myFile(filename);
+    //    std::getline(myFile,tmp,delim);
+    //    while (std::getline(myFile,tmp,delim))
+    //   {
+    //      int index = std::stoi(tmp);
+    //      m_tileMap.push_back(index);
+    //    }
 
-    static int Add(lua_State *L)
+    if (!FileInPath(filename))
     {
+        Log(LOG_ERROR, "The file  %s dont exists ", filename.c_str());
+        return;
+    }
+    std::string path = GetPath(filename);
+    char *text = LoadAssetText(path.c_str());
 
-        if (lua_gettop(L) != 7)
-        {
-            return luaL_error(L, "add animation function requires 7 arguments");
-        }
-
-        Animator *animator = nullptr;
-
-        if (lua_istable(L, 1))
-        {
-
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+    if (text == nullptr)
+    {
+        Log(LOG_ERROR, " Reading  %s", filename.c_str());
+        return;
+    }
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[add] animator is null");
-            }
+    std::istringstream file(text);
+    tileMap.clear();
+    tileMap.reserve(width * height);
 
-            const char *name = lua_tostring(L, 2);
-            const char *graph = lua_tostring(L, 3);
-            int row = lua_tointeger(L, 4);
-            int column = lua_tointeger(L, 5);
-            int frameCount = lua_tointeger(L, 6);
-            float framesPerSecond = lua_tonumber(L, 7);
-            animator->Add(name, graph, row, column, frameCount, framesPerSecond);
-        }
-        else
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream lineStream(line);
+        std::string cell;
+        while (std::getline(lineStream, cell, ','))
         {
-            return luaL_error(L, "add Invalid argument type, expected table");
+            int tile = std::stoi(cell);
+            tileMap.push_back(tile);
         }
-        return 0;
     }
-    static int GetFrameCount(lua_State *L)
-    {
-
-        Animator *animator = nullptr;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+    UnloadAssetText(text);
+}
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[getFrameCount] animator is null");
-            }
+void TileLayerComponent::loadFromString(const std::string &text,int shift)
+{
+    std::istringstream file(text);
+    tileMap.clear();
+    tileMap.reserve(width * height);
 
-            lua_pushinteger(L, animator->getFrameCount());
-        }
-        else
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream lineStream(line);
+        std::string cell;
+        while (std::getline(lineStream, cell, ','))
         {
-            return luaL_error(L, "getFrameCount Invalid argument type, expected table");
+            int tile = std::stoi(cell) + shift;
+            tileMap.push_back(tile);
         }
-        return 1;
     }
+}
 
-    int IsPlaying(lua_State *L)
+std::string TileLayerComponent::getCSV() const
+{
+    std::ostringstream csvStream;
+    for (size_t i = 0; i < tileMap.size(); ++i)
     {
+        csvStream << tileMap[i];
 
-        Animator *animator = nullptr;
-
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[isPlaying] animator is null");
-            }
-
-            lua_pushboolean(L, animator->IsPlaying());
-        }
-        else
+        if (i < tileMap.size() - 1)
         {
-            return luaL_error(L, "isPlaying Invalid argument type, expected table");
+            csvStream << ",";
         }
-        return 1;
     }
+    return csvStream.str();
+}
 
-    static int GetCurrentFrame(lua_State *L)
-    {
-
-        Animator *animator = nullptr;
+void TileLayerComponent::saveToCSVFile(const std::string &filename)
+{
+    std::ostringstream file;
 
-        if (lua_istable(L, 1))
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
         {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (animator == nullptr)
+            int tile = tileMap[y * width + x];
+            file << tile;
+            if (x < width - 1)
             {
-                return luaL_error(L, "[getCurrentFrame] animator is null");
+                file << ",";
             }
-
-            lua_pushinteger(L, animator->getCurrentFrame());
-        }
-        else
-        {
-            return luaL_error(L, "getCurrentFrame Invalid argument type, expected table");
         }
-        return 1;
+        file << "\n";
     }
 
-    static int GetFrameDuration(lua_State *L)
-    {
-
-        Animator *animator = nullptr;
-
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+    std::string fileContent = file.str();
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[getFrameDuration] animator is null");
-            }
+    bool success = SaveFileText(filename.c_str(), const_cast<char *>(fileContent.c_str()));
 
-            lua_pushnumber(L, animator->getFrameDuration());
-        }
-        else
-        {
-            return luaL_error(L, "getFrameDuration Invalid argument type, expected table");
-        }
-        return 1;
+    if (!success)
+    {
+        Log(LOG_ERROR, "Saving file: %s", filename.c_str());
     }
+}
 
-    static int GetCurrentTime(lua_State *L)
-    {
+void TileLayerComponent::setTile(int x, int y, int tile)
+{
+    if (!isLoad || !isWithinBounds(x, y))
+        return;
 
-        Animator *animator = nullptr;
+    int index = (int)(x + y * width);
+    tileMap[index] = tile;
+}
+int TileLayerComponent::getTile(int x, int y)
+{
+    if (!isLoad || !isWithinBounds(x, y))
+        return -1;
+    int index = (int)(x + y * width);
+    return tileMap[index];
+}
 
-        if (lua_istable(L, 1))
+void TileLayerComponent::createSolids()
+{
+     int count=0;
+     for (int x = 0; x < width; x++)
         {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (animator == nullptr)
+            for (int y = 0; y < height; y++)
             {
-                return luaL_error(L, "[getCurrentTime] animator is null");
-            }
+                int tile= getTile(x,y) ;
+                if (tile!=-1)
+                {
+                    if (tile>=1)
+                    {
 
-            lua_pushnumber(L, animator->getCurrentTime());
-        }
-        else
-        {
-            return luaL_error(L, "getCurrentTime Invalid argument type, expected table");
-        }
-        return 1;
-    }
+                     GameObject *solid = new GameObject("solid",2);
+                    solid->solid=true;
+                    solid->prefab=true;
+                    solid->transform->position.x=x*tileWidth,
+                    solid->transform->position.y=y*tileHeight;
 
-    static int GetAnimationname(lua_State *L)
-    {
-        Animator *animator = nullptr;
+                    solid->width = tileWidth;
+                    solid->height= tileHeight;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "AnimatorComponent");
-            animator = static_cast<Animator *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+                    solid->originX=0;// (tileWidth/2) + (tileWidth/2)  +14;
+                    solid->originY=0;// (tileHeight/2) + (tileHeight/2)+14;
+                    solid->transform->pivot.x=0;
+                    solid->transform->pivot.y=0;
 
-            if (animator == nullptr)
-            {
-                return luaL_error(L, "[getAnimation] animator is null");
-            }
+                    solid->UpdateWorld();
+              
 
-            lua_pushstring(L, animator->getName().c_str());
-        }
-        else
-        {
-            return luaL_error(L, "getAnimation Invalid argument type, expected table");
-        }
-        return 1;
-    }
+     
+
+                    
+//                    solid->setDebug( SHOW_BOX );
+
+                    Scene::Instance()->AddGameObject(solid);
 
+                    }
+
+                    count++;
+                }
+            }
+        }
+        
 }
 
-void Animator::BindLua(lua_State *L)
+Rectangle TileLayerComponent::getClip(int id)
 {
+    Rectangle clip;
+    if (!graph || !isLoad)
+    {
+        Log(LOG_ERROR, "TileLayerComponent::getClip - Graph is null");
+        return clip;
+    }
 
-    lua_newtable(L);
-    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    int columns = (int)floor(graph->width / tileWidth);
+    // int rows = (int)floor(graph->height / tileHeight);
 
-    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref); // Recupera a tabela do objeto
-    lua_pushlightuserdata(L, this);               // Empilha o ponteiro do GameObject
-    lua_setfield(L, -2, "AnimatorComponent");
+    int pRow = id / columns;
+    int pFrame = id % columns;
 
-    lua_pushstring(L, object->name.c_str());
-    lua_setfield(L, -2, "parent");
+    float sourcex = margin + (spacing + tileWidth) * pFrame;
+    float sourcey = margin + (spacing + tileHeight) * pRow;
 
-    lua_pushcfunction(L, &BindAnimator::Add);
-    lua_setfield(L, -2, "add");
+    clip.x = sourcex;
+    clip.y = sourcey;
+    clip.width = tileWidth;
+    clip.height = tileHeight;
 
-    lua_pushcfunction(L, &BindAnimator::Play);
-    lua_setfield(L, -2, "play");
+    return clip;
+}
 
-    lua_pushcfunction(L, &BindAnimator::Stop);
-    lua_setfield(L, -2, "stop");
+void TileLayerComponent::clear()
+{
+    tileMap.clear();
+}
 
-    lua_pushcfunction(L, &BindAnimator::Pause);
-    lua_setfield(L, -2, "pause");
+void TileLayerComponent::addTile(int index)
+{
+    tileMap.push_back(index);
+}
 
-    lua_pushcfunction(L, &BindAnimator::SetAnimation);
-    lua_setfield(L, -2, "setAnimation");
+//*********************************************************************************************************************
+//**                         ANIMATION                                                                              **
+//*********************************************************************************************************************
 
-    lua_pushcfunction(L, &BindAnimator::SetMode);
-    lua_setfield(L, -2, "setMode");
+static std::unordered_map<std::string, int> animationNameIDs;
+static std::vector<std::string> animationNames;
 
-    lua_pushcfunction(L, &BindAnimator::GetFrameCount);
-    lua_setfield(L, -2, "getFrameCount");
+int InternAnimationName(const std::string &name)
+{
+    auto it = animationNameIDs.find(name);
+    if (it != animationNameIDs.end())
+        return it->second;
+    int id = (int)animationNames.size();
+    animationNames.push_back(name);
+    animationNameIDs[name] = id;
+    return id;
+}
 
-    lua_pushcfunction(L, &BindAnimator::IsPlaying);
-    lua_setfield(L, -2, "isPlaying");
+const std::string &GetAnimationName(int id)
+{
+    static const std::string empty;
+    if (id < 0 || id >= (int)animationNames.size())
+        return empty;
+    return animationNames[id];
+}
 
-    lua_pushcfunction(L, &BindAnimator::GetCurrentFrame);
-    lua_setfield(L, -2, "getCurrentFrame");
+Animation::Animation(const std::string &graphID, int rows, int columns, int frameCount, float frameDuration) : rows(rows),
+                                                                                                               columns(columns),
+                                                                                                               imageWidth(0),
+                                                                                                               imageHeight(0),
+                                                                                                               frameCount(frameCount),
+                                                                                                               frameDuration(frameDuration)
 
-    lua_pushcfunction(L, &BindAnimator::GetFrameDuration);
-    lua_setfield(L, -2, "getFrameDuration");
+{
+    this->graphID = graphID;
+    graph = Assets::Instance().retainGraph(graphID);
+    if (graph)
+    {
+        imageWidth = graph->width;
+        imageHeight = graph->height;
+        // Log(LOG_INFO, "Animation::Animation() : graphID %s %d %d", graphID.c_str(), imageWidth, imageHeight);
+    }
+    else
+    {
+        Log(LOG_ERROR, "Animation::Animation() : graphID not found %s", graphID.c_str());
+        return;
+    }
+    if (rows <= 0 || columns <= 0 || frameCount <= 0)
+    {
+        Log(LOG_ERROR, "Animation::Animation() : invalid frames %s %d %d %d", graphID.c_str(), rows, columns, frameCount);
+        return;
+    }
 
-    lua_pushcfunction(L, &BindAnimator::GetCurrentTime);
-    lua_setfield(L, -2, "getCurrentTime");
+    // frame table, computed once
+    frames.resize(frameCount);
+    float width = (float)(imageWidth / columns);
+    float height = (float)(imageHeight / rows);
+    for (int i = 0; i < frameCount; i++)
+    {
+        frames[i].width = width;
+        frames[i].height = height;
+        frames[i].x = (i % columns) * width;
+        frames[i].y = (i / columns) * height;
+    }
+}
 
-    lua_pushcfunction(L, &BindAnimator::GetAnimationname);
-    lua_setfield(L, -2, "getName");
+Animation::Animation(const std::string &graphID, const std::vector<Rectangle> &frames, float frameDuration) : rows(0),
+                                                                                                             columns(0),
+                                                                                                             imageWidth(0),
+                                                                                                             imageHeight(0),
+                                                                                                             frameCount((int)frames.size()),
+                                                                                                             frameDuration(frameDuration),
+                                                                                                             frames(frames)
+{
+    this->graphID = graphID;
+    graph = Assets::Instance().retainGraph(graphID);
+    if (graph)
+    {
+        imageWidth = graph->width;
+        imageHeight = graph->height;
+    }
+    else
+    {
+        Log(LOG_ERROR, "Animation::Animation() : graphID not found %s", graphID.c_str());
+        this->frames.clear();
+    }
+}
 
-    lua_pop(L, 1);
-    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+Animation::~Animation()
+{
+    Assets::Instance().releaseGraph(graph);
 }
 
-void Animator::OnUpdate(float deltaTime)
+void Animation::Update(float deltaTime, AnimationMode mode, int &frame, float &time, bool &isReversed) const
 {
-    if (animations.size() == 0 || !isLoad)
+    if (frames.empty() || frameDuration <= 0)
         return;
+    time += deltaTime;
 
-    if (!sprite)
+    if (mode == AnimationMode::Loop)
     {
-        sprite = object->GetComponent<SpriteComponent>();
-        if (!sprite)
+        while (time >= frameDuration)
         {
-            Log(LOG_ERROR, "Animator::OnUpdate() : SpriteComponent not found");
-            isLoad = false;
-            return;
+            frame = (frame + 1) % frameCount;
+            time -= frameDuration;
         }
     }
-
-    //   Log(LOG_INFO, "Animator::OnUpdate() : %s", object->name.c_str());
-
-    if (isPlaying)
+    else if (mode == AnimationMode::PingPong)
     {
-        Animation *animation = GetAnimation();
-        if (!animation)
-            return;
-        animation->Update(deltaTime, mode);
-
-        currentFrame = animation->currentFrame;
-        currentTime = animation->currentTime;
-        frameCount = animation->frameCount;
-        frameDuration = animation->frameDuration;
-        isReversed = animation->isReversed;
-
-        if (nextAnimation != "" && animation->currentFrame == animation->frameCount - 1)
+        if (frameCount < 2)
         {
-            currentAnimation = nextAnimation;
-            nextAnimation = "";
-            animation->currentFrame = 0;
-            animation->currentTime = 0;
-            Play();
+            frame = 0;
+            time = 0;
+            return;
         }
-        // verifica se a animação atual terminou de ser reproduzida
-        if (animation->currentFrame == animation->frameCount - 1)
+        int frameIndex = frame;
+        int frameIncrement = isReversed ? -1 : 1;
+
+        while (time >= frameDuration)
         {
-            if (mode == AnimationMode::Loop)
+            frameIndex += frameIncrement;
+
+            if (frameIndex < 0)
             {
-                animation->currentFrame = 0; // reinicia a animação
-                animation->currentTime = 0;
+                frameIndex = 1;
+                isReversed = false;
             }
-            else if (mode == AnimationMode::PingPong)
+            else if (frameIndex >= frameCount)
             {
-                animation->isReversed = true; // inverte a reprodução da animação
+                frameIndex = frameCount - 2;
+                isReversed = true;
             }
+
+            time -= frameDuration;
         }
 
-        // verifica se a animação atual terminou de ser reproduzida no modo PingPong
-        if (animation->currentFrame == 0 && animation->isReversed)
+        frame = frameIndex;
+    }
+    else if (mode == AnimationMode::Stop)
+    {
+        if (frame < frameCount - 1)
         {
-            if (mode == AnimationMode::PingPong)
+            while (time >= frameDuration)
             {
-                animation->isReversed = false; // inverte a reprodução da animação de volta
+                frame++;
+                time -= frameDuration;
             }
         }
     }
-
-    Animation *animation = GetAnimation();
-    if (!animation)
-        return;
-
-    if (sprite)
+    else if (mode == AnimationMode::Once)
     {
-
-        Rectangle frameRectangle = animation->GetFrame();
-        sprite->clip.x = frameRectangle.x;
-        sprite->clip.y = frameRectangle.y;
-        sprite->clip.width = frameRectangle.width;
-        sprite->clip.height = frameRectangle.height;
-        sprite->graph = animation->graph;
+        if (frame < frameCount - 1)
+        {
+            while (time >= frameDuration)
+            {
+                frame++;
+                time -= frameDuration;
+            }
+        }
     }
+    if (frame >= frameCount)
+        frame = frameCount - 1;
 }
 
-void Animator::Play()
-{
-    isPlaying = true;
-}
+//*********************************************************************************************************************
+//**                         Clip library                                                                           **
+//*********************************************************************************************************************
 
-void Animator::Pause()
+Animation *Assets::getClip(const std::string &name)
 {
-    isPlaying = false;
+    auto it = clips.find(name);
+    if (it != clips.end())
+    {
+        return it->second;
+    }
+    Log(LOG_WARNING, "Clip %s not found", name.c_str());
+    return nullptr;
 }
 
-void Animator::Stop()
+bool Assets::hasClip(const std::string &name)
 {
-    isPlaying = false;
-    if (animations.size() == 0 || !isLoad)
-        return;
-    Animation *animation = GetAnimation();
-    if (!animation)
-        return;
-
-    animation->currentFrame = 0;
-    animation->currentTime = 0;
+    return clips.find(name) != clips.end();
 }
 
-void Animator::SetAnimation(const std::string &name, bool now)
+Animation *Assets::addClip(const std::string &name, const std::string &graph, int rows, int columns, int frameCount, float framesPerSecond)
 {
-    if (animations.size() == 0 || !isLoad)
-        return;
-    if (now)
+    auto it = clips.find(name);
+    if (it != clips.end())
     {
-        currentAnimation = name;
-        nextAnimation = "";
-        Play();
+        return it->second;
     }
-    else if (currentAnimation != name)
+    if (framesPerSecond <= 0)
     {
-        if (nextAnimation == "")
-        {
-            nextAnimation = name; // marca a próxima animação a ser reproduzida
-        }
-        else
-        {
-            nextAnimation = name; // sobrescreve a próxima animação marcada
-        }
+        Log(LOG_ERROR, "Clip %s : invalid fps %f", name.c_str(), framesPerSecond);
+        return nullptr;
+    }
+    Animation *clip = new Animation(graph, rows, columns, frameCount, 1.0f / framesPerSecond);
+    // not kept when broken, a later call may find the graph loaded
+    if (!clip->IsValid())
+    {
+        delete clip;
+        return nullptr;
     }
+    clip->key = name;
+    clips[name] = clip;
+    return clip;
 }
-Animation *Animator::GetAnimation()
+
+Animation *Assets::sharedClip(const std::string &graph, int rows, int columns, int frameCount, float frameDuration)
 {
-    auto it = std::find_if(animations.begin(), animations.end(),
-                           [this](const std::pair<std::string, Animation *> &pair)
-                           {
-                               return pair.first == currentAnimation;
-                           });
-    if (it != animations.end())
+    // unnamed clips from animator:add are shared by their layout
+    std::string name = TextFormat("%s#%d#%d#%d#%.9g", graph.c_str(), rows, columns, frameCount, frameDuration);
+    auto it = clips.find(name);
+    if (it != clips.end())
     {
         return it->second;
     }
-    else
+    Animation *clip = new Animation(graph, rows, columns, frameCount, frameDuration);
+    if (!clip->IsValid())
     {
-
-        return animations.front().second;
+        delete clip;
+        return nullptr;
     }
+    clip->key = name;
+    clips[name] = clip;
+    return clip;
 }
 
-void Animator::AddAnimation(const std::string &name, Animation *animation)
+void Assets::clearClips()
 {
-    animations.push_back(std::make_pair(name, animation));
-    if (currentAnimation == "")
+    for (auto &clip : clips)
     {
-        currentAnimation = name;
+        delete clip.second;
     }
-    OnUpdate(0);
+    clips.clear();
 }
 
-void Animator::Add(const std::string &name, const std::string &graph, int rows, int columns, int frameCount, float framesPerSecond)
+static void skipPlistSpace(const char *&p)
 {
-    float frameDuration = 1.0f / framesPerSecond;
-    Animation *animation = new Animation(graph, rows, columns, frameCount, frameDuration);
-    AddAnimation(name, animation);
+    while (*p)
+    {
+        if (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        else if (strncmp(p, "<!--", 4) == 0)
+        {
+            const char *end = strstr(p, "-->");
+            p = end ? end + 3 : p + strlen(p);
+        }
+        else if (strncmp(p, "<?", 2) == 0 || strncmp(p, "<!", 2) == 0)
+        {
+            const char *end = strchr(p, '>');
+            p = end ? end + 1 : p + strlen(p);
+        }
+        else
+        {
+            break;
+        }
+    }
 }
 
-void Animator::SetMode(AnimationMode mode)
+static std::string readPlistText(const char *&p, const char *close)
 {
-    this->mode = mode;
-    if (animations.size() == 0 || !isLoad)
-        return;
-    Animation *animation = GetAnimation();
-    if (!animation)
-        return;
-    animation->currentFrame = 0;
-    animation->currentTime = 0;
-    animation->isReversed = false;
+    const char *end = strstr(p, close);
+    if (end == nullptr)
+        end = p + strlen(p);
+    std::string text(p, end - p);
+    p = *end ? end + strlen(close) : end;
+
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '&')
+        {
+            if (text.compare(i, 5, "&amp;") == 0) { out += '&'; i += 4; continue; }
+            if (text.compare(i, 4, "&lt;") == 0) { out += '<'; i += 3; continue; }
+            if (text.compare(i, 4, "&gt;") == 0) { out += '>'; i += 3; continue; }
+        }
+        out += text[i];
+    }
+    return out;
 }
-void Animator::OnInit()
+
+// plist xml to json, only the types sprite sheets use
+static json parsePlistValue(const char *&p)
 {
-    if (object != nullptr)
+    skipPlistSpace(p);
+    if (*p != '<')
+        return json();
+
+    const char *end = strchr(p, '>');
+    if (end == nullptr)
     {
-        if (object->HasComponent<SpriteComponent>())
+        p += strlen(p);
+        return json();
+    }
+    std::string tag(p + 1, end - p - 1);
+    p = end + 1;
+
+    bool empty = (!tag.empty() && tag[tag.size() - 1] == '/');
+    if (empty)
+        tag.erase(tag.size() - 1);
+    size_t space = tag.find(' ');
+    if (space != std::string::npos)
+        tag.erase(space);
+
+    if (tag == "true")
+        return json(true);
+    if (tag == "false")
+        return json(false);
+
+    if (tag == "dict")
+    {
+        json dict = json::object();
+        if (empty)
+            return dict;
+        while (*p)
         {
-            sprite = object->GetComponent<SpriteComponent>();
+            skipPlistSpace(p);
+            if (strncmp(p, "</dict>", 7) == 0)
+            {
+                p += 7;
+                break;
+            }
+            if (strncmp(p, "<key>", 5) != 0)
+            {
+                p += strlen(p);
+                break;
+            }
+            p += 5;
+            std::string key = readPlistText(p, "</key>");
+            dict[key] = parsePlistValue(p);
         }
-        else
+        return dict;
+    }
+    if (tag == "array")
+    {
+        json array = json::array();
+        if (empty)
+            return array;
+        while (*p)
         {
-            Log(LOG_ERROR, "SpriteComponent::OnInit() : GameObject has no SpriteComponent");
-            isLoad = false;
+            skipPlistSpace(p);
+            if (strncmp(p, "</array>", 8) == 0)
+            {
+                p += 8;
+                break;
+            }
+            array.push_back(parsePlistValue(p));
         }
+        return array;
+    }
+    if (empty)
+        return json();
+    if (tag == "string")
+        return json(readPlistText(p, "</string>"));
+    if (tag == "integer")
+        return json(atol(readPlistText(p, "</integer>").c_str()));
+    if (tag == "real")
+        return json(atof(readPlistText(p, "</real>").c_str()));
+    if (tag == "plist")
+    {
+        json root = parsePlistValue(p);
+        readPlistText(p, "</plist>");
+        return root;
     }
+
+    Log(LOG_WARNING, "Plist tag %s not supported", tag.c_str());
+    readPlistText(p, (std::string("</") + tag + ">").c_str());
+    return json();
 }
 
-void Animator::OnDebug()
+// "{{x, y}, {w, h}}"
+static bool parseSheetRect(const json &value, Rectangle &rect)
 {
-    // Log(LOG_INFO, "Animator::OnDebug()");
+    if (value.is_object())
+    {
+        rect.x = value.value("x", 0.0f);
+        rect.y = value.value("y", 0.0f);
+        rect.width = value.value("w", 0.0f);
+        rect.height = value.value("h", 0.0f);
+        return true;
+    }
+    if (!value.is_string())
+        return false;
+    std::string text = value.get<std::string>();
+    return sscanf(text.c_str(), " { { %f , %f } , { %f , %f } }", &rect.x, &rect.y, &rect.width, &rect.height) == 4;
 }
 
-//*********************************************************************************************************************
-//**                         GameObject                                                                              **
-//*********************************************************************************************************************
-
-static unsigned long NewGameObjectID()
-{
-    static unsigned long id = 0;
-    return id++;
-}
-
-GameObject::GameObject() : name("GameObject"),
-                           alive(true), visible(true), active(true),
-                           layer(1), script(nullptr)
+struct SheetFrame
 {
-    // Log(LOG_INFO, "GameObject created");
-    parent = nullptr;
-    id = NewGameObjectID();
-    transform = new TransformComponent(this);
-    UpdateWorld();
-    bound.x = 0;
-    bound.y = 0;
-    width = 1;
-    height = 1;
-    originX = 0;
-    originY = 0;
-    solid = false;
-    prefab = false;
-    persistent = false;
-    collidable = true;
-    pickable = false;
-
-    word_position.x = transform->position.x;
-    word_position.y = transform->position.y;
-
-    layer = 0;
-    scriptName = "";
-    _x = 0;
-    _y = 0;
-    table_ref = LUA_NOREF;
-    debugMask = 0;
-}
+    std::string clip;
+    long number; // trailing number of the frame name, -1 without one
+    std::string name;
+    Rectangle rect;
+};
 
-GameObject::GameObject(const std::string &Name) : GameObject()
+// run_01.png -> run, number 1
+static std::string sheetClipName(const std::string &frameName, long *number)
 {
-
-    name = Name;
+    std::string name = frameName;
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos)
+        name.erase(dot);
+    size_t digits = name.size();
+    while (digits > 0 && isdigit((unsigned char)name[digits - 1]))
+        digits--;
+    *number = digits < name.size() ? atol(name.c_str() + digits) : -1;
+    name.erase(digits);
+    while (!name.empty() && (name[name.size() - 1] == '_' || name[name.size() - 1] == '-'))
+        name.erase(name.size() - 1);
+    return name.empty() ? frameName : name;
 }
 
-GameObject::GameObject(const std::string &Name, int layer) : GameObject()
+static bool compareSheetFrames(const SheetFrame &a, const SheetFrame &b)
 {
-    this->layer = layer;
-    name = Name;
+    if (a.clip != b.clip)
+        return a.clip < b.clip;
+    if (a.number != b.number)
+        return a.number < b.number;
+    return a.name < b.name;
 }
 
-void GameObject::OnReady()
-{
-
-    // Log(LOG_INFO, "GameObject::OnReady()");
-    if (script != nullptr)
-        script->callOnReady();
-}
-void GameObject::OnPause()
+int Assets::loadClips(const std::string &filepath, float framesPerSecond)
 {
-    if (script != nullptr)
-        script->callOnPause();
-}
+    if (framesPerSecond <= 0)
+    {
+        Log(LOG_ERROR, "Clips %s : invalid fps %f", filepath.c_str(), framesPerSecond);
+        return 0;
+    }
+    std::string path = VirtualFS::Instance().Exists(filepath) ? filepath : GetPath(filepath);
+    if (!VirtualFS::Instance().Exists(path))
+    {
+        Log(LOG_ERROR, "Failed to load clips %s", filepath.c_str());
+        return 0;
+    }
 
-void GameObject::OnRemove()
-{
-    if (script != nullptr)
-        script->callOnRemove();
-}
+    char *text = LoadAssetText(path.c_str());
+    if (text == nullptr)
+        return 0;
 
-void GameObject::Encapsulate(float x, float y)
-{
-    if (bbReset)
+    json doc;
+    if (IsFileExtension(path.c_str(), ".plist"))
     {
-        x1 = x2 = x;
-        y1 = y2 = y;
-        bbReset = false;
+        const char *p = text;
+        doc = parsePlistValue(p);
     }
     else
     {
-        if (x < x1)
-            x1 = x;
-        if (x > x2)
-            x2 = x;
-        if (y < y1)
-            y1 = y;
-        if (y > y2)
-            y2 = y;
-
-        bound.x = x1;
-        bound.y = y1;
-        bound.width = (x2 - x1);
-        bound.height = (y2 - y1);
+        doc = json::parse(text, nullptr, false);
     }
-}
+    UnloadAssetText(text);
 
-void GameObject::LiveReload()
-{
-    if (script != nullptr)
+    if (!doc.is_object() || !doc.contains("frames"))
     {
-        long time = GetFileModTime(script->script.c_str());
+        Log(LOG_ERROR, "Clips %s has no frames", path.c_str());
+        return 0;
+    }
 
-        //   Log(LOG_INFO, "Script %s time now %d  old %d ", script->script.c_str(), time, script->timeLoad);
+    std::string image;
+    if (doc.contains("meta") && doc["meta"].is_object())
+        image = doc["meta"].value("image", "");
+    if (image.empty() && doc.contains("metadata") && doc["metadata"].is_object())
+        image = doc["metadata"].value("textureFileName", doc["metadata"].value("realTextureFileName", ""));
+    if (image.empty())
+        image = std::string(GetFileNameWithoutExt(path.c_str())) + ".png";
+
+    std::string graphKey = GetFileNameWithoutExt(image.c_str());
+    std::string imagePath = std::string(GetDirectoryPath(path.c_str())) + "/" + image;
+    if (loadGraph(graphKey, imagePath) == nullptr)
+        return 0;
 
-        if (script->timeLoad < time)
+    std::vector<SheetFrame> frames;
+    bool rotated = false;
+    const json &list = doc["frames"];
+    for (auto it = list.begin(); it != list.end(); ++it)
+    {
+        const json &frame = it.value();
+        std::string name = list.is_object() ? it.key() : frame.value("filename", "");
+        Rectangle rect;
+        if (frame.contains("frame") && parseSheetRect(frame["frame"], rect))
+        {
+        }
+        else if (frame.contains("textureRect") && parseSheetRect(frame["textureRect"], rect))
+        {
+        }
+        else if (frame.contains("width"))
+        {
+            rect.x = frame.value("x", 0.0f);
+            rect.y = frame.value("y", 0.0f);
+            rect.width = frame.value("width", 0.0f);
+            rect.height = frame.value("height", 0.0f);
+        }
+        else
         {
-            script->watch = true;
-            Log(LOG_INFO, "Reloading script %s", script->script.c_str());
-            script->Reload();
-            //  script->timeLoad = GetFileModTime(script->script.c_str());
+            continue;
         }
+        if (frame.value("rotated", false) || frame.value("textureRotated", false))
+            rotated = true;
+        SheetFrame sheetFrame;
+        sheetFrame.clip = sheetClipName(name, &sheetFrame.number);
+        sheetFrame.name = name;
+        sheetFrame.rect = rect;
+        frames.push_back(sheetFrame);
     }
-    for (auto &c : children)
+    if (rotated)
+        Log(LOG_WARNING, "Clips %s has rotated frames, they are drawn as stored", path.c_str());
+
+    // frames are grouped by name without the trailing number (run_01.png, run_02.png -> run),
+    // in numeric order so run10 plays after run9
+    std::sort(frames.begin(), frames.end(), compareSheetFrames);
+    std::map<std::string, std::vector<Rectangle>> groups;
+    for (auto &frame : frames)
+    {
+        groups[frame.clip].push_back(frame.rect);
+    }
+
+    int count = 0;
+    for (auto &group : groups)
     {
-        c->LiveReload();
+        if (clips.find(group.first) != clips.end())
+            continue;
+        Animation *clip = new Animation(graphKey, group.second, 1.0f / framesPerSecond);
+        if (!clip->IsValid())
+        {
+            delete clip;
+            continue;
+        }
+        clip->key = group.first;
+        clips[group.first] = clip;
+        count++;
     }
+    Log(LOG_INFO, "Clips %s loaded %d clips from %d frames", path.c_str(), count, (int)frames.size());
+    return count;
 }
 
-Vector2 ApplyMatrixToPoint(const Matrix2D &matrix, float x, float y)
+//*********************************************************************************************************************
+//**                         Texture streaming                                                                      **
+//*********************************************************************************************************************
+
+struct StreamJob
 {
-    Vector2 transformedPoint;
-    transformedPoint.x = x * matrix.a + y * matrix.c + matrix.tx;
-    transformedPoint.y = x * matrix.b + y * matrix.d + matrix.ty;
+    std::string key;
+    std::string path;
+    unsigned int generation;
+};
 
-    return transformedPoint;
-}
+struct StreamResult
+{
+    std::string key;
+    Image image;
+};
 
-void GameObject::UpdateWorld()
+// decodes images on worker threads, GL uploads stay on the main thread
+class TextureStreamer
 {
-    Matrix2D mat = transform->GetWorldTransformation();
-    word_position = mat.TransformCoords();
+public:
+    TextureStreamer() : quit(false), generation(0) {}
+    ~TextureStreamer() { Stop(); }
 
-    float w = width  *  transform->scale.x;
-    float h = height *  transform->scale.y;
-    radius = std::min(w, h) / 2.0f;
+    void Push(const std::string &key, const std::string &path)
+    {
+        if (workers.empty())
+            Start();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            StreamJob job;
+            job.key = key;
+            job.path = path;
+            job.generation = generation;
+            jobs.push_back(job);
+        }
+        jobsReady.notify_one();
+    }
 
-    bbReset = true;
-    float newX = word_position.x;
-    float newY = word_position.y;
-    const auto tx1 = 0;
-    const auto ty1 = 0;
-    const auto tx2 = w;
-    const auto ty2 = h;
+    bool Pop(StreamResult &result)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done.empty())
+            return false;
+        result = done.front();
+        done.pop_front();
+        return true;
+    }
 
-    if (GetWorldAngle() != 0.0f)
+    // jobs already decoding finish, their results are dropped by generation
+    void Cancel()
     {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        jobs.clear();
+        for (auto &result : done)
+        {
+            if (result.image.data != nullptr)
+                UnloadAssetImage(result.image);
+        }
+        done.clear();
+    }
 
-        const auto cost = cosf(-GetWorldAngle() * DEG2RAD);
-        const auto sint = sinf(-GetWorldAngle() * DEG2RAD);
+    void Stop()
+    {
+        if (workers.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        jobsReady.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+        workers.clear();
+        quit = false;
+        Cancel();
+    }
 
-        Encapsulate(tx1 * cost - ty1 * sint + newX, tx1 * sint + ty1 * cost + newY);
-        Encapsulate(tx2 * cost - ty1 * sint + newX, tx2 * sint + ty1 * cost + newY);
-        Encapsulate(tx2 * cost - ty2 * sint + newX, tx2 * sint + ty2 * cost + newY);
-        Encapsulate(tx1 * cost - ty2 * sint + newX, tx1 * sint + ty2 * cost + newY);
+private:
+    void Start()
+    {
+        int count = (int)std::thread::hardware_concurrency() - 1;
+        if (count < 1)
+            count = 1;
+        if (count > 4)
+            count = 4;
+        for (int i = 0; i < count; i++)
+            workers.push_back(std::thread(&TextureStreamer::Run, this));
+        Log(LOG_INFO, "Texture streaming started with %d workers", count);
     }
-    else
+
+    void Run()
     {
+        for (;;)
+        {
+            StreamJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobsReady.wait(lock, [this]
+                               { return quit || !jobs.empty(); });
+                if (quit)
+                    return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
 
-        Encapsulate(tx1 + newX, ty1 + newY);
-        Encapsulate(tx2 + newX, ty1 + newY);
-        Encapsulate(tx2 + newX, ty2 + newY);
-        Encapsulate(tx1 + newX, ty2 + newY);
+            StreamResult result;
+            result.key = job.key;
+            result.image = LoadAssetImage(job.path.c_str());
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job.generation != generation)
+            {
+                if (result.image.data != nullptr)
+                    UnloadAssetImage(result.image);
+                continue;
+            }
+            done.push_back(result);
+        }
     }
 
-    for (auto &c : children)
+    std::vector<std::thread> workers;
+    std::deque<StreamJob> jobs;
+    std::deque<StreamResult> done;
+    std::mutex mutex;
+    std::condition_variable jobsReady;
+    bool quit;
+    unsigned int generation; // bumped by Cancel
+};
+
+static TextureStreamer textureStreamer;
+static Texture2D streamPlaceholder = {};
+
+static void CallStreamCallback(int callback, const std::string &key, bool ok)
+{
+    lua_State *L = getState();
+    if (L == nullptr || callback == LUA_NOREF || callback == LUA_REFNIL)
+        return;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, callback);
+    luaL_unref(L, LUA_REGISTRYINDEX, callback);
+    if (!lua_isfunction(L, -1))
     {
-        c->UpdateWorld();
+        lua_pop(L, 1);
+        return;
     }
-}
-void GameObject::OnCollision(GameObject *other)
-{
-
-    if (script != nullptr)
+    lua_pushstring(L, key.c_str());
+    lua_pushboolean(L, ok);
+    if (lua_pcall(L, 2, 0, 0) != LUA_OK)
     {
-        script->callOnCollide(other);
+        Log(LOG_ERROR, "[loadGraphAsync] %s : %s", key.c_str(), lua_tostring(L, -1));
+        lua_pop(L, 1);
     }
-    // Log(LOG_INFO, "OnColide %s with %s ", name.c_str(), other->name.c_str());
 }
 
-void GameObject::sendMensageAll()
+Graph *Assets::loadGraphAsync(const std::string &key, const std::string &filepath, int callback)
 {
-    if (!scene)
-        return;
-
-    for (auto &c : scene->gameObjects)
+    auto it = graphs.find(key);
+    if (it != graphs.end())
     {
-        if (c == this)
-            continue;
-        if (!c->alive)
-            continue;
-        if (c->script != nullptr)
+        Graph *graph = it->second;
+        graph->lastUse = cacheClock;
+        graph->failed = false;
+        if (graph->evicted)
+        {
+            // evicted textures come back through the workers too
+            graph->evicted = false;
+            streamPending++;
+            textureStreamer.Push(key, graph->filename);
+            cacheMisses++;
+        }
+        else if (graph->ready)
+        {
+            cacheHits++;
+        }
+        if (callback != LUA_NOREF)
         {
-            c->script->callOnMessage();
+            if (graph->ready)
+                streamNotify.push_back({key, callback, true});
+            else
+                streamCallbacks[key].push_back(callback);
         }
+        return graph;
     }
 
-    for (auto &c : children)
+    std::string path = findGraph(filepath);
+    if (path.empty())
     {
-        c->sendMensageAll();
+        Log(LOG_ERROR, "Failed to load  image %s", filepath.c_str());
+        if (callback != LUA_NOREF)
+            streamNotify.push_back({key, callback, false});
+        return nullptr;
     }
-}
 
-void GameObject::setDebug(int mask)
-{
-    debugMask = mask;
+    if (streamPlaceholder.id == 0)
+    {
+        Image image = GenImageColor(1, 1, BLANK);
+        streamPlaceholder = LoadTextureFromImage(image);
+        UnloadImage(image);
+    }
+
+    // the real size comes from the file header so sprites get the right clip now
+    Graph *graph = new Graph();
+    graph->key = key;
+    graph->filename = path;
+    graph->texture = streamPlaceholder;
+    graph->ready = false;
+    graph->lastUse = cacheClock;
+    cacheMisses++;
+    if (!GetImageFileSize(path.c_str(), &graph->width, &graph->height))
+    {
+        graph->width = streamPlaceholder.width;
+        graph->height = streamPlaceholder.height;
+    }
+    graphs[key] = graph;
+
+    if (callback != LUA_NOREF)
+        streamCallbacks[key].push_back(callback);
+    streamPending++;
+    textureStreamer.Push(key, path);
+    return graph;
 }
 
-void GameObject::sendMensageTo(const std::string &name)
+void Assets::updateStreaming()
 {
-    if (!scene)
-        return;
+    if (!streamNotify.empty())
+    {
+        std::vector<StreamNotify> notify;
+        notify.swap(streamNotify);
+        for (auto &n : notify)
+            CallStreamCallback(n.callback, n.key, n.ok);
+    }
 
-    for (auto &c : scene->gameObjects)
+    double start = GetTime();
+    StreamResult result;
+    while (textureStreamer.Pop(result))
     {
-        if (!c->alive)
+        auto it = graphs.find(result.key);
+        if (it == graphs.end() || it->second->ready)
+        {
+            if (result.image.data != nullptr)
+                UnloadAssetImage(result.image);
             continue;
-        if (c->name == name)
+        }
+
+        Graph *graph = it->second;
+        bool ok = result.image.data != nullptr;
+        streamPending--;
+        if (ok)
         {
-            if (c->script != nullptr)
-            {
-                c->script->callOnMessage();
-            }
+            graph->texture = LoadTextureFromImage(result.image);
+            UnloadAssetImage(result.image);
+            graph->width = graph->texture.width;
+            graph->height = graph->texture.height;
+            graph->bytes = GetPixelDataSize(graph->texture.width, graph->texture.height, graph->texture.format);
+            graph->ready = true;
+            trackTexture(graph->bytes);
+            trimGraphs();
+        }
+        else
+        {
+            // stays on the placeholder; getGraph reports it, a new load tries again
+            Log(LOG_ERROR, "Failed to decode image %s", graph->filename.c_str());
+            graph->evicted = true;
+            graph->failed = true;
         }
-    }
 
-    for (auto &c : children)
-    {
-        c->sendMensageTo(name);
+        auto cb = streamCallbacks.find(result.key);
+        if (cb != streamCallbacks.end())
+        {
+            std::vector<int> callbacks;
+            callbacks.swap(cb->second);
+            streamCallbacks.erase(cb);
+            for (int callback : callbacks)
+                CallStreamCallback(callback, result.key, ok);
+        }
+
+        if (GetTime() - start >= streamBudget)
+            break;
     }
 }
 
-void GameObject::Update(float dt)
+void Assets::cancelStreaming()
 {
-    if (script != nullptr)
+    textureStreamer.Cancel();
+    lua_State *L = getState();
+    if (L != nullptr)
     {
-        if (!script->callOnReadyDone)
-        {
-            OnReady();
-        }
+        for (auto &cb : streamCallbacks)
+            for (int callback : cb.second)
+                luaL_unref(L, LUA_REGISTRYINDEX, callback);
+        for (auto &n : streamNotify)
+            luaL_unref(L, LUA_REGISTRYINDEX, n.callback);
     }
-    if (solid)
-        return;
-
-    UpdateWorld();
+    streamCallbacks.clear();
+    streamNotify.clear();
+    streamPending = 0;
 
-    if (script != nullptr)
-        script->callOnUpdate(dt);
-
-    for (auto &c : m_components)
+    // graphs still waiting come back through the next lookup or load
+    for (auto &it : graphs)
     {
-        c->OnUpdate(dt);
+        Graph *graph = it.second;
+        if (!graph->ready && !graph->evicted)
+            graph->evicted = true;
     }
+}
 
-    for (auto &c : children)
+void Assets::stopStreaming()
+{
+    cancelStreaming();
+    textureStreamer.Stop();
+    if (streamPlaceholder.id != 0)
     {
-        c->Update(dt);
+        UnloadTexture(streamPlaceholder);
+        streamPlaceholder = Texture2D();
     }
 }
 
-bool GameObject::place_free(float x, float y)
+//*********************************************************************************************************************
+//**                         Graph cache                                                                            **
+//*********************************************************************************************************************
+
+Graph *Assets::retainGraph(const std::string &key)
 {
-    if (!scene)
-        return true;
-    return scene->place_free(this, x, y);
+    Graph *graph = getGraph(key);
+    if (graph != nullptr)
+        graph->refCount++;
+    return graph;
 }
 
-bool GameObject::place_meeting(float x, float y, const std::string &name)
+void Assets::retainGraph(Graph *graph)
 {
-    if (!scene)
-        return false;
-    return scene->place_meeting(this, x, y, name);
+    if (graph == nullptr)
+        return;
+    if (graph->evicted)
+        touchGraph(graph);
+    graph->refCount++;
 }
 
-bool GameObject::place_meeting_layer(float x, float y, int layer)
+void Assets::releaseGraph(Graph *graph)
 {
-
-    if (!scene)
-        return false;
-    return scene->place_meeting_layer(this, x, y, layer);
+    if (graph == nullptr)
+        return;
+    if (graph->refCount > 0)
+        graph->refCount--;
+    if (graph->refCount == 0)
+    {
+        if (graph->dropped)
+            unloadGraph(graph->key);
+        else
+            trimGraphs();
+    }
 }
 
-bool GameObject::collideWith(GameObject *e, float x, float y)
+void Assets::touchGraph(Graph *graph)
 {
-    if (!scene || !e)
-        return false;
-    if (e == this)
-        return false;
-
-    _x = this->transform->position.x;
-    _y = this->transform->position.y;
-    this->transform->position.x = x;
-    this->transform->position.y = y;
+    // a lookup, hits are counted where a graph is requested
+    graph->lastUse = cacheClock;
+    if (!graph->evicted || graph->failed)
+        return;
 
-    if (
-        x - this->getWorldOriginX() + width > e->getWorldX() - e->getWorldOriginX() &&
-        y - this->getWorldOriginY() + height > e->getWorldY() - e->getWorldOriginY() &&
-        x - this->getWorldOriginX() < e->getWorldX() - e->getWorldOriginX() + e->width &&
-        y - this->getWorldOriginY() < e->getWorldY() - e->getWorldOriginY() + e->height)
+    // evicted earlier, reload it in place so every holder sees the new texture
+    cacheMisses++;
+    Image image = LoadAssetImage(graph->filename.c_str());
+    if (image.data == nullptr)
     {
-        this->transform->position.x = _x;
-        this->transform->position.y = _y;
-        OnCollision(e);
-        e->OnCollision(this);
-        return true;
+        Log(LOG_ERROR, "Failed to reload image %s", graph->filename.c_str());
+        return;
     }
-    this->transform->position.x = _x;
-    this->transform->position.y = _y;
-    return false;
+    graph->texture = LoadTextureFromImage(image);
+    UnloadAssetImage(image);
+    graph->width = graph->texture.width;
+    graph->height = graph->texture.height;
+    graph->bytes = GetPixelDataSize(graph->texture.width, graph->texture.height, graph->texture.format);
+    graph->ready = true;
+    graph->evicted = false;
+    trackTexture(graph->bytes);
+    trimGraphs();
 }
 
-void GameObject::centerPivot()
+void Assets::evictGraph(Graph *graph)
 {
+    if (!graph->ready || graph->refCount > 0)
+        return;
+    UnloadTexture(graph->texture);
+    graph->texture = Texture2D();
+    graph->ready = false;
+    graph->evicted = true;
+    trackTexture(-graph->bytes);
+    cacheEvictions++;
+}
 
-    if (HasComponent<SpriteComponent>())
-    {
-        auto sprite = GetComponent<SpriteComponent>();
-        transform->pivot.x = sprite->clip.width / 2.0f;
-        transform->pivot.y = sprite->clip.height / 2.0;
-        //  Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
-        // Log(LOG_INFO, "Size %s set to %f %f", name.c_str(), sprite->clip.width, sprite->clip.height);
-    }
+void Assets::trackTexture(long long bytes)
+{
+    textureBytes += bytes;
+    if (bytes > 0)
+        addMemory((std::size_t)bytes);
     else
-    {
+        removeMemory((std::size_t)-bytes);
+}
 
-        transform->pivot.x = (width / 2.0f);
-        transform->pivot.y = (height / 2.0f);
-        // Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
+void Assets::trimGraphs()
+{
+    if (textureBudget <= 0)
+        return;
+    while (textureBytes > textureBudget)
+    {
+        Graph *oldest = nullptr;
+        for (auto &it : graphs)
+        {
+            Graph *graph = it.second;
+            // drawn this frame: the batch may still hold the texture id
+            if (graph->refCount > 0 || !graph->ready || graph->lastUse == cacheClock)
+                continue;
+            if (oldest == nullptr || graph->lastUse < oldest->lastUse)
+                oldest = graph;
+        }
+        if (oldest == nullptr)
+            break;
+        evictGraph(oldest);
     }
 }
 
-void GameObject::centerOrigin()
+void Assets::setTextureBudget(long long bytes)
 {
+    textureBudget = bytes;
+    trimGraphs();
+}
 
-    if (HasComponent<SpriteComponent>())
+void Assets::unloadGraph(const std::string &key)
+{
+    auto it = graphs.find(key);
+    if (it == graphs.end())
+        return;
+
+    Graph *graph = it->second;
+    if (graph->refCount > 0)
     {
-        auto sprite = GetComponent<SpriteComponent>();
-        width = (int)sprite->clip.width / 2 * transform->scale.x;
-        height = (int)sprite->clip.height / 2 * transform->scale.y;
-        originX = -(int)(width / 2.0f) + (width / 2.0f);
-        originY = -(int)(height / 2.0f) + (height / 2.0f);
+        Log(LOG_WARNING, "Graph %s still in use, unloaded on last release", key.c_str());
+        graph->dropped = true;
+        return;
     }
-    else
+
+    if (graph->ready)
+    {
+        UnloadTexture(graph->texture);
+        trackTexture(-graph->bytes);
+    }
+    else if (!graph->evicted)
     {
+        streamPending--;
+    }
 
-        originX = (width / 2.0f);
-        originY = (height / 2.0f);
-        // Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
+    auto cb = streamCallbacks.find(key);
+    if (cb != streamCallbacks.end())
+    {
+        for (int callback : cb->second)
+            CallStreamCallback(callback, key, false);
+        streamCallbacks.erase(key);
     }
+
+    graphs.erase(it);
+    delete graph;
 }
 
-void GameObject::Debug()
-{
+//*********************************************************************************************************************
+//**                         ANIMATOR                                                                               **
+//*********************************************************************************************************************
 
-    if (!debugMask)
-        return;
+Animator::Animator() : Component(), current(-1), next(-1),
+                       frame(0), time(0),
+                       isPlaying(true), isReversed(false), isLoad(true),
+                       mode(AnimationMode::Loop)
+{
+    sprite = nullptr;
+    object = nullptr;
+}
 
-    bool isOriginEnabled = (debugMask & SHOW_ORIGIN) != 0;
-    bool isBoxCollideEnabled = (debugMask & SHOW_BOX) != 0;
+void Animator::OnDestroy()
+{
+    // clips belong to the assets library
+    animations.clear();
+}
 
-    float finalRad = radius / 4.0f;
-    if (finalRad < 0.5f)
-        finalRad = 0.5f;
+Component *Animator::Clone() const
+{
+    // sprite is pointed at the copy's own sprite by GameObject::Clone
+    Animator *copy = new Animator(*this);
+    copy->sprite = nullptr;
+    return copy;
+}
 
-    if (script != nullptr)
+namespace BindAnimator
+{
+    static int SetAnimation(lua_State *L)
     {
-        if (!script->callOnReadyDone)
-            return;
-    }
 
-    int bX = (int)getX();
-    int bY = (int)getY();
+        if (lua_gettop(L) <= 1)
+        {
+            return luaL_error(L, "setAnimation function requires 1/2 arguments");
+        }
+        Animator *animator = nullptr;
 
-    int cx = bX + originX;
-    int cy = bY + originY;
-    int cw = width ;
-    int ch = height ;
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
 
-    if (isBoxCollideEnabled)
-        DrawRectangleLines( cx,  cy, cw , ch , WHITE);
-    if (isOriginEnabled)
-        DrawCircle(cx, cy, finalRad, WHITE);
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[setAnimation] animator is null");
+            }
 
-    if (!solid)
-    {
+            const char *name = lua_tostring(L, 2);
+            bool now = false;
 
-        Vec2 p;
-        if (!parent)
-            p = GetLocalPoint(transform->pivot.x, transform->pivot.y);
+            if (lua_gettop(L) == 3)
+            {
+                now = lua_toboolean(L, 3);
+            }
+
+            animator->SetAnimation(name, now);
+        }
         else
-            p = GetWorldPoint(transform->pivot.x, transform->pivot.y);
+        {
+            return luaL_error(L, "setAnimation Invalid argument type, expected table");
+        }
 
-        bool isPivotEnabled = (debugMask & SHOW_PIVOT) != 0;
-        bool isTrasnformEnabled = (debugMask & SHOW_TRANSFORM) != 0;
+        return 0;
+    }
 
-        if (isPivotEnabled)
-            DrawCircle((int)p.x, (int)p.y, finalRad, LIME);
+    static int SetMode(lua_State *L)
+    {
 
-        float newX = word_position.x;
-        float newY = word_position.y;
-        const auto tx1 = 0;
-        const auto ty1 = 0;
-        const auto tx2 = width  * 2.0f * transform->scale.x;
-        const auto ty2 = height * 2.0f * transform->scale.y;
+        if (lua_gettop(L) != 2)
+        {
+            return luaL_error(L, "setMode function requires 1 arguments");
+        }
+        Animator *animator = nullptr;
 
-        if (isTrasnformEnabled)
+        if (lua_istable(L, 1))
         {
-            if (GetWorldAngle() != 0.0f)
+
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
             {
+                return luaL_error(L, "[setMode] animator is null");
+            }
 
-                const auto cost = cosf(-GetWorldAngle() * DEG2RAD);
-                const auto sint = sinf(-GetWorldAngle() * DEG2RAD);
-                float x1 = tx1 * cost - ty1 * sint + newX;
-                float y1 = tx1 * sint + ty1 * cost + newY;
-                float x2 = tx2 * cost - ty1 * sint + newX;
-                float y2 = tx2 * sint + ty1 * cost + newY;
-                float x3 = tx2 * cost - ty2 * sint + newX;
-                float y3 = tx2 * sint + ty2 * cost + newY;
-                float x4 = tx1 * cost - ty2 * sint + newX;
-                float y4 = tx1 * sint + ty2 * cost + newY;
-                DrawLine(x1, y1, x2, y2, LIME);
-                DrawLine(x1, y1, x4, y4, LIME);
-                DrawLine(x3, y3, x4, y4, LIME);
-                DrawLine(x2, y2, x3, y3, LIME);
+            int m = lua_tointeger(L, 2);
+            AnimationMode mode = AnimationMode::Loop;
+            if (m == 0)
+            {
+                mode = AnimationMode::Loop;
             }
-            else
+            else if (m == 1)
             {
-                DrawLine(tx1 + newX, ty1 + newY, tx2 + newX, ty1 + newY, LIME);
-                DrawLine(tx1 + newX, ty1 + newY, tx1 + newX, ty2 + newY, LIME);
-                DrawLine(tx2 + newX, ty2 + newY, tx1 + newX, ty2 + newY, LIME);
-                DrawLine(tx2 + newX, ty2 + newY, tx2 + newX, ty1 + newY, LIME);
+                mode = AnimationMode::PingPong;
+            }
+            else if (m == 2)
+            {
+                mode = AnimationMode::Stop;
+            }
+            else if (m == 3)
+            {
+                mode = AnimationMode::Once;
             }
+            animator->SetMode(mode);
         }
-    }
-
-    bool isComponentsEnable = (debugMask & SHOW_COMPONENTS) != 0;
-    bool isBoundEnable = (debugMask & SHOW_BOUND) != 0;
-
-    if (isBoundEnable)
-        DrawRectangleLinesEx(bound, 1.5f, MAGENTA);
-
-    if (isComponentsEnable)
-    {
-        for (auto &c : m_components)
+        else
         {
-            c->OnDebug();
+            return luaL_error(L, "setMode Invalid argument type, expected table");
         }
-    }
 
-    for (auto &c : children)
-    {
-        c->Debug();
+        return 0;
     }
-}
-void GameObject::Render()
-{
 
-    if (script != nullptr && !solid)
+    static int Play(lua_State *L)
     {
-        if (!script->callOnReadyDone)
-            return;
-     }
 
+        Animator *animator = nullptr;
 
-    for (auto &c : m_components)
-    {
-        c->OnDraw();
-    }
-
-    if (script != nullptr && !solid)
-    {
-        script->callOnRender();
-    }
-    for (auto &c : children)
-    {
-        c->Render();
-    }
-
-    // Log(LOG_INFO, "Render %s %f %f", name.c_str(),getX(),getY());
-}
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
 
-GameObject::~GameObject()
-{
-    // Log(LOG_INFO, "[CPP] GameObject (%s) destroyed", name.c_str());
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[play] animator is null");
+            }
 
-    for (auto &c : m_components)
-    {
-        if (c)
-        {
-            c->OnDestroy();
-            delete c;
+            animator->Play();
         }
-    }
-
-    for (auto &c : children)
-    {
-        if (c)
+        else
         {
-            delete c;
+            return luaL_error(L, "play Invalid argument type, expected table");
         }
-    }
-    children.clear();
-
-    if (table_ref != LUA_NOREF)
-    {
-        luaL_unref(getState(), LUA_REGISTRYINDEX, table_ref);
+        return 0;
     }
 
-    if (script != nullptr)
+    static int Stop(lua_State *L)
     {
-        delete script;
-    }
-}
-
-Vec2 GameObject::GetWorldPoint(float _x, float _y)
-{
-
-    return transform->wordl_transform.TransformCoords(Vec2(_x, _y));
-}
-
-Vec2 GameObject::GetWorldPoint(Vec2 p)
-{
-    return transform->wordl_transform.TransformCoords(p);
-}
 
-Vec2 GameObject::GetLocalPoint(Vec2 p)
-{
-    return transform->local_transform.TransformCoords(p);
-}
+        Animator *animator = nullptr;
 
-Vec2 GameObject::GetLocalPoint(float x, float y)
-{
-    return transform->local_transform.TransformCoords(Vec2(x, y));
-}
+        if (lua_istable(L, 1))
+        {
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
 
-void GameObject::createScript(const char *lua, lua_State *L)
-{
-    scriptName = lua;
-    std::string path = "";
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[stop] animator is null");
+            }
 
-    if (table_ref == LUA_NOREF)
-    {
-        BindLua(L);
+            animator->Stop();
+        }
+        else
+        {
+            return luaL_error(L, "stop Invalid argument type, expected table");
+        }
+        return 0;
     }
 
-    //
-    if (FileExists(lua))
-    {
-        path = lua;
-    }
-    else if (FileExists(TextFormat("%s.lua", lua)))
-    {
-        path = TextFormat("%s.lua", lua);
-    }
-    else if (FileExists(TextFormat("assets/%s.lua", lua)))
-    {
-        path = TextFormat("assets/%s.lua", lua);
-    }
-    else if (FileExists(TextFormat("../assets/%s.lua", lua)))
-    {
-        path = TextFormat("../assets/%s.lua", lua);
-    }
-    else if (FileExists(TextFormat("assets/scripts/%s", lua)))
-    {
-        path = TextFormat("assets/scripts/%s", lua);
-    }
-    else if (FileExists(TextFormat("../assets/scripts/%s", lua)))
-    {
-        path = TextFormat("../assets/scripts/%s", lua);
-    }
-    else if (FileExists(TextFormat("assets/scripts/%s.lua", lua)))
-    {
-        path = TextFormat("../assets/scripts/%s.lua", lua);
-    }
-    else if (FileExists(TextFormat("../assets/scripts/%s.lua", lua)))
-    {
-        path = TextFormat("../assets/scripts/%s.lua", lua);
-    }
-    else
+    static int Pause(lua_State *L)
     {
-        Log(LOG_ERROR, "Script %s not found", lua);
-        return;
-    }
-
-    new ScriptComponent(this, path.c_str(), L);
-}
-
-GameObject *GameObject::addChild(GameObject *e)
-{
-    children.push_back(e);
-    e->parent = this;
-    return e;
-}
-
-namespace BinGameObject
-{
 
-    static int SetPosition(lua_State *L)
-    {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[pause] animator is null");
+            }
+
+            animator->Pause();
         }
         else
         {
-            return luaL_error(L, "[setPosition] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[setPosition] gameObject is null");
+            return luaL_error(L, "pause Invalid argument type, expected table");
         }
-
-        gameObject->transform->position.x = x;
-        gameObject->transform->position.y = y;
-        
-
         return 0;
     }
 
-    static int PointToMouse(lua_State *L)
+    static int Add(lua_State *L)
     {
 
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
+        if (lua_gettop(L) != 7)
+        {
+            return luaL_error(L, "add animation function requires 7 arguments");
+        }
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[add] animator is null");
+            }
+
+            const char *name = lua_tostring(L, 2);
+            const char *graph = lua_tostring(L, 3);
+            int row = lua_tointeger(L, 4);
+            int column = lua_tointeger(L, 5);
+            int frameCount = lua_tointeger(L, 6);
+            float framesPerSecond = lua_tonumber(L, 7);
+            animator->Add(name, graph, row, column, frameCount, framesPerSecond);
         }
         else
         {
-            return luaL_error(L, "[PointToMouse] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[PointToMouse] gameObject is null");
+            return luaL_error(L, "add Invalid argument type, expected table");
         }
-
-        gameObject->transform->pointToMouse(x, y);
-
         return 0;
     }
-
-    static int SetScale(lua_State *L)
+    static int AddClip(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
-        }
-        else
+        if (lua_gettop(L) != 3)
         {
-            return luaL_error(L, "[setScale] The First argument must be a table");
+            return luaL_error(L, "addClip function requires 2 arguments (name, clip)");
         }
 
-        if (gameObject == nullptr)
+        Animator *animator = nullptr;
+
+        if (lua_istable(L, 1))
         {
-            return luaL_error(L, "[setScale] gameObject is null");
-        }
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
 
-        gameObject->transform->scale.x = x;
-        gameObject->transform->scale.y = y;
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[addClip] animator is null");
+            }
 
-        return 0;
+            const char *name = luaL_checkstring(L, 2);
+            const char *clip = luaL_checkstring(L, 3);
+            lua_pushboolean(L, animator->AddClip(name, clip));
+            return 1;
+        }
+        return luaL_error(L, "addClip Invalid argument type, expected table");
     }
 
-    static int SetPivot(lua_State *L)
+    static int GetFrameCount(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[getFrameCount] animator is null");
+            }
+
+            lua_pushinteger(L, animator->getFrameCount());
         }
         else
         {
-            return luaL_error(L, "[setPivot] The First argument must be a table");
-        }
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[setPivot] gameObject is null");
+            return luaL_error(L, "getFrameCount Invalid argument type, expected table");
         }
+        return 1;
+    }
 
-        gameObject->transform->pivot.x = x; // (x * gameObject->transform->scale.x);
-        gameObject->transform->pivot.y = y; // (y * gameObject->transform->scale.y);
-
-        return 0;
-    }
-
-    static int SetOrigin(lua_State *L)
+    int IsPlaying(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[isPlaying] animator is null");
+            }
+
+            lua_pushboolean(L, animator->IsPlaying());
         }
         else
         {
-            return luaL_error(L, "[SetOrigin] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[SetPivot] gameObject is null");
+            return luaL_error(L, "isPlaying Invalid argument type, expected table");
         }
-
-        gameObject->originX = x;
-        gameObject->originY = y;
-
-        return 0;
+        return 1;
     }
-    static int SetSize(lua_State *L)
+
+    static int GetCurrentFrame(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0;
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[getCurrentFrame] animator is null");
+            }
+
+            lua_pushinteger(L, animator->getCurrentFrame());
         }
         else
         {
-            return luaL_error(L, "[SetSize] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[SetSize] gameObject is null");
+            return luaL_error(L, "getCurrentFrame Invalid argument type, expected table");
         }
-
-        gameObject->width = x;
-        gameObject->height = y;
-
-        return 0;
+        return 1;
     }
 
-    static int SetCenterPivot(lua_State *L)
+    static int GetFrameDuration(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[getFrameDuration] animator is null");
+            }
+
+            lua_pushnumber(L, animator->getFrameDuration());
         }
         else
         {
-            return luaL_error(L, "[SetCenterPivot] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[SetCenterPivot] gameObject is null");
+            return luaL_error(L, "getFrameDuration Invalid argument type, expected table");
         }
-
-        gameObject->centerPivot();
-
-        return 0;
+        return 1;
     }
 
-    static int SetRotation(lua_State *L)
+    static int GetCurrentTime(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float angle = 0;
+
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            angle = lua_tonumber(L, 2);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[getCurrentTime] animator is null");
+            }
+
+            lua_pushnumber(L, animator->getCurrentTime());
         }
         else
         {
-            return luaL_error(L, "[SetRotation] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[SetRotation] gameObject is null");
+            return luaL_error(L, "getCurrentTime Invalid argument type, expected table");
         }
-
-        gameObject->transform->rotation = angle;
-
-        return 0;
+        return 1;
     }
 
-    static int TurnTo(lua_State *L)
+    static int GetAnimationname(lua_State *L)
     {
-        GameObject *gameObject = nullptr;
-        float x, y, speed, angleDiff = 0;
+        Animator *animator = nullptr;
 
         if (lua_istable(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
-            speed = lua_tonumber(L, 4);
-            angleDiff = lua_tonumber(L, 5);
+            lua_getfield(L, 1, "AnimatorComponent");
+            animator = static_cast<Animator *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            if (animator == nullptr)
+            {
+                return luaL_error(L, "[getAnimation] animator is null");
+            }
+
+            lua_pushstring(L, animator->getName().c_str());
         }
         else
         {
-            return luaL_error(L, "[TurnTo] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[TurnTo] gameObject is null");
+            return luaL_error(L, "getAnimation Invalid argument type, expected table");
         }
-
-        gameObject->transform->TurnTo(x, y, speed, angleDiff);
-
-        return 0;
+        return 1;
     }
 
+}
 
-  static int FaceTo(lua_State *L)
-    {
-        GameObject *gameObject = nullptr;
-        GameObject *otherObject = nullptr;
+void Animator::BindLua(lua_State *L)
+{
 
-        
+    lua_newtable(L);
+    table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[FaceTo] The First argument must be a table");
-        }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref); // Recupera a tabela do objeto
+    lua_pushlightuserdata(L, this);               // Empilha o ponteiro do GameObject
+    lua_setfield(L, -2, "AnimatorComponent");
 
-        if (lua_istable(L, 2))
-        {
-            lua_getfield(L, 2, "gameObject");
-            otherObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 2); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[FaceTo] The Second argument must be a table");
-        }
+    lua_pushstring(L, object->name.c_str());
+    lua_setfield(L, -2, "parent");
 
-        if (gameObject == nullptr )
-        {
-            return luaL_error(L, "[FaceTo] gameObject is null");
-        }
+    static const luaL_Reg methods[] = {
+        {"add",              BindAnimator::Add},
+        {"addClip",          BindAnimator::AddClip},
+        {"play",             BindAnimator::Play},
+        {"stop",             BindAnimator::Stop},
+        {"pause",            BindAnimator::Pause},
+        {"setAnimation",     BindAnimator::SetAnimation},
+        {"setMode",          BindAnimator::SetMode},
+        {"getFrameCount",    BindAnimator::GetFrameCount},
+        {"isPlaying",        BindAnimator::IsPlaying},
+        {"getCurrentFrame",  BindAnimator::GetCurrentFrame},
+        {"getFrameDuration", BindAnimator::GetFrameDuration},
+        {"getCurrentTime",   BindAnimator::GetCurrentTime},
+        {"getName",          BindAnimator::GetAnimationname},
+        {nullptr, nullptr}};
+    BindLuaClass(L, "Animator", methods);
+    lua_pop(L, 1);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+}
 
-        if (otherObject == nullptr )
+void Animator::OnUpdate(float deltaTime)
+{
+    if (current < 0 || !isLoad)
+        return;
+
+    if (!sprite)
+    {
+        sprite = object->GetComponent<SpriteComponent>();
+        if (!sprite)
         {
-            return luaL_error(L, "[FaceTo] target is null");
+            Log(LOG_ERROR, "Animator::OnUpdate() : SpriteComponent not found");
+            isLoad = false;
+            return;
         }
+    }
 
-        gameObject->transform->rotation = getAngle(gameObject->transform->position.x, gameObject->transform->position.y, otherObject->transform->position.x, otherObject->transform->position.y);
+    //   Log(LOG_INFO, "Animator::OnUpdate() : %s", object->name.c_str());
 
-        return 0;
-    }
+    Animation *animation = animations[current].second;
 
-    static int GetWorldPosition(lua_State *L)
+    if (isPlaying)
     {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        float x, y = 0;
-        if (lua_istable(L, 1))
+        animation->Update(deltaTime, mode, frame, time, isReversed);
+
+        int last = animation->frameCount - 1;
+        if (next >= 0 && frame == last)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
+            current = next;
+            next = -1;
+            frame = 0;
+            time = 0;
+            animation = animations[current].second;
+            Play();
         }
-        else
+        // verifica se a animação atual terminou de ser reproduzida
+        else if (frame == last)
         {
-            return luaL_error(L, "[GetWorldPosition] The First argument must be a table");
+            if (mode == AnimationMode::Loop)
+            {
+                frame = 0; // reinicia a animação
+                time = 0;
+            }
+            else if (mode == AnimationMode::PingPong)
+            {
+                isReversed = true; // inverte a reprodução da animação
+            }
         }
 
-        if (gameObject == nullptr)
+        // verifica se a animação atual terminou de ser reproduzida no modo PingPong
+        if (frame == 0 && isReversed)
         {
-            return luaL_error(L, "[GetWorldPosition] gameObject is null");
+            if (mode == AnimationMode::PingPong)
+            {
+                isReversed = false; // inverte a reprodução da animação de volta
+            }
         }
-
-        Vec2 v = gameObject->GetWorldPoint(x, y);
-
-        lua_pushnumber(L, v.x);
-        lua_pushnumber(L, v.y);
-
-        return 2;
     }
 
-    static int GetLocalPosition(lua_State *L)
+    if (frame < (int)animation->frames.size())
     {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        float x, y = 0;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
-        }
-        else
-        {
-            return luaL_error(L, "[GetLocalPosition] The First argument must be a table");
-        }
+        sprite->clip = animation->frames[frame];
+        sprite->SetGraph(animation->graph);
+    }
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetLocalPosition] gameObject is null");
-        }
+void Animator::Play()
+{
+    isPlaying = true;
+}
 
-        Vec2 v = gameObject->GetLocalPoint(x, y);
+void Animator::Pause()
+{
+    isPlaying = false;
+}
 
-        lua_pushnumber(L, v.x);
-        lua_pushnumber(L, v.y);
+void Animator::Stop()
+{
+    isPlaying = false;
+    frame = 0;
+    time = 0;
+}
 
-        return 2;
-    }
+void Animator::OnReset()
+{
+    Stop();
+    isReversed = false;
+}
 
-    static int GetPosition(lua_State *L)
+int Animator::FindAnimation(int nameID) const
+{
+    for (int i = 0; i < (int)animations.size(); i++)
     {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetPosition] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetPosition] gameObject is null");
-        }
-
-        float x, y;
-        x = gameObject->transform->position.x;
-        y = gameObject->transform->position.y;
-
-        lua_pushnumber(L, x);
-        lua_pushnumber(L, y);
-
-        return 2;
+        if (animations[i].first == nameID)
+            return i;
     }
+    return -1;
+}
 
-    static int GetScale(lua_State *L)
+void Animator::SetAnimation(const std::string &name, bool now)
+{
+    if (animations.size() == 0 || !isLoad)
+        return;
+    int index = FindAnimation(InternAnimationName(name));
+    if (index < 0)
     {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetScale] The First argument must be a table");
-        }
+        Log(LOG_WARNING, "Animator::SetAnimation() : animation %s not found", name.c_str());
+        return;
+    }
+    SetAnimation(index, now);
+}
 
-        if (gameObject == nullptr)
+void Animator::SetAnimation(int index, bool now)
+{
+    if (index < 0 || index >= (int)animations.size())
+        return;
+    if (now)
+    {
+        if (current != index)
         {
-            return luaL_error(L, "[GetScale] gameObject is null");
+            frame = 0;
+            time = 0;
+            isReversed = false;
         }
+        current = index;
+        next = -1;
+        Play();
+    }
+    else if (current != index)
+    {
+        next = index; // marca a próxima animação a ser reproduzida
+    }
+}
 
-        float x, y;
-        x = gameObject->transform->scale.x;
-        y = gameObject->transform->scale.y;
+Animation *Animator::GetAnimation()
+{
+    if (current < 0)
+        return nullptr;
+    return animations[current].second;
+}
 
-        lua_pushnumber(L, x);
-        lua_pushnumber(L, y);
+void Animator::AddAnimation(const std::string &name, Animation *animation)
+{
+    animations.push_back(std::make_pair(InternAnimationName(name), animation));
+    if (current < 0)
+    {
+        current = 0;
+    }
+    OnUpdate(0);
+}
 
-        return 2;
+void Animator::Add(const std::string &name, const std::string &graph, int rows, int columns, int frameCount, float framesPerSecond)
+{
+    float frameDuration = framesPerSecond > 0 ? 1.0f / framesPerSecond : 0.0f;
+    Animation *animation = Assets::Instance().sharedClip(graph, rows, columns, frameCount, frameDuration);
+    if (animation == nullptr)
+    {
+        Log(LOG_ERROR, "Animator::Add : invalid animation %s", name.c_str());
+        return;
     }
+    AddAnimation(name, animation);
+}
 
-    static int GetPivot(lua_State *L)
+bool Animator::AddClip(const std::string &name, const std::string &clip)
+{
+    Animation *animation = Assets::Instance().getClip(clip);
+    if (animation == nullptr)
+        return false;
+    AddAnimation(name, animation);
+    return true;
+}
+
+void Animator::SetMode(AnimationMode mode)
+{
+    this->mode = mode;
+    frame = 0;
+    time = 0;
+    isReversed = false;
+}
+void Animator::OnInit()
+{
+    if (object != nullptr)
     {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
+        if (object->HasComponent<SpriteComponent>())
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+            sprite = object->GetComponent<SpriteComponent>();
         }
         else
         {
-            return luaL_error(L, "[GetPivot] The First argument must be a table");
-        }
-
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetPivot] gameObject is null");
+            Log(LOG_ERROR, "SpriteComponent::OnInit() : GameObject has no SpriteComponent");
+            isLoad = false;
         }
+    }
+}
 
-        float x, y;
-        x = gameObject->transform->pivot.x;
-        y = gameObject->transform->pivot.y;
+void Animator::OnDebug()
+{
+    // Log(LOG_INFO, "Animator::OnDebug()");
+}
 
-        lua_pushnumber(L, x);
-        lua_pushnumber(L, y);
+//*********************************************************************************************************************
+//**                         GameObject                                                                              **
+//*********************************************************************************************************************
 
-        return 2;
-    }
+static unsigned long NewGameObjectID()
+{
+    static unsigned long id = 0;
+    return id++;
+}
 
-    static int GetRotation(lua_State *L)
-    {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetRotation] The First argument must be a table");
-        }
+// the Lua side of a GameObject: a full userdata holding the pointer, cleared
+// when the object is destroyed so stale handles fail instead of crashing
+struct GameObjectHandle
+{
+    static const unsigned int Magic = 0x474F424Au;
+    unsigned int magic;
+    GameObject *object;
+};
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetRotation] gameObject is null");
-        }
+GameObject::GameObject() : name("GameObject"),
+                           alive(true), visible(true), active(true),
+                           layer(1), script(nullptr)
+{
+    // Log(LOG_INFO, "GameObject created");
+    parent = nullptr;
+    scene = nullptr;
+    id = NewGameObjectID();
+    transform = new TransformComponent(this);
+    UpdateWorld();
+    bound.x = 0;
+    bound.y = 0;
+    width = 1;
+    height = 1;
+    originX = 0;
+    originY = 0;
+    solid = false;
+    prefab = false;
+    persistent = false;
+    collidable = true;
+    pickable = false;
 
-        float x;
-        x = gameObject->transform->rotation;
+    word_position.x = transform->position.x;
+    word_position.y = transform->position.y;
+    moved = false;
 
-        lua_pushnumber(L, x);
+    layer = 0;
+    scriptName = "";
+    _x = 0;
+    _y = 0;
+    table_ref = LUA_NOREF;
+    debugMask = 0;
+}
 
-        return 1;
-    }
+GameObject::GameObject(const std::string &Name) : GameObject()
+{
 
-    static int GetWorldRotation(lua_State *L)
-    {
-        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetWorldRotation] The First argument must be a table");
-        }
+    name = Name;
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetWorldRotation] gameObject is null");
-        }
+GameObject::GameObject(const std::string &Name, int layer) : GameObject()
+{
+    this->layer = layer;
+    name = Name;
+}
 
-        float x;
-        x = gameObject->GetWorldAngle();
+void GameObject::OnReady()
+{
 
-        lua_pushnumber(L, x);
+    // Log(LOG_INFO, "GameObject::OnReady()");
+    if (script != nullptr)
+        script->callOnReady();
+}
+void GameObject::OnPause()
+{
+    if (script != nullptr)
+        script->callOnPause();
+}
 
-        return 1;
-    }
+void GameObject::OnRemove()
+{
+    if (script != nullptr)
+        script->callOnRemove();
+}
 
-    static int GetX(lua_State *L)
+// empties the fields a script stored on a handle, the table is reused too
+static void ClearHandleFields(lua_State *L, int ref)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    if (lua_getiuservalue(L, -1, 1) == LUA_TTABLE)
     {
-
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0)
         {
-            return luaL_error(L, "[GetX] The First argument must be a table");
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, -4);
         }
+    }
+    lua_pop(L, 2);
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetX] gameObject is null");
-        }
+// back to a just created state for Scene pools: components and script stay bound,
+// fields the script stored on the object are cleared and OnReady runs again
+void GameObject::ResetForPool()
+{
+    // back to what the constructor set, the script's OnReady sets up the rest
+    alive = true;
+    visible = true;
+    active = true;
+    transform->position = Vec2(0.0f);
+    transform->rotation = 0;
+    transform->scale = Vec2(1.0f);
+    transform->pivot = Vec2(0.0f);
+    transform->skew = Vec2(0.0f);
+    width = 1;
+    height = 1;
+    originX = 0;
+    originY = 0;
+    solid = false;
+    collidable = true;
+    pickable = false;
+    prefab = false;
+    persistent = false;
+    debugMask = 0;
+    UpdateWorld();
+    for (auto &c : m_components)
+        c->OnReset();
 
-        float x;
-        x = gameObject->transform->position.x;
+    CoroutineScheduler::Instance().Cancel(this);
+    TimerWheel::Instance().Cancel(this);
+    if (script != nullptr)
+    {
+        if (script->module != nullptr)
+            script->module->RemoveFromBatch(script);
+        script->callOnReadyDone = false;
+        if (script->worker >= 0)
+            ClearHandleFields(script->state, script->self_ref);
+        // subscriptions made by the script go, the broadcast one stays
+        MessageBus::Instance().Detach(script);
+        MessageBus::Instance().Attach(script);
+    }
 
-        lua_pushnumber(L, x);
+    if (table_ref != LUA_NOREF)
+        ClearHandleFields(getState(), table_ref);
+}
 
-        return 1;
+void GameObject::Encapsulate(float x, float y)
+{
+    if (bbReset)
+    {
+        x1 = x2 = x;
+        y1 = y2 = y;
+        bbReset = false;
     }
-
-    static int GetY(lua_State *L)
+    else
     {
-        GameObject *gameObject = nullptr;
+        if (x < x1)
+            x1 = x;
+        if (x > x2)
+            x2 = x;
+        if (y < y1)
+            y1 = y;
+        if (y > y2)
+            y2 = y;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetY] The First argument must be a table");
-        }
+        bound.x = x1;
+        bound.y = y1;
+        bound.width = (x2 - x1);
+        bound.height = (y2 - y1);
+    }
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetY] gameObject is null");
-        }
+Vector2 ApplyMatrixToPoint(const Matrix2D &matrix, float x, float y)
+{
+    Vector2 transformedPoint;
+    transformedPoint.x = x * matrix.a + y * matrix.c + matrix.tx;
+    transformedPoint.y = x * matrix.b + y * matrix.d + matrix.ty;
 
-        float y;
-        y = gameObject->transform->position.y;
+    return transformedPoint;
+}
 
-        lua_pushnumber(L, y);
+void GameObject::UpdateWorld()
+{
+    Rectangle last = bound;
+    Matrix2D mat = transform->GetWorldTransformation();
+    word_position = mat.TransformCoords();
 
-        return 1;
-    }
+    float w = width  *  transform->scale.x;
+    float h = height *  transform->scale.y;
+    radius = std::min(w, h) / 2.0f;
 
-    static int GetWorldX(lua_State *L)
-    {
+    bbReset = true;
+    float newX = word_position.x;
+    float newY = word_position.y;
+    const auto tx1 = 0;
+    const auto ty1 = 0;
+    const auto tx2 = w;
+    const auto ty2 = h;
 
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetWorldX] The First argument must be a table");
-        }
+    if (GetWorldAngle() != 0.0f)
+    {
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[GetWorldX] gameObject is null");
-        }
+        const auto cost = cosf(-GetWorldAngle() * DEG2RAD);
+        const auto sint = sinf(-GetWorldAngle() * DEG2RAD);
 
-        float x = gameObject->getWorldX();
+        Encapsulate(tx1 * cost - ty1 * sint + newX, tx1 * sint + ty1 * cost + newY);
+        Encapsulate(tx2 * cost - ty1 * sint + newX, tx2 * sint + ty1 * cost + newY);
+        Encapsulate(tx2 * cost - ty2 * sint + newX, tx2 * sint + ty2 * cost + newY);
+        Encapsulate(tx1 * cost - ty2 * sint + newX, tx1 * sint + ty2 * cost + newY);
+    }
+    else
+    {
 
-        lua_pushnumber(L, x);
+        Encapsulate(tx1 + newX, ty1 + newY);
+        Encapsulate(tx2 + newX, ty1 + newY);
+        Encapsulate(tx2 + newX, ty2 + newY);
+        Encapsulate(tx1 + newX, ty2 + newY);
+    }
+    moved = last.x != bound.x || last.y != bound.y || last.width != bound.width || last.height != bound.height;
 
-        return 1;
+    for (auto &c : children)
+    {
+        c->UpdateWorld();
+        // children are drawn with the parent, on its layer
+        if (c->moved)
+            moved = true;
     }
+}
+void GameObject::OnCollision(GameObject *other)
+{
 
-    static int GetWorldY(lua_State *L)
+    if (script != nullptr)
     {
+        script->callOnCollide(other);
+    }
+    // Log(LOG_INFO, "OnColide %s with %s ", name.c_str(), other->name.c_str());
+}
 
-        GameObject *gameObject = nullptr;
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "[GetWorldY] The First argument must be a table");
-        }
+void GameObject::setDebug(int mask)
+{
+    debugMask = mask;
+}
 
-        if (gameObject == nullptr)
+void GameObject::Update(float dt)
+{
+    if (script != nullptr)
+    {
+        if (!script->callOnReadyDone)
         {
-            return luaL_error(L, "[GetWorldY] gameObject is null");
+            OnReady();
         }
+    }
+    if (solid)
+        return;
 
-        float y = gameObject->getWorldY();
+    UpdateWorld();
 
-        lua_pushnumber(L, y);
+    if (script != nullptr && script->hasCallback(ScriptUpdate))
+    {
+        // isolated scripts run later, on their worker
+        if (script->worker >= 0)
+            ScriptWorkers::Instance().Queue(script);
+        else
+            script->callOnUpdate(dt);
+    }
 
-        return 1;
+    for (auto &c : m_components)
+    {
+        c->OnUpdate(dt);
     }
 
-    static int Kill(lua_State *L)
+    for (auto &c : children)
     {
-        GameObject *gameObject = nullptr;
+        c->Update(dt);
+    }
+}
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "kill Invalid argument type, expected table");
-        }
+bool GameObject::place_free(float x, float y)
+{
+    if (!scene)
+        return true;
+    return scene->place_free(this, x, y);
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[Kill] gameObject is null");
-        }
+bool GameObject::place_meeting(float x, float y, const std::string &name)
+{
+    if (!scene)
+        return false;
+    return scene->place_meeting(this, x, y, name);
+}
 
-        gameObject->alive = false;
+bool GameObject::place_meeting_layer(float x, float y, int layer)
+{
 
-        return 0;
-    }
+    if (!scene)
+        return false;
+    return scene->place_meeting_layer(this, x, y, layer);
+}
 
-    static int CenterPivot(lua_State *L)
-    {
-        GameObject *gameObject = nullptr;
+bool GameObject::collideWith(GameObject *e, float x, float y)
+{
+    if (!scene || !e)
+        return false;
+    if (e == this)
+        return false;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "centerPivor Invalid argument type, expected table");
-        }
+    _x = this->transform->position.x;
+    _y = this->transform->position.y;
+    this->transform->position.x = x;
+    this->transform->position.y = y;
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[centerPivot] gameObject is null");
-        }
+    if (
+        x - this->getWorldOriginX() + width > e->getWorldX() - e->getWorldOriginX() &&
+        y - this->getWorldOriginY() + height > e->getWorldY() - e->getWorldOriginY() &&
+        x - this->getWorldOriginX() < e->getWorldX() - e->getWorldOriginX() + e->width &&
+        y - this->getWorldOriginY() < e->getWorldY() - e->getWorldOriginY() + e->height)
+    {
+        this->transform->position.x = _x;
+        this->transform->position.y = _y;
+        OnCollision(e);
+        e->OnCollision(this);
+        return true;
+    }
+    this->transform->position.x = _x;
+    this->transform->position.y = _y;
+    return false;
+}
 
-        gameObject->centerPivot();
+void GameObject::centerPivot()
+{
 
-        return 0;
+    if (HasComponent<SpriteComponent>())
+    {
+        auto sprite = GetComponent<SpriteComponent>();
+        transform->pivot.x = sprite->clip.width / 2.0f;
+        transform->pivot.y = sprite->clip.height / 2.0;
+        //  Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
+        // Log(LOG_INFO, "Size %s set to %f %f", name.c_str(), sprite->clip.width, sprite->clip.height);
     }
-    static int CenterOrigin(lua_State *L)
+    else
     {
-        GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-        }
-        else
-        {
-            return luaL_error(L, "centerOrigin Invalid argument type, expected table");
-        }
+        transform->pivot.x = (width / 2.0f);
+        transform->pivot.y = (height / 2.0f);
+        // Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
+    }
+}
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[centerOrigin] gameObject is null");
-        }
+void GameObject::centerOrigin()
+{
 
-        gameObject->centerOrigin();
+    if (HasComponent<SpriteComponent>())
+    {
+        auto sprite = GetComponent<SpriteComponent>();
+        width = (int)sprite->clip.width / 2 * transform->scale.x;
+        height = (int)sprite->clip.height / 2 * transform->scale.y;
+        originX = -(int)(width / 2.0f) + (width / 2.0f);
+        originY = -(int)(height / 2.0f) + (height / 2.0f);
+    }
+    else
+    {
 
-        return 0;
+        originX = (width / 2.0f);
+        originY = (height / 2.0f);
+        // Log(LOG_INFO, "Pivot %s set to %f %f", name.c_str(), transform->pivot.x, transform->pivot.y);
     }
+}
 
-    static int Advance(lua_State *L)
-    {
-        GameObject *gameObject = nullptr;
-        float speed, off = 0;
+void GameObject::Debug()
+{
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            speed = lua_tonumber(L, 2);
-            if (lua_gettop(L) == 3)
-            {
-                off = lua_tonumber(L, 3);
-            }
-        }
-        else
-        {
-            return luaL_error(L, "advance Invalid argument type, expected table");
-        }
+    if (!debugMask)
+        return;
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[Advance] gameObject is null");
-        }
+    bool isOriginEnabled = (debugMask & SHOW_ORIGIN) != 0;
+    bool isBoxCollideEnabled = (debugMask & SHOW_BOX) != 0;
 
-        gameObject->transform->position.x += cos((gameObject->transform->rotation + off) * RAD) * speed;
-        gameObject->transform->position.y += sin((gameObject->transform->rotation + off) * RAD) * speed;
+    float finalRad = radius / 4.0f;
+    if (finalRad < 0.5f)
+        finalRad = 0.5f;
 
-        return 0;
+    if (script != nullptr)
+    {
+        if (!script->callOnReadyDone)
+            return;
     }
 
-    static int XAdvance(lua_State *L)
+    int bX = (int)getX();
+    int bY = (int)getY();
+
+    int cx = bX + originX;
+    int cy = bY + originY;
+    int cw = width ;
+    int ch = height ;
+
+    if (isBoxCollideEnabled)
+        DrawRectangleLines( cx,  cy, cw , ch , WHITE);
+    if (isOriginEnabled)
+        DrawCircle(cx, cy, finalRad, WHITE);
+
+    if (!solid)
     {
-        GameObject *gameObject = nullptr;
-        float speed, to = 0;
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
-            speed = lua_tonumber(L, 2);
-            to = lua_tonumber(L, 3);
-        }
+        Vec2 p;
+        if (!parent)
+            p = GetLocalPoint(transform->pivot.x, transform->pivot.y);
         else
-        {
-            return luaL_error(L, "xAdvance Invalid argument type, expected table");
-        }
+            p = GetWorldPoint(transform->pivot.x, transform->pivot.y);
 
-        if (gameObject == nullptr)
+        bool isPivotEnabled = (debugMask & SHOW_PIVOT) != 0;
+        bool isTrasnformEnabled = (debugMask & SHOW_TRANSFORM) != 0;
+
+        if (isPivotEnabled)
+            DrawCircle((int)p.x, (int)p.y, finalRad, LIME);
+
+        float newX = word_position.x;
+        float newY = word_position.y;
+        const auto tx1 = 0;
+        const auto ty1 = 0;
+        const auto tx2 = width  * 2.0f * transform->scale.x;
+        const auto ty2 = height * 2.0f * transform->scale.y;
+
+        if (isTrasnformEnabled)
         {
-            return luaL_error(L, "[XAdvance] gameObject is null");
+            if (GetWorldAngle() != 0.0f)
+            {
+
+                const auto cost = cosf(-GetWorldAngle() * DEG2RAD);
+                const auto sint = sinf(-GetWorldAngle() * DEG2RAD);
+                float x1 = tx1 * cost - ty1 * sint + newX;
+                float y1 = tx1 * sint + ty1 * cost + newY;
+                float x2 = tx2 * cost - ty1 * sint + newX;
+                float y2 = tx2 * sint + ty1 * cost + newY;
+                float x3 = tx2 * cost - ty2 * sint + newX;
+                float y3 = tx2 * sint + ty2 * cost + newY;
+                float x4 = tx1 * cost - ty2 * sint + newX;
+                float y4 = tx1 * sint + ty2 * cost + newY;
+                DrawLine(x1, y1, x2, y2, LIME);
+                DrawLine(x1, y1, x4, y4, LIME);
+                DrawLine(x3, y3, x4, y4, LIME);
+                DrawLine(x2, y2, x3, y3, LIME);
+            }
+            else
+            {
+                DrawLine(tx1 + newX, ty1 + newY, tx2 + newX, ty1 + newY, LIME);
+                DrawLine(tx1 + newX, ty1 + newY, tx1 + newX, ty2 + newY, LIME);
+                DrawLine(tx2 + newX, ty2 + newY, tx1 + newX, ty2 + newY, LIME);
+                DrawLine(tx2 + newX, ty2 + newY, tx2 + newX, ty1 + newY, LIME);
+            }
         }
+    }
 
-        gameObject->transform->position.x += cos(to * RAD) * speed;
-        gameObject->transform->position.y += sin(to * RAD) * speed;
+    bool isComponentsEnable = (debugMask & SHOW_COMPONENTS) != 0;
+    bool isBoundEnable = (debugMask & SHOW_BOUND) != 0;
 
-        return 0;
-    }
+    if (isBoundEnable)
+        DrawRectangleLinesEx(bound, 1.5f, MAGENTA);
 
-    static int AddBoxCollider(lua_State *L)
+    if (isComponentsEnable)
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0, w = 0, h = 0;
-
-        if (lua_gettop(L) != 5)
+        for (auto &c : m_components)
         {
-            return luaL_error(L, "addBoxCollider function requires 4 arguments");
+            c->OnDebug();
         }
+    }
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
-            w = lua_tonumber(L, 4);
-            h = lua_tonumber(L, 5);
-        }
-        else
-        {
-            return luaL_error(L, "addBoxCollider Invalid argument type, expected table");
-        }
+    for (auto &c : children)
+    {
+        c->Debug();
+    }
+}
+void GameObject::Render()
+{
 
-        if (gameObject == nullptr)
-        {
-            return luaL_error(L, "[addBoxCollider] gameObject is null");
-        }
+    if (script != nullptr && !solid)
+    {
+        if (!script->callOnReadyDone)
+            return;
+     }
 
-        gameObject->AddComponent<BoxColiderComponent>(x, y, w, h);
 
-        return 0;
+    for (auto &c : m_components)
+    {
+        c->OnDraw();
     }
 
-    static int AddCircleCollider(lua_State *L)
+    if (script != nullptr && !solid && script->hasCallback(ScriptRender))
     {
-        GameObject *gameObject = nullptr;
-        float x = 0, y = 0, r = 0;
+        script->callOnRender();
+    }
+    for (auto &c : children)
+    {
+        c->Render();
+    }
 
-        if (lua_gettop(L) != 4)
-        {
-            return luaL_error(L, "addCircleCollider function requires 3 arguments");
-        }
+    // Log(LOG_INFO, "Render %s %f %f", name.c_str(),getX(),getY());
+}
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            x = lua_tonumber(L, 2);
-            y = lua_tonumber(L, 3);
-            r = lua_tonumber(L, 4);
-        }
-        else
+GameObject::~GameObject()
+{
+    // Log(LOG_INFO, "[CPP] GameObject (%s) destroyed", name.c_str());
+    CoroutineScheduler::Instance().Cancel(this);
+    TimerWheel::Instance().Cancel(this);
+
+    for (auto &c : m_components)
+    {
+        if (c)
         {
-            return luaL_error(L, "addCircleCollider Invalid argument type, expected table");
+            c->OnDestroy();
+            delete c;
         }
+    }
 
-        if (gameObject == nullptr)
+    for (auto &c : children)
+    {
+        if (c)
         {
-            return luaL_error(L, "[addCircleCollider] gameObject is null");
+            delete c;
         }
+    }
+    children.clear();
 
-        gameObject->AddComponent<CircleColiderComponent>(x, y, r);
-
-        return 0;
+    if (table_ref != LUA_NOREF)
+    {
+        lua_State *L = getState();
+        lua_rawgeti(L, LUA_REGISTRYINDEX, table_ref);
+        GameObjectHandle *handle = static_cast<GameObjectHandle *>(lua_touserdata(L, -1));
+        if (handle != nullptr)
+            handle->object = nullptr;
+        lua_pop(L, 1);
+        luaL_unref(L, LUA_REGISTRYINDEX, table_ref);
     }
 
-    static int SetSpriteColor(lua_State *L)
+    if (script != nullptr)
     {
-        GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 5)
-        {
-            return luaL_error(L, "setSpriteColor function requires 4 arguments");
-        }
+        delete script;
+    }
+}
 
-        if (lua_istable(L, 1))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+Vec2 GameObject::GetWorldPoint(float _x, float _y)
+{
 
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setSpriteColor] gameObject is null");
-            }
-            if (gameObject->HasComponent<SpriteComponent>() == false)
-            {
-                return luaL_error(L, "[setSpriteColor] gameObject has no sprite component");
-            }
-            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
-            sprite->color.r = lua_tonumber(L, 2);
-            sprite->color.g = lua_tonumber(L, 3);
-            sprite->color.b = lua_tonumber(L, 4);
-            sprite->color.a = lua_tonumber(L, 5);
-        }
-        else
-        {
-            return luaL_error(L, "setSpriteColor Invalid argument type, expected table");
-        }
+    return transform->wordl_transform.TransformCoords(Vec2(_x, _y));
+}
 
-        return 0;
+Vec2 GameObject::GetWorldPoint(Vec2 p)
+{
+    return transform->wordl_transform.TransformCoords(p);
+}
+
+Vec2 GameObject::GetLocalPoint(Vec2 p)
+{
+    return transform->local_transform.TransformCoords(p);
+}
+
+Vec2 GameObject::GetLocalPoint(float x, float y)
+{
+    return transform->local_transform.TransformCoords(Vec2(x, y));
+}
+
+void GameObject::createScript(const char *lua, lua_State *L)
+{
+    scriptName = lua;
+    std::string path = "";
+
+    if (table_ref == LUA_NOREF)
+    {
+        BindLua(L);
     }
 
-    static int SetSpriteFlip(lua_State *L)
+    static const char *patterns[] = {"%s", "%s.lua", "assets/%s.lua", "../assets/%s.lua",
+                                     "assets/scripts/%s", "../assets/scripts/%s", "assets/scripts/%s.lua", "../assets/scripts/%s.lua"};
+    path = VirtualFS::Instance().Resolve(lua, patterns, 8);
+    if (path.empty())
+    {
+        Log(LOG_ERROR, "Script %s not found", lua);
+        return;
+    }
+
+    new ScriptComponent(this, path.c_str(), ScriptWorkers::Instance().Assign(L, path));
+}
+
+void GameObject::CopyFields(const GameObject *from)
+{
+    visible = from->visible;
+    active = from->active;
+    persistent = from->persistent;
+    debugMask = from->debugMask;
+    width = from->width;
+    height = from->height;
+    originX = from->originX;
+    originY = from->originY;
+    collidable = from->collidable;
+    pickable = from->pickable;
+    solid = from->solid;
+    transform->position = from->transform->position;
+    transform->scale = from->transform->scale;
+    transform->pivot = from->transform->pivot;
+    transform->skew = from->transform->skew;
+    transform->rotation = from->transform->rotation;
+}
+
+// one call per prefab instance: fields and transform are copied, every component
+// is cloned into the same slot and the script is attached from its resolved path
+GameObject *GameObject::Clone() const
+{
+    GameObject *copy = new GameObject(name, layer);
+    copy->scriptName = scriptName;
+    copy->CopyFields(this);
+
+    for (Component *component : m_components)
+    {
+        size_t slot = 0;
+        while (slot < maxComponents && m_componentArray[slot] != component)
+            slot++;
+        Component *clone = component->Clone();
+        if (clone == nullptr || slot == maxComponents)
+            continue;
+        clone->object = copy;
+        clone->table_ref = LUA_NOREF;
+        copy->m_components.push_back(clone);
+        copy->m_componentArray[slot] = clone;
+        copy->m_componentBitset[slot] = true;
+    }
+    if (copy->HasComponent<Animator>())
+        copy->GetComponent<Animator>()->sprite = copy->GetComponent<SpriteComponent>();
+
+    for (GameObject *child : children)
+        copy->addChild(child->Clone());
+
+    if (script != nullptr)
+    {
+        lua_State *L = getState();
+        copy->BindLua(L);
+        lua_pop(L, 1);
+        new ScriptComponent(copy, script->script.c_str(), ScriptWorkers::Instance().Assign(L, script->script));
+    }
+    return copy;
+}
+
+GameObject *GameObject::addChild(GameObject *e)
+{
+    children.push_back(e);
+    e->parent = this;
+    return e;
+}
+
+namespace BinGameObject
+{
+
+    static int SetPosition(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 3)
-        {
-            return luaL_error(L, "setSpriteFlip function requires 3 arguments");
-        }
+        float x = 0, y = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setSpriteFlip] gameObject is null");
-            }
-            if (gameObject->HasComponent<SpriteComponent>() == false)
-            {
-                return luaL_error(L, "[setSpriteFlip] gameObject has no sprite component");
-            }
-            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
-            sprite->FlipX = lua_toboolean(L, 2);
-            sprite->FlipY = lua_toboolean(L, 3);
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
         else
         {
-            return luaL_error(L, "setSpriteColor Invalid argument type, expected table");
+            return luaL_error(L, "[setPosition] The First argument must be a gameObject");
+        }
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[setPosition] gameObject is null");
         }
 
+        gameObject->transform->position.x = x;
+        gameObject->transform->position.y = y;
+        
+
         return 0;
     }
 
-    static int SetSpriteClip(lua_State *L)
+    static int PointToMouse(lua_State *L)
     {
+
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 5)
+        float x = 0, y = 0;
+
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "setSpriteClip function requires 4 arguments");
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setSpriteClip] gameObject is null");
-            }
-            if (gameObject->HasComponent<SpriteComponent>() == false)
-            {
-                return luaL_error(L, "[setSpriteClip] gameObject has no sprite component");
-            }
-            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
-            sprite->clip.x = lua_tonumber(L, 2);
-            sprite->clip.y = lua_tonumber(L, 3);
-            sprite->clip.width = lua_tonumber(L, 4);
-            sprite->clip.height = lua_tonumber(L, 5);
+            return luaL_error(L, "[PointToMouse] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "setSpriteColor Invalid argument type, expected table");
+            return luaL_error(L, "[PointToMouse] gameObject is null");
         }
 
+        gameObject->transform->pointToMouse(x, y);
+
         return 0;
     }
 
-    static int SetSpriteGraph(lua_State *L)
+    static int SetScale(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 2)
+        float x = 0, y = 0;
+
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "setSpriteGraph function requires 1 argument");
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setSpriteGraph] gameObject is null");
-            }
-            if (gameObject->HasComponent<SpriteComponent>() == false)
-            {
-                return luaL_error(L, "[setSpriteGraph] gameObject has no sprite component");
-            }
-            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
-            const char *graph = lua_tostring(L, 2);
-            if (Assets::Instance().hasGraph(graph))
-            {
-                sprite->graph = Assets::Instance().getGraph(graph);
-            }
-            else
-            {
-                return luaL_error(L, "[setSpriteGraph] graph %s not found", graph);
-            }
+            return luaL_error(L, "[setScale] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "setSpriteGraph Invalid argument type, expected table");
+            return luaL_error(L, "[setScale] gameObject is null");
         }
 
+        gameObject->transform->scale.x = x;
+        gameObject->transform->scale.y = y;
+
         return 0;
     }
-    //*********************************************************************************************************************
-    static int AddAnimator(lua_State *L)
+
+    static int SetPivot(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        float x = 0, y = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[addAnimator] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>())
-            {
-                return luaL_error(L, "[addAnimation] gameObject has already a animator component");
-            }
-            Animator *an = gameObject->AddComponent<Animator>();
-            ///  an->AddRow("run", "player_run", 10,12);
-            // an->SetAnimation("run");
-            // an->Play();
-            an->BindLua(L);
-            return 1;
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
         else
         {
-            return luaL_error(L, "addAnimator Invalid argument type, expected table");
+            return luaL_error(L, "[setPivot] The First argument must be a gameObject");
+        }
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[setPivot] gameObject is null");
         }
 
-        lua_pushnil(L);
-        return 1;
+        gameObject->transform->pivot.x = x; // (x * gameObject->transform->scale.x);
+        gameObject->transform->pivot.y = y; // (y * gameObject->transform->scale.y);
+
+        return 0;
     }
 
-    static int getAnimator(lua_State *L)
+    static int SetOrigin(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        float x = 0, y = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[getAnimator] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[getAnimator] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-
-            if (animation->table_ref == LUA_NOREF)
-            {
-                animation->BindLua(L);
-            }
-            lua_rawgeti(L, LUA_REGISTRYINDEX, animation->table_ref);
-            return 1;
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
         else
         {
-            return luaL_error(L, "getAnimator Invalid argument type, expected table");
+            return luaL_error(L, "[SetOrigin] The First argument must be a gameObject");
         }
 
-        lua_pushnil(L);
-        return 1;
-    }
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[SetPivot] gameObject is null");
+        }
 
-    static int SetAnimation(lua_State *L)
+        gameObject->originX = x;
+        gameObject->originY = y;
+
+        return 0;
+    }
+    static int SetSize(lua_State *L)
     {
+        GameObject *gameObject = nullptr;
+        float x = 0, y = 0;
 
-        if (lua_gettop(L) <= 1)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "setAnimation function requires 1/2 arguments");
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
+        }
+        else
+        {
+            return luaL_error(L, "[SetSize] The First argument must be a gameObject");
         }
-        GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (gameObject == nullptr)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "[SetSize] gameObject is null");
+        }
 
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setAnimation] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[setAnimation] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-            const char *name = lua_tostring(L, 2);
-            bool now = false;
+        gameObject->width = x;
+        gameObject->height = y;
 
-            if (lua_gettop(L) == 3)
-            {
-                now = lua_toboolean(L, 3);
-            }
+        return 0;
+    }
 
-            animation->SetAnimation(name, now);
-            if (now)
-            {
-                // return luaL_error(L, "play animation %s", name);
-                animation->Play();
-            }
+    static int SetCenterPivot(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
         }
         else
         {
-            return luaL_error(L, "setAnimation Invalid argument type, expected table");
+            return luaL_error(L, "[SetCenterPivot] The First argument must be a gameObject");
+        }
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[SetCenterPivot] gameObject is null");
         }
 
+        gameObject->centerPivot();
+
         return 0;
     }
 
-    static int PlayAnimation(lua_State *L)
+    static int SetRotation(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 2)
+        float angle = 0;
+
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "playAnimation function requires 1 argument");
+            gameObject = GameObject::FromLua(L, 1);
+            angle = lua_tonumber(L, 2);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[playAnimation] gameObject is null");
-                return 0;
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[playAnimation] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-            animation->Play();
+            return luaL_error(L, "[SetRotation] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "playAnimation Invalid argument type, expected table");
+            return luaL_error(L, "[SetRotation] gameObject is null");
         }
 
+        gameObject->transform->rotation = angle;
+
         return 0;
     }
 
-    static int StopAnimation(lua_State *L)
+    static int TurnTo(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        float x, y, speed, angleDiff = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[stopAnimation] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[stopAnimation] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-            animation->Stop();
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
+            speed = lua_tonumber(L, 4);
+            angleDiff = lua_tonumber(L, 5);
         }
         else
         {
-            return luaL_error(L, "stopAnimation Invalid argument type, expected table");
+            return luaL_error(L, "[TurnTo] The First argument must be a gameObject");
+        }
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[TurnTo] gameObject is null");
         }
 
+        gameObject->transform->TurnTo(x, y, speed, angleDiff);
+
         return 0;
     }
-    static int PauseAnimation(lua_State *L)
+
+
+  static int FaceTo(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        GameObject *otherObject = nullptr;
 
-        if (lua_istable(L, 1))
+        
+
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            return luaL_error(L, "[FaceTo] The First argument must be a gameObject");
+        }
 
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[pauseAnimation] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[pauseAnimation] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-            animation->Pause();
+        if (lua_isuserdata(L, 2))
+        {
+            otherObject = GameObject::FromLua(L, 2);
         }
         else
         {
-            return luaL_error(L, "pauseAnimation Invalid argument type, expected table");
+            return luaL_error(L, "[FaceTo] The Second argument must be a gameObject");
+        }
+
+        if (gameObject == nullptr )
+        {
+            return luaL_error(L, "[FaceTo] gameObject is null");
+        }
+
+        if (otherObject == nullptr )
+        {
+            return luaL_error(L, "[FaceTo] target is null");
         }
 
+        gameObject->transform->rotation = getAngle(gameObject->transform->position.x, gameObject->transform->position.y, otherObject->transform->position.x, otherObject->transform->position.y);
+
         return 0;
     }
 
-    static int SetAnimationMode(lua_State *L)
+    static int GetWorldPosition(lua_State *L)
     {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
         GameObject *gameObject = nullptr;
+        float x, y = 0;
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
+        }
+        else
+        {
+            return luaL_error(L, "[GetWorldPosition] The First argument must be a gameObject");
+        }
 
-        if (lua_istable(L, 1))
+        if (gameObject == nullptr)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "[GetWorldPosition] gameObject is null");
+        }
 
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setAnimationMode] gameObject is null");
-            }
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[setAnimationMode] gameObject has no animator component");
-            }
-            Animator *animation = gameObject->GetComponent<Animator>();
-            int mode = lua_tointeger(L, 2);
-            animation->SetMode((AnimationMode)mode);
+        Vec2 v = gameObject->GetWorldPoint(x, y);
+
+        lua_pushnumber(L, v.x);
+        lua_pushnumber(L, v.y);
+
+        return 2;
+    }
+
+    static int GetLocalPosition(lua_State *L)
+    {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
+        GameObject *gameObject = nullptr;
+        float x, y = 0;
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
         }
         else
         {
-            return luaL_error(L, "setAnimationMode Invalid argument type, expected table");
+            return luaL_error(L, "[GetLocalPosition] The First argument must be a gameObject");
         }
 
-        return 0;
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[GetLocalPosition] gameObject is null");
+        }
+
+        Vec2 v = gameObject->GetLocalPoint(x, y);
+
+        lua_pushnumber(L, v.x);
+        lua_pushnumber(L, v.y);
+
+        return 2;
     }
 
-    static int SetTable(lua_State *L)
+    static int GetPosition(lua_State *L)
     {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 2)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "SetTable function requires 1 argument");
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            return luaL_error(L, "[GetPosition] The First argument must be a gameObject");
         }
-        // PrintLuaTable(L);
 
-        if (lua_istable(L, 1))
+        if (gameObject == nullptr)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "[GetPosition] gameObject is null");
+        }
 
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[setTable] gameObject is null");
-            }
+        float x, y;
+        x = gameObject->transform->position.x;
+        y = gameObject->transform->position.y;
 
-            if (!lua_istable(L, 2))
-            {
-                luaL_error(L, "[setTable] Argument must be a table");
-            }
+        lua_pushnumber(L, x);
+        lua_pushnumber(L, y);
 
-            ///  PrintLuaTable(L);
+        return 2;
+    }
 
-            // float x = 0, y = 0, rotation = 0, scaleX = 1, scaleY = 1, pivotX = 0, pivotY = 0;
-            // int width = 0, height = 0, r = 0, g = 0, b = 0, a = 0, originX = 0, originY = 0;
-            // bool flipX = false, flipY = false;
-            SpriteComponent *sprite = nullptr;
-            bool useSprite = false;
-            if (gameObject->HasComponent<SpriteComponent>())
-            {
-                sprite = gameObject->GetComponent<SpriteComponent>();
-                useSprite = true;
-            }
+    static int GetScale(lua_State *L)
+    {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
+        GameObject *gameObject = nullptr;
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            return luaL_error(L, "[GetScale] The First argument must be a gameObject");
+        }
 
-            if (lua_istable(L, -1))
-            {
-                lua_pushnil(L);
-                while (lua_next(L, -2) != 0)
-                {
-                    const char *property_name = lua_tostring(L, -2);
-                    //    const char *property_value = lua_tostring(L, -1);
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[GetScale] gameObject is null");
+        }
 
-                    //   return luaL_error(L,     "Key:%s - Value:%s", property_name, property_value);
+        float x, y;
+        x = gameObject->transform->scale.x;
+        y = gameObject->transform->scale.y;
 
-                    if (strcmp(property_name, "rotation") == 0)
-                    {
-                        gameObject->transform->rotation = lua_tonumber(L, -1);
-                        lua_pop(L, 1);
-                        continue;
-                    }
+        lua_pushnumber(L, x);
+        lua_pushnumber(L, y);
 
-                    if (useSprite && sprite != nullptr)
-                    {
-                        if (strcmp(property_name, "red") == 0)
-                        {
-                            sprite->color.r = lua_tointeger(L, -1);
-                        }
-                        else if (strcmp(property_name, "green") == 0)
-                        {
-                            sprite->color.g = lua_tointeger(L, -1);
-                        }
-                        else if (strcmp(property_name, "blue") == 0)
-                        {
-                            sprite->color.b = lua_tointeger(L, -1);
-                        }
-                        else if (strcmp(property_name, "alpha") == 0)
-                        {
-                            sprite->color.a = lua_tointeger(L, -1);
-                        }
-                    }
-
-                    lua_pop(L, 1);
-                }
-            }
-
-            lua_getfield(L, 1, "x");
-            if (lua_isnumber(L, -1))
-            {
-                gameObject->transform->position.x = lua_tonumber(L, -1);
-                lua_pop(L, 1);
-            }
+        return 2;
+    }
 
-            lua_getfield(L, 1, "y");
-            if (lua_isnumber(L, -1))
-            {
-                gameObject->transform->position.y = lua_tonumber(L, -1);
-                lua_pop(L, 1);
-            }
+    static int GetPivot(lua_State *L)
+    {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
+        GameObject *gameObject = nullptr;
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
         }
         else
         {
-            return luaL_error(L, "setTable Invalid argument type, expected table");
+            return luaL_error(L, "[GetPivot] The First argument must be a gameObject");
         }
-        return 0;
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[GetPivot] gameObject is null");
+        }
+
+        float x, y;
+        x = gameObject->transform->pivot.x;
+        y = gameObject->transform->pivot.y;
+
+        lua_pushnumber(L, x);
+        lua_pushnumber(L, y);
+
+        return 2;
     }
 
-    static int sendMessageData(lua_State *L)
+    static int GetRotation(lua_State *L)
     {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 2)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "[sendMessage]  function requires 1 arguments");
+            gameObject = GameObject::FromLua(L, 1);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[sendMessage] gameObject is null");
-                return 0;
-            }
-
-            if (gameObject->script)
-            {
-                gameObject->sendMensageAll();
-            }
+            return luaL_error(L, "[GetRotation] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[sendMessage]  Invalid argument type, expected table");
+            return luaL_error(L, "[GetRotation] gameObject is null");
         }
 
-        return 0;
+        float x;
+        x = gameObject->transform->rotation;
+
+        lua_pushnumber(L, x);
+
+        return 1;
     }
 
-    static int sendMessageDataTo(lua_State *L)
+    static int GetWorldRotation(lua_State *L)
     {
+        // return luaL_error(L, "[CPP] getX %d ", lua_gettop(L));
         GameObject *gameObject = nullptr;
-        const char *name = nullptr;
-
-        if (lua_gettop(L) != 3)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "[sendMessageTo]  function requires 2 arguments");
+            gameObject = GameObject::FromLua(L, 1);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[sendMessageTo] gameObject is null");
-            }
-            if (lua_isstring(L, -1))
-            {
-                name = lua_tostring(L, -1);
-                if (gameObject->script && name != nullptr)
-                {
-                    //  return luaL_error(L, "sendMensageTo %s", name);
-                    gameObject->sendMensageTo(name);
-                }
-            }
-            else
-            {
-                return luaL_error(L, "[sendMessageTo]  Invalid argument type, expected string");
-            }
+            return luaL_error(L, "[GetWorldRotation] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[sendMessageTo]  Invalid argument type, expected table");
+            return luaL_error(L, "[GetWorldRotation] gameObject is null");
         }
 
-        return 0;
+        float x;
+        x = gameObject->GetWorldAngle();
+
+        lua_pushnumber(L, x);
+
+        return 1;
     }
 
-    static int PlaceFree(lua_State *L)
+    static int GetX(lua_State *L)
     {
+
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 3)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "[place_free]  function requires 2 arguments");
+            gameObject = GameObject::FromLua(L, 1);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[place_free] gameObject is null");
-            }
-
-            float x = lua_tonumber(L, 2);
-            float y = lua_tonumber(L, 3);
-
-            bool isFree = gameObject->place_free(x, y);
-            lua_pushboolean(L, isFree);
+            return luaL_error(L, "[GetX] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[place_free]  Invalid argument type, expected table");
+            return luaL_error(L, "[GetX] gameObject is null");
         }
 
+        float x;
+        x = gameObject->transform->position.x;
+
+        lua_pushnumber(L, x);
+
         return 1;
     }
 
-    static int PlaceMeeting(lua_State *L)
+    static int GetY(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 4)
+
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "[place_meeting]  function requires 3 arguments");
+            gameObject = GameObject::FromLua(L, 1);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[place_meeting] gameObject is null");
-            }
-
-            float x = lua_tonumber(L, 2);
-            float y = lua_tonumber(L, 3);
-            const char *name = lua_tostring(L, 4);
-
-            bool isFree = gameObject->place_meeting(x, y, name);
-            lua_pushboolean(L, isFree);
-
-            return 1;
+            return luaL_error(L, "[GetY] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[place_meeting]  Invalid argument type, expected table");
+            return luaL_error(L, "[GetY] gameObject is null");
         }
 
-        return 0;
+        float y;
+        y = gameObject->transform->position.y;
+
+        lua_pushnumber(L, y);
+
+        return 1;
     }
 
-    static int LayerPlaceMeeting(lua_State *L)
+    static int GetWorldX(lua_State *L)
     {
+
         GameObject *gameObject = nullptr;
-        if (lua_gettop(L) != 4)
+        if (lua_isuserdata(L, 1))
         {
-            return luaL_error(L, "[layer_place_meeting]  function requires 3 arguments");
+            gameObject = GameObject::FromLua(L, 1);
         }
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            if (gameObject == nullptr)
-            {
-                return luaL_error(L, "[layer_place_meeting] gameObject is null");
-            }
-
-            float x = lua_tonumber(L, 2);
-            float y = lua_tonumber(L, 3);
-            int layer = (int)lua_tonumber(L, 4);
-
-            bool isFree = gameObject->place_meeting_layer(x, y, layer);
-
-            lua_pushboolean(L, isFree);
-            return 1;
+            return luaL_error(L, "[GetWorldX] The First argument must be a gameObject");
         }
-        else
+
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[place_meeting]  Invalid argument type, expected table");
+            return luaL_error(L, "[GetWorldX] gameObject is null");
         }
 
-        return 0;
+        float x = gameObject->getWorldX();
+
+        lua_pushnumber(L, x);
+
+        return 1;
     }
 
-    static int LoadSprite(lua_State *L)
+    static int GetWorldY(lua_State *L)
     {
 
         GameObject *gameObject = nullptr;
-        const char *graph = nullptr;
-
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            graph = lua_tostring(L, 2);
+            gameObject = GameObject::FromLua(L, 1);
         }
         else
         {
-            luaL_error(L, "[addSprite] argument is not a table");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "[GetWorldY] The First argument must be a gameObject");
         }
 
-        if (gameObject != nullptr)
-        {
-            if (gameObject->HasComponent<SpriteComponent>())
-            {
-                luaL_error(L, "[addSprite] gameObject already has a SpriteComponent");
-                lua_pushnil(L);
-                return 1;
-            }
-
-            SpriteComponent *spr = gameObject->AddComponent<SpriteComponent>(graph);
-            spr->BindLua(L);
-            return 1;
-        }
-        else
+        if (gameObject == nullptr)
         {
-            luaL_error(L, "[addSprite] gameObject is null");
+            return luaL_error(L, "[GetWorldY] gameObject is null");
         }
 
-        lua_pushnil(L);
+        float y = gameObject->getWorldY();
+
+        lua_pushnumber(L, y);
+
         return 1;
     }
 
-    static int LoadTileLayer(lua_State *L)
+    static int Kill(lua_State *L)
     {
-
         GameObject *gameObject = nullptr;
 
-        if (lua_gettop(L) < 6 || lua_gettop(L) > 9)
+        if (lua_isuserdata(L, 1))
         {
-
-            luaL_error(L, "addTiles function requires 5/7 arguments");
-            lua_pushnil(L);
-            return 1;
+            gameObject = GameObject::FromLua(L, 1);
         }
-
-        if (lua_istable(L, 1))
+        else
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "kill Invalid argument type, expected gameObject");
         }
-        else
-        {
-            luaL_error(L, "[addTiles] argument is not a table");
-            lua_pushnil(L);
-            return 1;
-        }
-
-        if (gameObject != nullptr)
-        {
-            if (gameObject->HasComponent<TileLayerComponent>())
-            {
-                luaL_error(L, "[addTiles] gameObject already has a TileLayerComponent");
-                lua_pushnil(L);
-                return 1;
-            }
-            //  TileLayerComponent(int width, int height, int tileWidth, int tileHeight, int spacing, int margin, const std::string &fileName);
-
-            int width = (int)lua_tonumber(L, 2);
-            int height = (int)lua_tonumber(L, 3);
-            int tileWidth = (int)lua_tonumber(L, 4);
-            int tileHeight = (int)lua_tonumber(L, 5);
-
-            const char *fileName = lua_tostring(L, 6);
-
-            int spacing = 0;
-            int margin = 0;
-
-            if (lua_gettop(L) == 9)
-            {
-                spacing = (int)lua_tonumber(L, 8);
-                margin = (int)lua_tonumber(L, 9);
-            }
-            //   return luaL_error(L, "addTiles %d %d %d %d %d %d %s", width, height, tileWidth, tileHeight, spacing, margin, fileName);
-
-            TileLayerComponent *spr = gameObject->AddComponent<TileLayerComponent>(
-                width, height,
-                tileWidth, tileHeight,
-                spacing, margin, fileName);
-
-
-            spr->BindLua(L);
 
-            return 1;
-        }
-        else
+        if (gameObject == nullptr)
         {
-            Log(LOG_ERROR, "[addTiles] gameObject is null");
+            return luaL_error(L, "[Kill] gameObject is null");
         }
 
-        lua_pushnil(L);
-        return 1;
+        gameObject->alive = false;
+
+        return 0;
     }
-    static int GetSprite(lua_State *L)
-    {
 
+    static int CenterOrigin(lua_State *L)
+    {
         GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
         }
         else
         {
-            luaL_error(L, "[getSprite] argument is not a table");
-            lua_pushnil(L);
+            return luaL_error(L, "centerOrigin Invalid argument type, expected gameObject");
         }
 
-        if (gameObject != nullptr)
-        {
-            if (!gameObject->HasComponent<SpriteComponent>())
-            {
-                Log(LOG_ERROR, "[getSprite] gameObject has no SpriteComponent");
-                lua_pushnil(L);
-            }
-            else
-            {
-                SpriteComponent *spr = gameObject->GetComponent<SpriteComponent>();
-                if (spr->table_ref == LUA_NOREF)
-                {
-                    spr->BindLua(L);
-                }
-                lua_rawgeti(L, LUA_REGISTRYINDEX, spr->table_ref);
-                return 1;
-            }
-        }
-        else
+        if (gameObject == nullptr)
         {
-            luaL_error(L, "[getSprite] gameObject is null");
+            return luaL_error(L, "[centerOrigin] gameObject is null");
         }
 
-        lua_pushnil(L);
-        return 1;
+        gameObject->centerOrigin();
+
+        return 0;
     }
 
-    static int LoadScript(lua_State *L)
+    static int Advance(lua_State *L)
     {
-
         GameObject *gameObject = nullptr;
-        const char *script = nullptr;
+        float speed, off = 0;
 
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            script = lua_tostring(L, 2);
+            gameObject = GameObject::FromLua(L, 1);
+            speed = lua_tonumber(L, 2);
+            if (lua_gettop(L) == 3)
+            {
+                off = lua_tonumber(L, 3);
+            }
         }
         else
         {
-            luaL_error(L, "[addScript] argument is not a table");
-            lua_pushboolean(L, false);
-            return 1;
+            return luaL_error(L, "advance Invalid argument type, expected gameObject");
         }
 
-        if (gameObject != nullptr)
-        {
-            if (gameObject->script != nullptr)
-            {
-                luaL_error(L, "[addScript] gameObject already has a ScriptComponent");
-                lua_pushboolean(L, false);
-                return 1;
-            }
-
-            gameObject->createScript(script, L);
-            lua_pushboolean(L, true);
-
-            return 1;
-        }
-        else
+        if (gameObject == nullptr)
         {
-            luaL_error(L, "[addSprite] gameObject is null");
+            return luaL_error(L, "[Advance] gameObject is null");
         }
 
-        lua_pushboolean(L, false);
-        return 1;
+        gameObject->transform->position.x += cos((gameObject->transform->rotation + off) * RAD) * speed;
+        gameObject->transform->position.y += sin((gameObject->transform->rotation + off) * RAD) * speed;
+
+        return 0;
     }
 
-    static int GameAddChild(lua_State *L)
+    static int XAdvance(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-        GameObject *gameChild = nullptr;
+        float speed, to = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+            gameObject = GameObject::FromLua(L, 1);
+            speed = lua_tonumber(L, 2);
+            to = lua_tonumber(L, 3);
         }
         else
         {
-            return luaL_error(L, "[addChild] The First argument must be a table");
+            return luaL_error(L, "xAdvance Invalid argument type, expected gameObject");
         }
 
         if (gameObject == nullptr)
         {
-            return luaL_error(L, "[addChild] gameObject is null");
+            return luaL_error(L, "[XAdvance] gameObject is null");
+        }
+
+        gameObject->transform->position.x += cos(to * RAD) * speed;
+        gameObject->transform->position.y += sin(to * RAD) * speed;
+
+        return 0;
+    }
+
+    static int AddBoxCollider(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        float x = 0, y = 0, w = 0, h = 0;
+
+        if (lua_gettop(L) != 5)
+        {
+            return luaL_error(L, "addBoxCollider function requires 4 arguments");
         }
 
-        if (lua_istable(L, 2))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 2, "gameObject");
-            gameChild = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 2);
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
+            w = lua_tonumber(L, 4);
+            h = lua_tonumber(L, 5);
         }
         else
         {
-            return luaL_error(L, "[addChild] The Second argument must be a table");
+            return luaL_error(L, "addBoxCollider Invalid argument type, expected gameObject");
         }
 
-        if (gameChild == nullptr)
+        if (gameObject == nullptr)
         {
-            return luaL_error(L, "[addChild] gameChild is null");
+            return luaL_error(L, "[addBoxCollider] gameObject is null");
         }
-        gameObject->addChild(gameChild);
+
+        gameObject->AddComponent<BoxColiderComponent>(x, y, w, h);
 
         return 0;
     }
 
-    static int SetDebug(lua_State *L)
+    static int AddCircleCollider(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        float x = 0, y = 0, r = 0;
 
-        if (lua_istable(L, 1))
+        if (lua_gettop(L) != 4)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1); // Remova o ponteiro do GameObject da pilha
+            return luaL_error(L, "addCircleCollider function requires 3 arguments");
+        }
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            x = lua_tonumber(L, 2);
+            y = lua_tonumber(L, 3);
+            r = lua_tonumber(L, 4);
         }
         else
         {
-            return luaL_error(L, "SetDebug Invalid argument type, expected table");
+            return luaL_error(L, "addCircleCollider Invalid argument type, expected gameObject");
         }
 
         if (gameObject == nullptr)
         {
-            return luaL_error(L, "[setDebug] gameObject is null");
+            return luaL_error(L, "[addCircleCollider] gameObject is null");
         }
 
-        int mask = lua_tointeger(L, 2);
-        gameObject->setDebug(mask);
+        gameObject->AddComponent<CircleColiderComponent>(x, y, r);
 
         return 0;
     }
 
-    static int SetSolid(lua_State *L)
+    static int SetSpriteColor(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 5)
+        {
+            return luaL_error(L, "setSpriteColor function requires 4 arguments");
+        }
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[setSolid] gameObject is null");
+                return luaL_error(L, "[setSpriteColor] gameObject is null");
             }
-
-            bool mode = lua_toboolean(L, 2);
-            gameObject->solid = mode;
+            if (gameObject->HasComponent<SpriteComponent>() == false)
+            {
+                return luaL_error(L, "[setSpriteColor] gameObject has no sprite component");
+            }
+            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
+            sprite->color.r = lua_tonumber(L, 2);
+            sprite->color.g = lua_tonumber(L, 3);
+            sprite->color.b = lua_tonumber(L, 4);
+            sprite->color.a = lua_tonumber(L, 5);
         }
         else
         {
-            return luaL_error(L, "setSolid Invalid argument type, expected table");
+            return luaL_error(L, "setSpriteColor Invalid argument type, expected gameObject");
         }
 
         return 0;
     }
 
-    static int SetActive(lua_State *L)
+    static int SetSpriteFlip(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 3)
+        {
+            return luaL_error(L, "setSpriteFlip function requires 3 arguments");
+        }
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[setActive] gameObject is null");
+                return luaL_error(L, "[setSpriteFlip] gameObject is null");
             }
-
-            bool mode = lua_toboolean(L, 2);
-            gameObject->active = mode;
+            if (gameObject->HasComponent<SpriteComponent>() == false)
+            {
+                return luaL_error(L, "[setSpriteFlip] gameObject has no sprite component");
+            }
+            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
+            sprite->FlipX = lua_toboolean(L, 2);
+            sprite->FlipY = lua_toboolean(L, 3);
         }
         else
         {
-            return luaL_error(L, "setActive Invalid argument type, expected table");
+            return luaL_error(L, "setSpriteColor Invalid argument type, expected gameObject");
         }
 
         return 0;
     }
-    static int SetVisible(lua_State *L)
+
+    static int SetSpriteClip(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-
-        if (lua_istable(L, 1))
+        if (lua_gettop(L) != 5)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "setSpriteClip function requires 4 arguments");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[setVisible] gameObject is null");
+                return luaL_error(L, "[setSpriteClip] gameObject is null");
             }
-
-            bool mode = lua_toboolean(L, 2);
-            gameObject->visible = mode;
+            if (gameObject->HasComponent<SpriteComponent>() == false)
+            {
+                return luaL_error(L, "[setSpriteClip] gameObject has no sprite component");
+            }
+            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
+            sprite->clip.x = lua_tonumber(L, 2);
+            sprite->clip.y = lua_tonumber(L, 3);
+            sprite->clip.width = lua_tonumber(L, 4);
+            sprite->clip.height = lua_tonumber(L, 5);
         }
         else
         {
-            return luaL_error(L, "setVisible Invalid argument type, expected table");
+            return luaL_error(L, "setSpriteColor Invalid argument type, expected gameObject");
         }
 
         return 0;
     }
 
-    static int SetPersistent(lua_State *L)
+    static int SetSpriteGraph(lua_State *L)
     {
         GameObject *gameObject = nullptr;
-
-        if (lua_istable(L, 1))
+        if (lua_gettop(L) != 2)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            return luaL_error(L, "setSpriteGraph function requires 1 argument");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[setPersistent] gameObject is null");
+                return luaL_error(L, "[setSpriteGraph] gameObject is null");
+            }
+            if (gameObject->HasComponent<SpriteComponent>() == false)
+            {
+                return luaL_error(L, "[setSpriteGraph] gameObject has no sprite component");
+            }
+            SpriteComponent *sprite = gameObject->GetComponent<SpriteComponent>();
+            const char *graph = lua_tostring(L, 2);
+            if (Assets::Instance().hasGraph(graph))
+            {
+                sprite->SetGraph(Assets::Instance().getGraph(graph));
+            }
+            else
+            {
+                return luaL_error(L, "[setSpriteGraph] graph %s not found", graph);
             }
-
-            bool mode = lua_toboolean(L, 2);
-            gameObject->persistent = mode;
         }
         else
         {
-            return luaL_error(L, "setPersistent Invalid argument type, expected table");
+            return luaL_error(L, "setSpriteGraph Invalid argument type, expected gameObject");
         }
 
         return 0;
     }
-    static int SetPrefab(lua_State *L)
+    //*********************************************************************************************************************
+    static int AddAnimator(lua_State *L)
     {
         GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[SetPrefab] gameObject is null");
+                return luaL_error(L, "[addAnimator] gameObject is null");
             }
-
-            bool mode = lua_toboolean(L, 2);
-            gameObject->prefab = mode;
+            if (gameObject->HasComponent<Animator>())
+            {
+                return luaL_error(L, "[addAnimation] gameObject has already a animator component");
+            }
+            Animator *an = gameObject->AddComponent<Animator>();
+            ///  an->AddRow("run", "player_run", 10,12);
+            // an->SetAnimation("run");
+            // an->Play();
+            an->BindLua(L);
+            return 1;
         }
         else
         {
-            return luaL_error(L, "SetPrefab Invalid argument type, expected table");
+            return luaL_error(L, "addAnimator Invalid argument type, expected gameObject");
         }
 
-        return 0;
+        lua_pushnil(L);
+        return 1;
     }
 
-    static int SetCollidable(lua_State *L)
+    static int getAnimator(lua_State *L)
     {
         GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
-                return luaL_error(L, "[SetCollidable] gameObject is null");
+                return luaL_error(L, "[getAnimator] gameObject is null");
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[getAnimator] gameObject has no animator component");
             }
+            Animator *animation = gameObject->GetComponent<Animator>();
 
-            bool mode = lua_toboolean(L, 2);
-            gameObject->collidable = mode;
+            if (animation->table_ref == LUA_NOREF)
+            {
+                animation->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, animation->table_ref);
+            return 1;
         }
         else
         {
-            return luaL_error(L, "SetCollidable Invalid argument type, expected table");
+            return luaL_error(L, "getAnimator Invalid argument type, expected gameObject");
         }
 
-        return 0;
+        lua_pushnil(L);
+        return 1;
     }
 
-    static int GetState(lua_State *L)
+    static int SetAnimation(lua_State *L)
     {
 
-        GameObject *gameObject = nullptr;
-        const char *state = nullptr;
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            state = lua_tostring(L, 2);
-        }
-        else
+        if (lua_gettop(L) <= 1)
         {
-            luaL_error(L, "[getState] Invalid argument type, expected table");
-            lua_pushboolean(L, false);
-            return 1;
+            return luaL_error(L, "setAnimation function requires 1/2 arguments");
         }
+        GameObject *gameObject = nullptr;
 
-        if (strcmp(state, "Visible") == 0)
-        {
-            lua_pushboolean(L, gameObject->visible);
-            return 1;
-        }
-        else if (strcmp(state, "Active") == 0)
-        {
-            lua_pushboolean(L, gameObject->active);
-            return 1;
-        }
-        else if (strcmp(state, "Persistent") == 0)
+        if (lua_isuserdata(L, 1))
         {
-            lua_pushboolean(L, gameObject->persistent);
-            return 1;
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setAnimation] gameObject is null");
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[setAnimation] gameObject has no animator component");
+            }
+            Animator *animation = gameObject->GetComponent<Animator>();
+            const char *name = lua_tostring(L, 2);
+            bool now = false;
+
+            if (lua_gettop(L) == 3)
+            {
+                now = lua_toboolean(L, 3);
+            }
+
+            animation->SetAnimation(name, now);
+            if (now)
+            {
+                // return luaL_error(L, "play animation %s", name);
+                animation->Play();
+            }
         }
-        else if (strcmp(state, "Prefab") == 0)
+        else
         {
-            lua_pushboolean(L, gameObject->prefab);
-            return 1;
+            return luaL_error(L, "setAnimation Invalid argument type, expected gameObject");
         }
-        else if (strcmp(state, "Collidable") == 0)
+
+        return 0;
+    }
+
+    static int PlayAnimation(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 2)
         {
-            lua_pushboolean(L, gameObject->collidable);
-            return 1;
+            return luaL_error(L, "playAnimation function requires 1 argument");
         }
-        else if (strcmp(state, "Pickable") == 0)
+        if (lua_isuserdata(L, 1))
         {
-            lua_pushboolean(L, gameObject->pickable);
-            return 1;
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[playAnimation] gameObject is null");
+                return 0;
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[playAnimation] gameObject has no animator component");
+            }
+            Animator *animation = gameObject->GetComponent<Animator>();
+            animation->Play();
         }
-        else if (strcmp(state, "Solid") == 0)
+        else
         {
-            lua_pushboolean(L, gameObject->solid);
-            return 1;
+            return luaL_error(L, "playAnimation Invalid argument type, expected gameObject");
         }
 
-        luaL_error(L, "[getState] Unknown state");
-        lua_pushboolean(L, false);
-        return 1;
+        return 0;
     }
 
-    static int SetState(lua_State *L)
+    static int StopAnimation(lua_State *L)
     {
-
         GameObject *gameObject = nullptr;
-        const char *state = nullptr;
-        bool mode = false;
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
+
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            state = lua_tostring(L, 2);
-            mode = lua_toboolean(L, 3);
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[stopAnimation] gameObject is null");
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[stopAnimation] gameObject has no animator component");
+            }
+            Animator *animation = gameObject->GetComponent<Animator>();
+            animation->Stop();
         }
         else
         {
-            luaL_error(L, "[SetState] Invalid argument type, expected table");
-            lua_pushboolean(L, false);
-            return 1;
+            return luaL_error(L, "stopAnimation Invalid argument type, expected gameObject");
         }
 
-        if (strcmp(state, "Visible") == 0)
-        {
-            gameObject->visible = mode;
-        }
-        else if (strcmp(state, "Active") == 0)
-        {
-            gameObject->active = mode;
-        }
-        else if (strcmp(state, "Persistent") == 0)
-        {
-            gameObject->persistent = mode;
-        }
-        else if (strcmp(state, "Prefab") == 0)
-        {
-            gameObject->prefab = mode;
-        }
-        else if (strcmp(state, "Solid") == 0)
+        return 0;
+    }
+    static int PauseAnimation(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
         {
-            gameObject->solid = mode;
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[pauseAnimation] gameObject is null");
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[pauseAnimation] gameObject has no animator component");
+            }
+            Animator *animation = gameObject->GetComponent<Animator>();
+            animation->Pause();
         }
-        else if (strcmp(state, "Collidable") == 0)
+        else
         {
-            gameObject->collidable = mode;
+            return luaL_error(L, "pauseAnimation Invalid argument type, expected gameObject");
         }
-        else if (strcmp(state, "Pickable") == 0)
+
+        return 0;
+    }
+
+    static int SetAnimationMode(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
         {
-            gameObject->pickable = mode;
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setAnimationMode] gameObject is null");
+            }
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[setAnimationMode] gameObject has no animator component");
+            }
+            Animator *animation = gameObject->GetComponent<Animator>();
+            int mode = lua_tointeger(L, 2);
+            animation->SetMode((AnimationMode)mode);
         }
         else
         {
-            luaL_error(L, "[setState] Unknown state");
-            lua_pushboolean(L, false);
-            return 1;
+            return luaL_error(L, "setAnimationMode Invalid argument type, expected gameObject");
         }
 
-        lua_pushboolean(L, true);
-        return 1;
+        return 0;
     }
 
-    static int lAddComponent(lua_State *L)
+    static int SetTable(lua_State *L)
     {
-
         GameObject *gameObject = nullptr;
-        const char *type = nullptr;
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
-        {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            type = lua_tostring(L, 2);
-        }
-        else
+        if (lua_gettop(L) != 2)
         {
-            luaL_error(L, "[addComponent] Invalid argument type, expected table");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "SetTable function requires 1 argument");
         }
+        // PrintLuaTable(L);
 
-        if (gameObject != nullptr && type != nullptr)
+        if (lua_isuserdata(L, 1))
         {
+            gameObject = GameObject::FromLua(L, 1);
 
-            if (strcmp(type, "Sprite") == 0)
+            if (gameObject == nullptr)
             {
+                return luaL_error(L, "[setTable] gameObject is null");
+            }
 
-                if (gameObject->HasComponent<SpriteComponent>())
-                {
-                    luaL_error(L, "[addComponent] gameObject already has a SpriteComponent");
-                    lua_pushnil(L);
-                    return 1;
-                }
-                const char *graph = lua_tostring(L, 3);
-                SpriteComponent *spr = gameObject->AddComponent<SpriteComponent>(graph);
-                spr->BindLua(L);
-                return 1;
+            if (!lua_istable(L, 2))
+            {
+                luaL_error(L, "[setTable] Argument must be a table");
             }
-            else if (strcmp(type, "Tiles") == 0)
+
+            ///  PrintLuaTable(L);
+
+            // float x = 0, y = 0, rotation = 0, scaleX = 1, scaleY = 1, pivotX = 0, pivotY = 0;
+            // int width = 0, height = 0, r = 0, g = 0, b = 0, a = 0, originX = 0, originY = 0;
+            // bool flipX = false, flipY = false;
+            SpriteComponent *sprite = nullptr;
+            bool useSprite = false;
+            if (gameObject->HasComponent<SpriteComponent>())
             {
-                if (gameObject->HasComponent<TileLayerComponent>())
+                sprite = gameObject->GetComponent<SpriteComponent>();
+                useSprite = true;
+            }
+
+            if (lua_istable(L, -1))
+            {
+                lua_pushnil(L);
+                while (lua_next(L, -2) != 0)
                 {
-                    luaL_error(L, "[addComponent] gameObject already has a TileLayerComponent");
-                    lua_pushnil(L);
-                    return 1;
-                }
+                    const char *property_name = lua_tostring(L, -2);
+                    //    const char *property_value = lua_tostring(L, -1);
 
-                int width = (int)lua_tonumber(L, 3);
-                int height = (int)lua_tonumber(L, 4);
-                int tileWidth = (int)lua_tonumber(L, 5);
-                int tileHeight = (int)lua_tonumber(L, 6);
+                    //   return luaL_error(L,     "Key:%s - Value:%s", property_name, property_value);
 
-                const char *fileName = lua_tostring(L, 7);
-                if (fileName == nullptr)
-                {
-                    luaL_error(L, "[addComponent] Invalid argument type, expected string");
-                    lua_pushnil(L);
-                    return 1;
-                }
+                    if (strcmp(property_name, "rotation") == 0)
+                    {
+                        gameObject->transform->rotation = lua_tonumber(L, -1);
+                        lua_pop(L, 1);
+                        continue;
+                    }
 
-                int spacing = 0;
-                int margin = 0;
+                    if (useSprite && sprite != nullptr)
+                    {
+                        if (strcmp(property_name, "red") == 0)
+                        {
+                            sprite->color.r = lua_tointeger(L, -1);
+                        }
+                        else if (strcmp(property_name, "green") == 0)
+                        {
+                            sprite->color.g = lua_tointeger(L, -1);
+                        }
+                        else if (strcmp(property_name, "blue") == 0)
+                        {
+                            sprite->color.b = lua_tointeger(L, -1);
+                        }
+                        else if (strcmp(property_name, "alpha") == 0)
+                        {
+                            sprite->color.a = lua_tointeger(L, -1);
+                        }
+                    }
 
-                if (lua_gettop(L) == 10)
-                {
-                    spacing = (int)lua_tonumber(L, 8);
-                    margin = (int)lua_tonumber(L, 9);
+                    lua_pop(L, 1);
                 }
-                //   return luaL_error(L, "addTiles %d %d %d %d %d %d %s", width, height, tileWidth, tileHeight, spacing, margin, fileName);
-
-                TileLayerComponent *spr = gameObject->AddComponent<TileLayerComponent>(
-                    width, height, tileWidth, tileHeight, spacing, margin, fileName);
-                spr->BindLua(L);
+            }
 
-                return 1;
+            lua_getfield(L, 1, "x");
+            if (lua_isnumber(L, -1))
+            {
+                gameObject->transform->position.x = lua_tonumber(L, -1);
+                lua_pop(L, 1);
             }
-            else if (strcmp(type, "Animator") == 0)
+
+            lua_getfield(L, 1, "y");
+            if (lua_isnumber(L, -1))
             {
-                if (gameObject->HasComponent<Animator>())
-                {
-                    luaL_error(L, "[addComponent] gameObject already has a AnimatorComponent");
-                    lua_pushnil(L);
-                    return 1;
-                }
+                gameObject->transform->position.y = lua_tonumber(L, -1);
+                lua_pop(L, 1);
+            }
+        }
+        else
+        {
+            return luaL_error(L, "setTable Invalid argument type, expected gameObject");
+        }
+        return 0;
+    }
 
-                Animator *an = gameObject->AddComponent<Animator>();
-                an->BindLua(L);
-                return 1;
+    static int sendMessageData(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 2)
+        {
+            return luaL_error(L, "[sendMessage]  function requires 1 arguments");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[sendMessage] gameObject is null");
+                return 0;
             }
-            else
+
+            if (gameObject->script)
             {
-                luaL_error(L, "[addComponent] invalid component type");
-                lua_pushnil(L);
-                return 1;
+                MessageBus::Instance().Publish(L, 2, gameObject, MessageBus::Broadcast);
             }
         }
         else
         {
-            luaL_error(L, "[AddComponent] gameObject is null");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "[sendMessage]  Invalid argument type, expected gameObject");
         }
 
-        lua_pushnil(L);
-        return 1;
+        return 0;
     }
 
-    static int lGetComponent(lua_State *L)
+    static int sendMessageDataTo(lua_State *L)
     {
         GameObject *gameObject = nullptr;
+        const char *name = nullptr;
 
-        const char *type = nullptr;
-        if (lua_istable(L, 1) && lua_isstring(L, 2))
+        if (lua_gettop(L) != 3)
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
-            type = lua_tostring(L, 2);
+            return luaL_error(L, "[sendMessageTo]  function requires 2 arguments");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[sendMessageTo] gameObject is null");
+            }
+            if (lua_isstring(L, -1))
+            {
+                name = lua_tostring(L, -1);
+                if (gameObject->script && name != nullptr)
+                {
+                    //  return luaL_error(L, "sendMensageTo %s", name);
+                    MessageBus::Instance().Publish(L, 2, gameObject, MessageBus::Broadcast, name);
+                }
+            }
+            else
+            {
+                return luaL_error(L, "[sendMessageTo]  Invalid argument type, expected string");
+            }
         }
         else
         {
-            luaL_error(L, "[getComponent] Invalid argument type, expected table");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "[sendMessageTo]  Invalid argument type, expected gameObject");
         }
 
+        return 0;
+    }
+
+    // self:subscribe(channel), payloads arrive in OnMessage(self, payload, channel)
+    static int Subscribe(lua_State *L)
+    {
+        GameObject *gameObject = GameObject::FromLua(L, 1);
+        const char *channel = luaL_checkstring(L, 2);
         if (gameObject == nullptr)
         {
-            luaL_error(L, "[getComponent] gameObject is null");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "[subscribe] gameObject is null");
+        }
+        if (gameObject->script == nullptr)
+        {
+            return luaL_error(L, "[subscribe] %s has no script", gameObject->name.c_str());
         }
+        lua_pushboolean(L, MessageBus::Instance().Subscribe(gameObject->script, channel));
+        return 1;
+    }
 
-        if (strcmp(type, "Sprite") == 0)
+    static int Unsubscribe(lua_State *L)
+    {
+        GameObject *gameObject = GameObject::FromLua(L, 1);
+        const char *channel = luaL_checkstring(L, 2);
+        if (gameObject == nullptr)
         {
-            if (gameObject->HasComponent<SpriteComponent>() == false)
-            {
-                return luaL_error(L, "[getComponent] gameObject has no SpriteComponent");
-            }
-            SpriteComponent *spr = gameObject->GetComponent<SpriteComponent>();
-            if (spr->table_ref == LUA_NOREF)
-            {
-                spr->BindLua(L);
-            }
-            lua_rawgeti(L, LUA_REGISTRYINDEX, spr->table_ref);
-            return 1;
+            return luaL_error(L, "[unsubscribe] gameObject is null");
         }
-        else if (strcmp(type, "Tiles") == 0)
+        bool removed = gameObject->script != nullptr && MessageBus::Instance().Unsubscribe(gameObject->script, channel);
+        lua_pushboolean(L, removed);
+        return 1;
+    }
+
+    // self:publish(channel, payload), delivered with the rest of the frame's messages
+    static int Publish(lua_State *L)
+    {
+        GameObject *gameObject = GameObject::FromLua(L, 1);
+        const char *channel = luaL_checkstring(L, 2);
+        if (gameObject == nullptr)
         {
-            if (gameObject->HasComponent<TileLayerComponent>() == false)
-            {
-                return luaL_error(L, "[getComponent] gameObject has no TileLayerComponent");
-            }
-            TileLayerComponent *tile = gameObject->GetComponent<TileLayerComponent>();
-            if (tile->table_ref == LUA_NOREF)
-            {
-                tile->BindLua(L);
-            }
-            lua_rawgeti(L, LUA_REGISTRYINDEX, tile->table_ref);
-            return 1;
+            return luaL_error(L, "[publish] gameObject is null");
         }
-        else if (strcmp(type, "Animator") == 0)
+        lua_settop(L, 3);
+        MessageBus::Instance().Publish(L, 3, gameObject, channel);
+        return 0;
+    }
+
+    static int PlaceFree(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 3)
         {
-            if (gameObject->HasComponent<Animator>() == false)
-            {
-                return luaL_error(L, "[getComponent] gameObject has no AnimatorComponent");
-            }
-            Animator *an = gameObject->GetComponent<Animator>();
-            if (an->table_ref == LUA_NOREF)
+            return luaL_error(L, "[place_free]  function requires 2 arguments");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            if (gameObject == nullptr)
             {
-                an->BindLua(L);
+                return luaL_error(L, "[place_free] gameObject is null");
             }
-            lua_rawgeti(L, LUA_REGISTRYINDEX, an->table_ref);
-            return 1;
+
+            float x = lua_tonumber(L, 2);
+            float y = lua_tonumber(L, 3);
+
+            bool isFree = gameObject->place_free(x, y);
+            lua_pushboolean(L, isFree);
         }
         else
         {
-            luaL_error(L, "[getComponent] invalid component type");
-            lua_pushnil(L);
-            return 1;
+            return luaL_error(L, "[place_free]  Invalid argument type, expected gameObject");
+        }
+
+        return 1;
+    }
+
+    static int PlaceMeeting(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 4)
+        {
+            return luaL_error(L, "[place_meeting]  function requires 3 arguments");
         }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[place_meeting] gameObject is null");
+            }
+
+            float x = lua_tonumber(L, 2);
+            float y = lua_tonumber(L, 3);
+            const char *name = lua_tostring(L, 4);
+
+            bool isFree = gameObject->place_meeting(x, y, name);
+            lua_pushboolean(L, isFree);
+
+            return 1;
+        }
+        else
+        {
+            return luaL_error(L, "[place_meeting]  Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int LayerPlaceMeeting(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        if (lua_gettop(L) != 4)
+        {
+            return luaL_error(L, "[layer_place_meeting]  function requires 3 arguments");
+        }
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[layer_place_meeting] gameObject is null");
+            }
+
+            float x = lua_tonumber(L, 2);
+            float y = lua_tonumber(L, 3);
+            int layer = (int)lua_tonumber(L, 4);
+
+            bool isFree = gameObject->place_meeting_layer(x, y, layer);
+
+            lua_pushboolean(L, isFree);
+            return 1;
+        }
+        else
+        {
+            return luaL_error(L, "[place_meeting]  Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int LoadSprite(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+        const char *graph = nullptr;
+
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            graph = lua_tostring(L, 2);
+        }
+        else
+        {
+            luaL_error(L, "[addSprite] argument is not a table");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (gameObject != nullptr)
+        {
+            if (gameObject->HasComponent<SpriteComponent>())
+            {
+                luaL_error(L, "[addSprite] gameObject already has a SpriteComponent");
+                lua_pushnil(L);
+                return 1;
+            }
+
+            SpriteComponent *spr = gameObject->AddComponent<SpriteComponent>(graph);
+            spr->BindLua(L);
+            return 1;
+        }
+        else
+        {
+            luaL_error(L, "[addSprite] gameObject is null");
+        }
+
+        lua_pushnil(L);
+        return 1;
+    }
+
+    static int LoadTileLayer(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+
+        if (lua_gettop(L) < 6 || lua_gettop(L) > 9)
+        {
+
+            luaL_error(L, "addTiles function requires 5/7 arguments");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            luaL_error(L, "[addTiles] argument is not a table");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (gameObject != nullptr)
+        {
+            if (gameObject->HasComponent<TileLayerComponent>())
+            {
+                luaL_error(L, "[addTiles] gameObject already has a TileLayerComponent");
+                lua_pushnil(L);
+                return 1;
+            }
+            //  TileLayerComponent(int width, int height, int tileWidth, int tileHeight, int spacing, int margin, const std::string &fileName);
+
+            int width = (int)lua_tonumber(L, 2);
+            int height = (int)lua_tonumber(L, 3);
+            int tileWidth = (int)lua_tonumber(L, 4);
+            int tileHeight = (int)lua_tonumber(L, 5);
+
+            const char *fileName = lua_tostring(L, 6);
+
+            int spacing = 0;
+            int margin = 0;
+
+            if (lua_gettop(L) == 9)
+            {
+                spacing = (int)lua_tonumber(L, 8);
+                margin = (int)lua_tonumber(L, 9);
+            }
+            //   return luaL_error(L, "addTiles %d %d %d %d %d %d %s", width, height, tileWidth, tileHeight, spacing, margin, fileName);
+
+            TileLayerComponent *spr = gameObject->AddComponent<TileLayerComponent>(
+                width, height,
+                tileWidth, tileHeight,
+                spacing, margin, fileName);
+
+
+            spr->BindLua(L);
+
+            return 1;
+        }
+        else
+        {
+            Log(LOG_ERROR, "[addTiles] gameObject is null");
+        }
+
+        lua_pushnil(L);
+        return 1;
+    }
+    static int GetSprite(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            luaL_error(L, "[getSprite] argument is not a table");
+            lua_pushnil(L);
+        }
+
+        if (gameObject != nullptr)
+        {
+            if (!gameObject->HasComponent<SpriteComponent>())
+            {
+                Log(LOG_ERROR, "[getSprite] gameObject has no SpriteComponent");
+                lua_pushnil(L);
+            }
+            else
+            {
+                SpriteComponent *spr = gameObject->GetComponent<SpriteComponent>();
+                if (spr->table_ref == LUA_NOREF)
+                {
+                    spr->BindLua(L);
+                }
+                lua_rawgeti(L, LUA_REGISTRYINDEX, spr->table_ref);
+                return 1;
+            }
+        }
+        else
+        {
+            luaL_error(L, "[getSprite] gameObject is null");
+        }
+
+        lua_pushnil(L);
+        return 1;
+    }
+
+    static int LoadScript(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+        const char *script = nullptr;
+
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            script = lua_tostring(L, 2);
+        }
+        else
+        {
+            luaL_error(L, "[addScript] argument is not a table");
+            lua_pushboolean(L, false);
+            return 1;
+        }
+
+        if (gameObject != nullptr)
+        {
+            if (gameObject->script != nullptr)
+            {
+                luaL_error(L, "[addScript] gameObject already has a ScriptComponent");
+                lua_pushboolean(L, false);
+                return 1;
+            }
+
+            gameObject->createScript(script, L);
+            lua_pushboolean(L, true);
+
+            return 1;
+        }
+        else
+        {
+            luaL_error(L, "[addSprite] gameObject is null");
+        }
+
+        lua_pushboolean(L, false);
+        return 1;
+    }
+
+    static int GameAddChild(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+        GameObject *gameChild = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            return luaL_error(L, "[addChild] The First argument must be a gameObject");
+        }
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[addChild] gameObject is null");
+        }
+
+        if (lua_isuserdata(L, 2))
+        {
+            gameChild = GameObject::FromLua(L, 2);
+        }
+        else
+        {
+            return luaL_error(L, "[addChild] The Second argument must be a gameObject");
+        }
+
+        if (gameChild == nullptr)
+        {
+            return luaL_error(L, "[addChild] gameChild is null");
+        }
+        gameObject->addChild(gameChild);
+
+        return 0;
+    }
+
+    static int SetDebug(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+        }
+        else
+        {
+            return luaL_error(L, "SetDebug Invalid argument type, expected gameObject");
+        }
+
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[setDebug] gameObject is null");
+        }
+
+        int mask = lua_tointeger(L, 2);
+        gameObject->setDebug(mask);
+
+        return 0;
+    }
+
+    static int SetSolid(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setSolid] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->solid = mode;
+        }
+        else
+        {
+            return luaL_error(L, "setSolid Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int SetActive(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setActive] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->active = mode;
+        }
+        else
+        {
+            return luaL_error(L, "setActive Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+    static int SetVisible(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setVisible] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->visible = mode;
+        }
+        else
+        {
+            return luaL_error(L, "setVisible Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int SetPersistent(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[setPersistent] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->persistent = mode;
+        }
+        else
+        {
+            return luaL_error(L, "setPersistent Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+    static int SetPrefab(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[SetPrefab] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->prefab = mode;
+        }
+        else
+        {
+            return luaL_error(L, "SetPrefab Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int SetCollidable(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        if (lua_isuserdata(L, 1))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[SetCollidable] gameObject is null");
+            }
+
+            bool mode = lua_toboolean(L, 2);
+            gameObject->collidable = mode;
+        }
+        else
+        {
+            return luaL_error(L, "SetCollidable Invalid argument type, expected gameObject");
+        }
+
+        return 0;
+    }
+
+    static int GetState(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+        const char *state = nullptr;
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            state = lua_tostring(L, 2);
+        }
+        else
+        {
+            luaL_error(L, "[getState] Invalid argument type, expected gameObject");
+            lua_pushboolean(L, false);
+            return 1;
+        }
+
+        if (strcmp(state, "Visible") == 0)
+        {
+            lua_pushboolean(L, gameObject->visible);
+            return 1;
+        }
+        else if (strcmp(state, "Active") == 0)
+        {
+            lua_pushboolean(L, gameObject->active);
+            return 1;
+        }
+        else if (strcmp(state, "Persistent") == 0)
+        {
+            lua_pushboolean(L, gameObject->persistent);
+            return 1;
+        }
+        else if (strcmp(state, "Prefab") == 0)
+        {
+            lua_pushboolean(L, gameObject->prefab);
+            return 1;
+        }
+        else if (strcmp(state, "Collidable") == 0)
+        {
+            lua_pushboolean(L, gameObject->collidable);
+            return 1;
+        }
+        else if (strcmp(state, "Pickable") == 0)
+        {
+            lua_pushboolean(L, gameObject->pickable);
+            return 1;
+        }
+        else if (strcmp(state, "Solid") == 0)
+        {
+            lua_pushboolean(L, gameObject->solid);
+            return 1;
+        }
+
+        luaL_error(L, "[getState] Unknown state");
+        lua_pushboolean(L, false);
+        return 1;
+    }
+
+    static int SetState(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+        const char *state = nullptr;
+        bool mode = false;
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            state = lua_tostring(L, 2);
+            mode = lua_toboolean(L, 3);
+        }
+        else
+        {
+            luaL_error(L, "[SetState] Invalid argument type, expected gameObject");
+            lua_pushboolean(L, false);
+            return 1;
+        }
+
+        if (strcmp(state, "Visible") == 0)
+        {
+            gameObject->visible = mode;
+        }
+        else if (strcmp(state, "Active") == 0)
+        {
+            gameObject->active = mode;
+        }
+        else if (strcmp(state, "Persistent") == 0)
+        {
+            gameObject->persistent = mode;
+        }
+        else if (strcmp(state, "Prefab") == 0)
+        {
+            gameObject->prefab = mode;
+        }
+        else if (strcmp(state, "Solid") == 0)
+        {
+            gameObject->solid = mode;
+        }
+        else if (strcmp(state, "Collidable") == 0)
+        {
+            gameObject->collidable = mode;
+        }
+        else if (strcmp(state, "Pickable") == 0)
+        {
+            gameObject->pickable = mode;
+        }
+        else
+        {
+            luaL_error(L, "[setState] Unknown state");
+            lua_pushboolean(L, false);
+            return 1;
+        }
+
+        lua_pushboolean(L, true);
+        return 1;
+    }
+
+    static int lAddComponent(lua_State *L)
+    {
+
+        GameObject *gameObject = nullptr;
+        const char *type = nullptr;
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            type = lua_tostring(L, 2);
+        }
+        else
+        {
+            luaL_error(L, "[addComponent] Invalid argument type, expected gameObject");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (gameObject != nullptr && type != nullptr)
+        {
+
+            if (strcmp(type, "Sprite") == 0)
+            {
+
+                if (gameObject->HasComponent<SpriteComponent>())
+                {
+                    luaL_error(L, "[addComponent] gameObject already has a SpriteComponent");
+                    lua_pushnil(L);
+                    return 1;
+                }
+                const char *graph = lua_tostring(L, 3);
+                SpriteComponent *spr = gameObject->AddComponent<SpriteComponent>(graph);
+                spr->BindLua(L);
+                return 1;
+            }
+            else if (strcmp(type, "Tiles") == 0)
+            {
+                if (gameObject->HasComponent<TileLayerComponent>())
+                {
+                    luaL_error(L, "[addComponent] gameObject already has a TileLayerComponent");
+                    lua_pushnil(L);
+                    return 1;
+                }
+
+                int width = (int)lua_tonumber(L, 3);
+                int height = (int)lua_tonumber(L, 4);
+                int tileWidth = (int)lua_tonumber(L, 5);
+                int tileHeight = (int)lua_tonumber(L, 6);
+
+                const char *fileName = lua_tostring(L, 7);
+                if (fileName == nullptr)
+                {
+                    luaL_error(L, "[addComponent] Invalid argument type, expected string");
+                    lua_pushnil(L);
+                    return 1;
+                }
+
+                int spacing = 0;
+                int margin = 0;
+
+                if (lua_gettop(L) == 10)
+                {
+                    spacing = (int)lua_tonumber(L, 8);
+                    margin = (int)lua_tonumber(L, 9);
+                }
+                //   return luaL_error(L, "addTiles %d %d %d %d %d %d %s", width, height, tileWidth, tileHeight, spacing, margin, fileName);
+
+                TileLayerComponent *spr = gameObject->AddComponent<TileLayerComponent>(
+                    width, height, tileWidth, tileHeight, spacing, margin, fileName);
+                spr->BindLua(L);
+
+                return 1;
+            }
+            else if (strcmp(type, "Animator") == 0)
+            {
+                if (gameObject->HasComponent<Animator>())
+                {
+                    luaL_error(L, "[addComponent] gameObject already has a AnimatorComponent");
+                    lua_pushnil(L);
+                    return 1;
+                }
+
+                Animator *an = gameObject->AddComponent<Animator>();
+                an->BindLua(L);
+                return 1;
+            }
+            else if (strcmp(type, "Parallax") == 0)
+            {
+                if (gameObject->HasComponent<ParallaxComponent>())
+                {
+                    luaL_error(L, "[addComponent] gameObject already has a ParallaxComponent");
+                    lua_pushnil(L);
+                    return 1;
+                }
+
+                ParallaxComponent *parallax = gameObject->AddComponent<ParallaxComponent>();
+                parallax->BindLua(L);
+                return 1;
+            }
+            else if (strcmp(type, "Text") == 0)
+            {
+                if (gameObject->HasComponent<TextComponent>())
+                {
+                    luaL_error(L, "[addComponent] gameObject already has a TextComponent");
+                    lua_pushnil(L);
+                    return 1;
+                }
+
+                const char *text = lua_tostring(L, 3);
+                int size = 10;
+                if (lua_gettop(L) >= 4)
+                    size = (int)lua_tonumber(L, 4);
+
+                TextComponent *txt = gameObject->AddComponent<TextComponent>(text ? text : "", size);
+                txt->BindLua(L);
+                return 1;
+            }
+            else
+            {
+                luaL_error(L, "[addComponent] invalid component type");
+                lua_pushnil(L);
+                return 1;
+            }
+        }
+        else
+        {
+            luaL_error(L, "[AddComponent] gameObject is null");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        lua_pushnil(L);
+        return 1;
+    }
+
+    static int lGetComponent(lua_State *L)
+    {
+        GameObject *gameObject = nullptr;
+
+        const char *type = nullptr;
+        if (lua_isuserdata(L, 1) && lua_isstring(L, 2))
+        {
+            gameObject = GameObject::FromLua(L, 1);
+            type = lua_tostring(L, 2);
+        }
+        else
+        {
+            luaL_error(L, "[getComponent] Invalid argument type, expected gameObject");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (gameObject == nullptr)
+        {
+            luaL_error(L, "[getComponent] gameObject is null");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (strcmp(type, "Sprite") == 0)
+        {
+            if (gameObject->HasComponent<SpriteComponent>() == false)
+            {
+                return luaL_error(L, "[getComponent] gameObject has no SpriteComponent");
+            }
+            SpriteComponent *spr = gameObject->GetComponent<SpriteComponent>();
+            if (spr->table_ref == LUA_NOREF)
+            {
+                spr->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, spr->table_ref);
+            return 1;
+        }
+        else if (strcmp(type, "Tiles") == 0)
+        {
+            if (gameObject->HasComponent<TileLayerComponent>() == false)
+            {
+                return luaL_error(L, "[getComponent] gameObject has no TileLayerComponent");
+            }
+            TileLayerComponent *tile = gameObject->GetComponent<TileLayerComponent>();
+            if (tile->table_ref == LUA_NOREF)
+            {
+                tile->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, tile->table_ref);
+            return 1;
+        }
+        else if (strcmp(type, "Animator") == 0)
+        {
+            if (gameObject->HasComponent<Animator>() == false)
+            {
+                return luaL_error(L, "[getComponent] gameObject has no AnimatorComponent");
+            }
+            Animator *an = gameObject->GetComponent<Animator>();
+            if (an->table_ref == LUA_NOREF)
+            {
+                an->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, an->table_ref);
+            return 1;
+        }
+        else if (strcmp(type, "Parallax") == 0)
+        {
+            if (gameObject->HasComponent<ParallaxComponent>() == false)
+            {
+                return luaL_error(L, "[getComponent] gameObject has no ParallaxComponent");
+            }
+            ParallaxComponent *parallax = gameObject->GetComponent<ParallaxComponent>();
+            if (parallax->table_ref == LUA_NOREF)
+            {
+                parallax->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, parallax->table_ref);
+            return 1;
+        }
+        else if (strcmp(type, "Text") == 0)
+        {
+            if (gameObject->HasComponent<TextComponent>() == false)
+            {
+                return luaL_error(L, "[getComponent] gameObject has no TextComponent");
+            }
+            TextComponent *txt = gameObject->GetComponent<TextComponent>();
+            if (txt->table_ref == LUA_NOREF)
+            {
+                txt->BindLua(L);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, txt->table_ref);
+            return 1;
+        }
+        else
+        {
+            luaL_error(L, "[getComponent] invalid component type");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // fields scripts read and write directly (obj.x = obj.x + 1) instead of going
+    // through setPosition/getX; keys are resolved with a perfect hash on
+    // length, first and last character, then confirmed with one strcmp
+    enum Property
+    {
+        PropX,
+        PropY,
+        PropRotation,
+        PropScaleX,
+        PropScaleY,
+        PropVisible,
+        PropActive,
+        PropName,
+        PropCount
+    };
+
+    static const char *propertyNames[PropCount] = {"x", "y", "rotation", "scaleX", "scaleY", "visible", "active", "name"};
+
+    const int PropertySlots = 32;
+    static int propertySlots[PropertySlots];
+    static unsigned int propertySeed = 0;
+
+    static unsigned int PropertyHash(const char *key, size_t len, unsigned int seed)
+    {
+        unsigned int h = (unsigned int)len * 0x9E3779B1u;
+        h ^= (unsigned char)key[0] * 0x85EBCA6Bu;
+        h ^= (unsigned char)key[len - 1] * 0xC2B2AE35u;
+        return (h * seed) >> 27;
+    }
+
+    static void BuildPropertySlots()
+    {
+        if (propertySeed != 0)
+            return;
+        for (unsigned int seed = 1; seed < 0x10000; seed += 2)
+        {
+            for (int i = 0; i < PropertySlots; i++)
+                propertySlots[i] = -1;
+            bool collision = false;
+            for (int id = 0; id < PropCount && !collision; id++)
+            {
+                unsigned int slot = PropertyHash(propertyNames[id], strlen(propertyNames[id]), seed);
+                if (propertySlots[slot] != -1)
+                    collision = true;
+                else
+                    propertySlots[slot] = id;
+            }
+            if (!collision)
+            {
+                propertySeed = seed;
+                return;
+            }
+        }
+        Log(LOG_ERROR, "No perfect hash for gameObject properties");
+    }
+
+    static int FindProperty(lua_State *L, int index)
+    {
+        if (lua_type(L, index) != LUA_TSTRING || propertySeed == 0)
+            return -1;
+        size_t len = 0;
+        const char *key = lua_tolstring(L, index, &len);
+        if (len == 0)
+            return -1;
+        int id = propertySlots[PropertyHash(key, len, propertySeed)];
+        if (id < 0 || strcmp(propertyNames[id], key) != 0)
+            return -1;
+        return id;
+    }
+
+    // __index: properties, then the shared methods (upvalue 1), then the
+    // fields the script stored on the object (user value 1)
+    static int HandleIndex(lua_State *L)
+    {
+        GameObject *gameObject = static_cast<GameObjectHandle *>(lua_touserdata(L, 1))->object;
+        int id = FindProperty(L, 2);
+        if (id >= 0)
+        {
+            if (gameObject == nullptr)
+            {
+                lua_pushnil(L);
+                return 1;
+            }
+            switch (id)
+            {
+            case PropX:
+                lua_pushnumber(L, gameObject->transform->position.x);
+                break;
+            case PropY:
+                lua_pushnumber(L, gameObject->transform->position.y);
+                break;
+            case PropRotation:
+                lua_pushnumber(L, gameObject->transform->rotation);
+                break;
+            case PropScaleX:
+                lua_pushnumber(L, gameObject->transform->scale.x);
+                break;
+            case PropScaleY:
+                lua_pushnumber(L, gameObject->transform->scale.y);
+                break;
+            case PropVisible:
+                lua_pushboolean(L, gameObject->visible);
+                break;
+            case PropActive:
+                lua_pushboolean(L, gameObject->active);
+                break;
+            case PropName:
+                lua_pushstring(L, gameObject->name.c_str());
+                break;
+            }
+            return 1;
+        }
+
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, lua_upvalueindex(1)) != LUA_TNIL)
+            return 1;
+        lua_pop(L, 1);
+
+        if (lua_getiuservalue(L, 1, 1) != LUA_TTABLE)
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+        lua_pushvalue(L, 2);
+        lua_rawget(L, -2);
+        return 1;
+    }
+
+    static int HandleNewIndex(lua_State *L)
+    {
+        GameObject *gameObject = static_cast<GameObjectHandle *>(lua_touserdata(L, 1))->object;
+        int id = FindProperty(L, 2);
+        if (id >= 0)
+        {
+            if (gameObject == nullptr)
+            {
+                return luaL_error(L, "[%s] gameObject is null", propertyNames[id]);
+            }
+            switch (id)
+            {
+            case PropX:
+                gameObject->transform->position.x = (float)luaL_checknumber(L, 3);
+                break;
+            case PropY:
+                gameObject->transform->position.y = (float)luaL_checknumber(L, 3);
+                break;
+            case PropRotation:
+                gameObject->transform->rotation = (float)luaL_checknumber(L, 3);
+                break;
+            case PropScaleX:
+                gameObject->transform->scale.x = (float)luaL_checknumber(L, 3);
+                break;
+            case PropScaleY:
+                gameObject->transform->scale.y = (float)luaL_checknumber(L, 3);
+                break;
+            case PropVisible:
+                gameObject->visible = lua_toboolean(L, 3);
+                break;
+            case PropActive:
+                gameObject->active = lua_toboolean(L, 3);
+                break;
+            case PropName:
+                gameObject->name = luaL_checkstring(L, 3);
+                break;
+            }
+            return 0;
+        }
+
+        if (lua_getiuservalue(L, 1, 1) != LUA_TTABLE)
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setiuservalue(L, 1, 1);
+        }
+        lua_pushvalue(L, 2);
+        lua_pushvalue(L, 3);
+        lua_rawset(L, -3);
+        return 0;
+    }
+
+} // namespace BinGameObject
+
+GameObject *GameObject::FromLua(lua_State *L, int index)
+{
+    if (lua_type(L, index) != LUA_TUSERDATA || lua_rawlen(L, index) != sizeof(GameObjectHandle))
+        return nullptr;
+    GameObjectHandle *handle = static_cast<GameObjectHandle *>(lua_touserdata(L, index));
+    if (handle->magic != GameObjectHandle::Magic)
+        return nullptr;
+    return handle->object;
+}
+
+void GameObject::BindLua(lua_State *state)
+{
+    table_ref = NewHandle(state);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, table_ref);
+}
+
+int GameObject::NewHandle(lua_State *state)
+{
+    using namespace BinGameObject;
+
+    static const luaL_Reg methods[] = {
+        {"setDebug",            SetDebug},
+        {"addChild",            GameAddChild},
+        {"setPosition",         SetPosition},
+        {"getPosition",         GetPosition},
+        {"getLocalPoint",       GetLocalPosition},
+        {"getWorldPoint",       GetWorldPosition},
+        {"getX",                GetX},
+        {"getY",                GetY},
+        {"getWorldX",           GetWorldX},
+        {"getWorldY",           GetWorldY},
+        {"kill",                Kill},
+        {"centerOrigin",        CenterOrigin},
+        {"setScale",            SetScale},
+        {"getScale",            GetScale},
+        {"setRotation",         SetRotation},
+        {"getRotation",         GetRotation},
+        {"getWorldRotation",    GetWorldRotation},
+        {"setPivot",            SetPivot},
+        {"setOrigin",           SetOrigin},
+        {"setSize",             SetSize},
+        {"centerPivot",         SetCenterPivot},
+        {"getPivot",            GetPivot},
+        {"turnTo",              TurnTo},
+        {"pointToMouse",        PointToMouse},
+        {"advance",             Advance},
+        {"advanceTo",           XAdvance},
+        {"addBoxCollider",      AddBoxCollider},
+        {"addCircleCollider",   AddCircleCollider},
+        {"addSprite",           LoadSprite},
+        {"addTiles",            LoadTileLayer},
+        {"addAnimator",         AddAnimator},
+        {"getAnimator",         getAnimator},
+        {"getSprite",           GetSprite},
+        {"addScript",           LoadScript},
+        {"setSpriteClip",       SetSpriteClip},
+        {"setSpriteColor",      SetSpriteColor},
+        {"setSpriteFlip",       SetSpriteFlip},
+        {"setSpriteGraph",      SetSpriteGraph},
+        {"setTable",            SetTable},
+        {"sendMessage",         sendMessageData},
+        {"sendMessageTo",       sendMessageDataTo},
+        {"subscribe",           Subscribe},
+        {"unsubscribe",         Unsubscribe},
+        {"publish",             Publish},
+        {"place_free",          PlaceFree},
+        {"place_meeting",       PlaceMeeting},
+        {"layer_place_meeting", LayerPlaceMeeting},
+        {"setAnimation",        SetAnimation},
+        {"play",                PlayAnimation},
+        {"stop",                StopAnimation},
+        {"mode",                SetAnimationMode},
+        {"pause",               PauseAnimation},
+        {"setSolid",            SetSolid},
+        {"setVisible",          SetVisible},
+        {"setActive",           SetActive},
+        {"setCollidable",       SetCollidable},
+        {"setPrefab",           SetPrefab},
+        {"setPersistent",       SetPersistent},
+        {"addComponent",        lAddComponent},
+        {"getComponent",        lGetComponent},
+        {"getState",            GetState},
+        {"setState",            SetState},
+        {"faceTo",              FaceTo},
+        {nullptr, nullptr}};
+
+    GameObjectHandle *handle = static_cast<GameObjectHandle *>(lua_newuserdatauv(state, sizeof(GameObjectHandle), 1));
+    handle->magic = GameObjectHandle::Magic;
+    handle->object = this;
+
+    if (luaL_newmetatable(state, "GameObject"))
+    {
+        BuildPropertySlots();
+        lua_newtable(state);
+        luaL_setfuncs(state, methods, 0);
+        if (ScriptWorkers::Instance().IndexOf(state) >= 0)
+            ScriptWorkers::IsolateMethods(state);
+        lua_pushcclosure(state, &HandleIndex, 1);
+        lua_setfield(state, -2, "__index");
+        lua_pushcfunction(state, &HandleNewIndex);
+        lua_setfield(state, -2, "__newindex");
+    }
+    lua_setmetatable(state, -2);
+
+    return luaL_ref(state, LUA_REGISTRYINDEX);
+}
+//*********************************************************************************************************************
+//**                         ScriptCache                                                                            **
+//*********************************************************************************************************************
+
+static int ScriptDumpWriter(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    (void)L;
+    std::vector<unsigned char> *out = (std::vector<unsigned char> *)ud;
+    const unsigned char *bytes = (const unsigned char *)p;
+    out->insert(out->end(), bytes, bytes + sz);
+    return 0;
+}
+
+static void MakeDirectory(const char *path)
+{
+#if defined(_WIN32)
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+static unsigned long long ScriptPathHash(const char *fileName)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const char *c = fileName; *c != '\0'; c++)
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    return hash;
+}
+
+std::string ScriptCache::CachePath(const char *fileName) const
+{
+    std::string name = fileName;
+    for (char &c : name)
+    {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+    return directory + "/" + name + "c";
+}
+
+void ScriptCache::Store(lua_State *L, const std::string &cachePath, const Header &header)
+{
+    if (!directoryReady)
+    {
+        // one level at a time, mkdir does not create parents
+        for (size_t i = 0; i <= directory.size(); i++)
+        {
+            if (i == directory.size() || directory[i] == '/')
+                MakeDirectory(directory.substr(0, i).c_str());
+        }
+        directoryReady = true;
+    }
+
+    std::vector<unsigned char> bytes(sizeof(Header));
+    memcpy(bytes.data(), &header, sizeof(Header));
+    lua_dump(L, ScriptDumpWriter, &bytes, 0);
+
+    FILE *file = fopen(cachePath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        Log(LOG_WARNING, "Can't write script cache %s", cachePath.c_str());
+        return;
+    }
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+int ScriptCache::Load(lua_State *L, const char *fileName, bool refresh)
+{
+    double start = GetTime();
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "ULBC", 4);
+    header.luaVersion = LUA_VERSION_NUM;
+    header.modTime = GetFileModTime(fileName);
+    header.sourceSize = GetFileLength(fileName);
+    header.pathHash = ScriptPathHash(fileName);
+
+    bool cacheable = enabled && AssetPack::Instance().Find(fileName) == nullptr;
+#if defined(PLATFORM_ANDROID)
+    cacheable = false;
+#endif
+
+    std::string cachePath;
+    if (cacheable)
+    {
+        cachePath = CachePath(fileName);
+        // a stale entry must not survive a failed compile either
+        if (refresh && FileExists(cachePath.c_str()))
+            remove(cachePath.c_str());
+        unsigned int size = 0;
+        unsigned char *data = !refresh && FileExists(cachePath.c_str()) ? LoadFileData(cachePath.c_str(), &size) : nullptr;
+        if (data != nullptr)
+        {
+            // a different script that flattens to the same name fails here and is compiled again
+            bool valid = size > sizeof(Header) && memcmp(data, &header, sizeof(Header)) == 0;
+            if (valid)
+            {
+                if (luaL_loadbufferx(L, (const char *)data + sizeof(Header), size - sizeof(Header), fileName, "b") == LUA_OK)
+                {
+                    UnloadFileData(data);
+                    hits++;
+                    loadTime += GetTime() - start;
+                    return LUA_OK;
+                }
+                // written by another lua build, compile again
+                lua_pop(L, 1);
+            }
+            UnloadFileData(data);
+        }
+    }
+
+    unsigned int size = 0;
+    unsigned char *data = LoadAssetData(fileName, &size);
+    if (data == nullptr)
+    {
+        lua_pushfstring(L, "cannot read %s", fileName);
+        return LUA_ERRFILE;
+    }
+    int status = luaL_loadbufferx(L, (const char *)data, size, fileName, nullptr);
+    UnloadAssetData(data);
+    compiled++;
+
+    if (status == LUA_OK && cacheable)
+        Store(L, cachePath, header);
+    loadTime += GetTime() - start;
+    return status;
+}
+
+//*********************************************************************************************************************
+//**                         ScriptModule                                                                           **
+//*********************************************************************************************************************
+
+static std::unordered_map<std::string, ScriptModule *> scriptModules;
+
+// times one callback into its module while the profiler runs;
+// modules of worker states run on other threads and are never recorded
+struct ProfileScope
+{
+    ScriptModule *module;
+    ScriptCallback id;
+    double start;
+
+    ProfileScope(ScriptModule *module, ScriptCallback id)
+        : module(Profiler::active && module != nullptr && ScriptWorkers::Instance().IndexOf(module->state) < 0 ? module : nullptr), id(id),
+          start(this->module != nullptr ? GetTime() : 0.0) {}
+    ~ProfileScope()
+    {
+        if (module != nullptr)
+            Profiler::Instance().Record(module, id, GetTime() - start);
+    }
+};
+
+// a worker state keeps its own copy of a module, keyed by path@index
+static std::string ModuleKey(lua_State *L, const std::string &path)
+{
+    int worker = ScriptWorkers::Instance().IndexOf(L);
+    if (worker < 0)
+        return path;
+    return path + "@" + std::to_string(worker);
+}
+
+ScriptModule *ScriptModule::Find(lua_State *L, const std::string &path)
+{
+    auto it = scriptModules.find(ModuleKey(L, path));
+    if (it != scriptModules.end())
+        return it->second;
+    return nullptr;
+}
+
+ScriptModule *ScriptModule::Get(lua_State *L, const std::string &path)
+{
+    ScriptModule *module = Find(L, path);
+    if (module != nullptr)
+    {
+        // a compile error would otherwise stick to every later spawn
+        if (module->failed && GetFileModTime(path.c_str()) != module->timeLoad)
+            Reload(L, path);
+        return module;
+    }
+
+    module = new ScriptModule(L, path);
+    module->failed = !module->Compile(L);
+    scriptModules[ModuleKey(L, path)] = module;
+    return module;
+}
+
+bool ScriptModule::Compile(lua_State *L, bool refresh)
+{
+    const char *lua = path.c_str();
+    // kept on failure too, Get retries once the file changes again
+    timeLoad = GetFileModTime(lua);
+    if (ScriptCache::Instance().Load(L, lua, refresh) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(L, -1);
+        Log(LOG_ERROR, "Failed to load script %s : %s ", lua, errMsg);
+        lua_pop(L, 1);
+        return false;
+    }
+
+    if (lua_pcall(L, 0, 1, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(L, -1);
+        Log(LOG_ERROR, "Failed to execute script %s : %s ", lua, errMsg);
+        lua_pop(L, 1);
+        return false;
+    }
+
+    if (!lua_istable(L, -1))
+    {
+        Log(LOG_ERROR, "Script %s must return a table.", lua);
+        lua_pop(L, 1);
+        return false;
+    }
+
+    // script_refs[path] = module
+    lua_getglobal(L, "script_refs");
+    lua_pushvalue(L, -2);
+    lua_setfield(L, -2, lua);
+    lua_pop(L, 1);
+
+    if (ref != LUA_NOREF)
+        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    if (updateAll != LUA_NOREF)
+        luaL_unref(L, LUA_REGISTRYINDEX, updateAll);
+    updateAll = LUA_NOREF;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    lua_getfield(L, -1, "isolated");
+    isolated = lua_toboolean(L, -1) != 0;
+    lua_pop(L, 1);
+    lua_getfield(L, -1, "updateAll");
+    if (lua_isfunction(L, -1))
+        updateAll = luaL_ref(L, LUA_REGISTRYINDEX);
+    else
+        lua_pop(L, 1);
+    lua_pop(L, 1);
+    return true;
+}
+
+void ScriptModule::Attach(ScriptComponent *script)
+{
+    script->module = this;
+    script->moduleIndex = (int)instances.size();
+    instances.push_back(script);
+}
+
+void ScriptModule::Detach(ScriptComponent *script)
+{
+    RemoveFromBatch(script);
+    int index = script->moduleIndex;
+    if (index < 0 || index >= (int)instances.size() || instances[index] != script)
+        return;
+    instances[index] = instances.back();
+    instances[index]->moduleIndex = index;
+    instances.pop_back();
+    script->module = nullptr;
+    script->moduleIndex = -1;
+}
+
+void ScriptModule::AddToBatch(ScriptComponent *script)
+{
+    if (updateAll == LUA_NOREF || script->batchIndex >= 0)
+        return;
+    lua_State *L = script->state;
+    if (batchRef == LUA_NOREF)
+    {
+        lua_createtable(L, 64, 0);
+        batchRef = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    script->batchIndex = (int)batch.size();
+    batch.push_back(script);
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batchRef);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script->self_ref);
+    lua_rawseti(L, -2, script->batchIndex + 1);
+    lua_pop(L, 1);
+}
+
+void ScriptModule::RemoveFromBatch(ScriptComponent *script)
+{
+    int index = script->batchIndex;
+    if (index < 0 || index >= (int)batch.size() || batch[index] != script)
+        return;
+    lua_State *L = script->state;
+    int last = (int)batch.size() - 1;
+
+    // swap-remove, same as instances, so the lua array stays dense
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batchRef);
+    if (index != last)
+    {
+        lua_rawgeti(L, -1, last + 1);
+        lua_rawseti(L, -2, index + 1);
+        batch[index] = batch[last];
+        batch[index]->batchIndex = index;
+    }
+    lua_pushnil(L);
+    lua_rawseti(L, -2, last + 1);
+    lua_pop(L, 1);
+    batch.pop_back();
+    script->batchIndex = -1;
+}
+
+void ScriptModule::RebuildBatch(lua_State *L)
+{
+    for (ScriptComponent *script : batch)
+        script->batchIndex = -1;
+    batch.clear();
+    if (batchRef != LUA_NOREF)
+        luaL_unref(L, LUA_REGISTRYINDEX, batchRef);
+    batchRef = LUA_NOREF;
+    batchPanic = false;
+
+    for (ScriptComponent *script : instances)
+    {
+        if (script->callOnReadyDone)
+            AddToBatch(script);
+    }
+}
+
+// the same objects Scene::Update reaches: an alive, active root in the scene,
+// and no solid object on the way, solid stops its own update and its children's
+static bool ReachesUpdate(GameObject *gameObject)
+{
+    GameObject *root = gameObject;
+    while (root != nullptr)
+    {
+        if (root->solid)
+            return false;
+        if (root->parent == nullptr)
+            break;
+        root = root->parent;
+    }
+    return root->alive && root->active && root->scene != nullptr;
+}
+
+// active and solid change from lua at any time, membership follows them before each updateAll
+void ScriptModule::SyncBatch()
+{
+    for (ScriptComponent *script : instances)
+    {
+        bool wanted = script->callOnReadyDone && ReachesUpdate(script->gameObject);
+        if (wanted && script->batchIndex < 0)
+            AddToBatch(script);
+        else if (!wanted && script->batchIndex >= 0)
+            RemoveFromBatch(script);
+    }
+}
+
+void ScriptModule::UpdateBatches(lua_State *L, float dt)
+{
+    // updateAll may spawn scripts of a new type, which inserts into scriptModules;
+    // worker states run this at the same time, each over its own modules
+    static thread_local std::vector<ScriptModule *> pending;
+    pending.clear();
+    for (auto &it : scriptModules)
+    {
+        ScriptModule *module = it.second;
+        if (module->state != L || module->updateAll == LUA_NOREF || module->batchPanic)
+            continue;
+        module->SyncBatch();
+        if (!module->batch.empty())
+            pending.push_back(module);
+    }
+
+    for (ScriptModule *module : pending)
+    {
+        ProfileScope scope(module, ScriptUpdate);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, module->updateAll);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, module->batchRef);
+        lua_pushnumber(L, dt);
+        if (lua_pcall(L, 2, 0, 0) != LUA_OK)
+        {
+            const char *errMsg = lua_tostring(L, -1);
+            Log(LOG_ERROR, "Failed to call 'updateAll' function in script %s: %s", module->path.c_str(), errMsg);
+            lua_pop(L, 1);
+            module->batchPanic = true;
+        }
+    }
+}
+
+bool ScriptModule::Reload(lua_State *L, const std::string &path)
+{
+    ScriptModule *module = Find(L, path);
+    if (module == nullptr)
+        return false;
+
+    double start = GetTime();
+    if (!module->Compile(L, true))
+    {
+        // instances keep running the previous version
+        module->failed = true;
+        Log(LOG_ERROR, "Reload %s failed, %d instances keep the old code", path.c_str(), (int)module->instances.size());
+        return false;
+    }
+    double compiled = GetTime();
+
+    module->failed = false;
+    for (ScriptComponent *script : module->instances)
+    {
+        script->script_ref = module->ref;
+        script->LuaBind();
+        script->panic = false;
+        script->watch = false;
+        script->timeLoad = module->timeLoad;
+    }
+    module->RebuildBatch(L);
+    double done = GetTime();
+
+    Log(LOG_INFO, "Reloaded %s: compile %.2f ms, rebind %d instances %.2f ms", path.c_str(),
+        (compiled - start) * 1000.0, (int)module->instances.size(), (done - compiled) * 1000.0);
+    return true;
+}
+
+void ScriptModule::ReloadFailed()
+{
+    std::vector<std::pair<lua_State *, std::string>> failed;
+    for (auto &it : scriptModules)
+    {
+        ScriptModule *module = it.second;
+        bool panic = module->failed || module->batchPanic;
+        for (ScriptComponent *script : module->instances)
+            panic = panic || script->panic;
+        if (panic)
+            failed.push_back(std::make_pair(module->state, module->path));
+    }
+    for (auto &it : failed)
+        Reload(it.first, it.second);
+}
+
+// only the modules of L, worker states are cleared when the workers stop
+void ScriptModule::Clear(lua_State *L)
+{
+    for (auto it = scriptModules.begin(); it != scriptModules.end();)
+    {
+        ScriptModule *module = it->second;
+        if (module->state != L)
+        {
+            ++it;
+            continue;
+        }
+        for (ScriptComponent *script : module->instances)
+        {
+            script->module = nullptr;
+            script->batchIndex = -1;
+        }
+        if (module->ref != LUA_NOREF)
+            luaL_unref(L, LUA_REGISTRYINDEX, module->ref);
+        if (module->updateAll != LUA_NOREF)
+            luaL_unref(L, LUA_REGISTRYINDEX, module->updateAll);
+        if (module->batchRef != LUA_NOREF)
+            luaL_unref(L, LUA_REGISTRYINDEX, module->batchRef);
+        delete module;
+        it = scriptModules.erase(it);
+    }
+    if (L != getState())
+        return;
+
+    ScriptCache &cache = ScriptCache::Instance();
+    if (cache.hits + cache.compiled > 0)
+        Log(LOG_INFO, "Scripts: %d from cache, %d compiled, %.2f ms loading", cache.hits, cache.compiled, cache.loadTime * 1000.0);
+}
+
+//*********************************************************************************************************************
+//**                         ScriptComponent                                                                          **
+//*********************************************************************************************************************
+
+ScriptComponent::ScriptComponent(GameObject *gameObject, const char *lua, lua_State *L)
+    : gameObject(gameObject), state(L)
+{
+    script = lua;
+    callOnReadyDone = false;
+    watch = false;
+    gameObject->script = this;
+    module = nullptr;
+    moduleIndex = -1;
+    batchIndex = -1;
+    callbackMask = 0;
+    for (int i = 0; i < ScriptCallbackCount; i++)
+        callbacks[i] = LUA_NOREF;
+
+    // a worker state gets a handle of its own, the main one stays with the main state
+    worker = ScriptWorkers::Instance().IndexOf(L);
+    self_ref = worker >= 0 ? gameObject->NewHandle(L) : gameObject->table_ref;
+
+    timeLoad = FileWatcher::Instance().Watch(lua);
+
+    ScriptModule::Get(L, script)->Attach(this);
+    script_ref = module->ref;
+    if (module->failed)
+    {
+        panic = true;
+        return;
+    }
+
+    LuaBind();
 
-        lua_pushnil(L);
-        return 1;
+    panic = false;
+}
+
+ScriptComponent::~ScriptComponent()
+{
+    unregisterFunctions();
+    if (module != nullptr)
+        module->Detach(this);
+
+    if (worker >= 0)
+    {
+        lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref);
+        static_cast<GameObjectHandle *>(lua_touserdata(state, -1))->object = nullptr;
+        lua_pop(state, 1);
+        luaL_unref(state, LUA_REGISTRYINDEX, self_ref);
+        ScriptWorkers::Instance().Release(worker);
     }
+    CoroutineScheduler::Instance().Cancel(gameObject);
+    MessageBus::Instance().Detach(this);
 
-} // namespace BinGameObject
+    gameObject = nullptr;
 
-void GameObject::BindLua(lua_State *state)
+    //  return luaL_error(L, "ScriptComponent destroyed");
+}
+
+static const char *scriptCallbackNames[ScriptCallbackCount] = {
+    "OnReady", "OnRemove", "OnAnimationEnd", "OnAnimationStart", "OnAnimation",
+    "render", "update", "OnPause", "OnMessage", "OnCollision", "run"};
+
+void ScriptComponent::registerFunction(ScriptCallback id)
 {
-    // Crie a tabela do objeto
-    lua_newtable(state);
 
-    table_ref = luaL_ref(state, LUA_REGISTRYINDEX);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, table_ref); // Empilha a tabela do objeto
-    lua_pushlightuserdata(state, this);
-    lua_setfield(state, -2, "gameObject"); // Armazena o ponteiro do GameObject na tabela
+    lua_rawgeti(state, LUA_REGISTRYINDEX, script_ref);
+    lua_getfield(state, -1, scriptCallbackNames[id]);
+    if (!lua_isfunction(state, -1))
+    {
+        lua_pop(state, 2);
+        return;
+    }
+
+    callbacks[id] = luaL_ref(state, LUA_REGISTRYINDEX);
+    callbackMask |= 1u << id;
+    lua_pop(state, 1);
+}
 
-    using namespace BinGameObject;
+void ScriptComponent::unregisterFunctions()
+{
+    for (int i = 0; i < ScriptCallbackCount; i++)
+    {
+        if (callbacks[i] != LUA_NOREF)
+            luaL_unref(state, LUA_REGISTRYINDEX, callbacks[i]);
+        callbacks[i] = LUA_NOREF;
+    }
+    callbackMask = 0;
+}
 
-    lua_pushstring(state, name.c_str());
-    lua_setfield(state, -2, "name");
+void ScriptComponent::LuaBind()
+{
+    unregisterFunctions();
+    for (int i = 0; i < ScriptCallbackCount; i++)
+        registerFunction((ScriptCallback)i);
+
+    // batched modules are updated through updateAll
+    if (module != nullptr && module->updateAll != LUA_NOREF)
+        callbackMask &= ~(1u << ScriptUpdate);
+    MessageBus::Instance().Attach(this);
+}
+
+bool ScriptComponent::Reload()
+{
+    if (!state)
+        return false;
+    return ScriptModule::Reload(state, script);
+}
+
+void ScriptComponent::callOnAnimationFrame(int frame, const std::string &name)
+{
+}
+
+void ScriptComponent::callOnAnimationEnd(const std::string &name)
+{
+}
+void ScriptComponent::callOnAnimationStart(const std::string &name)
+{
+}
+
+void ScriptComponent::callOnCollide(GameObject *other)
+{
+    if (panic || !callOnReadyDone)
+        return;
+    if (!hasCallback(ScriptOnCollision))
+        return;
+
+    ProfileScope scope(module, ScriptOnCollision);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptOnCollision]);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
 
-    lua_pushcfunction(state, &SetDebug);
-    lua_setfield(state, -2, "setDebug");
+    // handles don't cross lua states, a script elsewhere gets the name
+    if (other->script && other->script->state == state)
+    {
+        lua_rawgeti(state, LUA_REGISTRYINDEX, other->script->self_ref);
+    }
+    else
+        lua_pushstring(state, other->name.c_str());
 
-    lua_pushcfunction(state, &GameAddChild);
-    lua_setfield(state, -2, "addChild");
+    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'OnCollision' function in script: %s", errMsg);
+        lua_pop(state, 1);
+    }
+}
 
-    lua_pushcfunction(state, &SetPosition);
-    lua_setfield(state, -2, "setPosition"); // Armazena a função setPosition na tabela
+void ScriptComponent::callOnUpdate(float dt)
+{
+    if (panic || !callOnReadyDone)
+        return;
+    if (!hasCallback(ScriptUpdate))
+        return;
 
-    lua_pushcfunction(state, &GetPosition);
-    lua_setfield(state, -2, "getPosition"); // Armazena a função getPosition na tabela
+    ProfileScope scope(module, ScriptUpdate);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptUpdate]);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
+    lua_pushnumber(state, dt);
 
-    lua_pushcfunction(state, &GetLocalPosition);
-    lua_setfield(state, -2, "getLocalPoint"); // Armazena a função getPosition na tabela
+    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'update' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+    }
+}
 
-    lua_pushcfunction(state, &GetWorldPosition);
-    lua_setfield(state, -2, "getWorldPoint"); // Armazena a função getPosition na tabela
+void ScriptComponent::callOnPause()
+{
+    if (panic || !callOnReadyDone)
+        return;
+    if (!hasCallback(ScriptOnPause))
+        return;
 
-    lua_pushcfunction(state, &GetX);
-    lua_setfield(state, -2, "getX");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptOnPause]);
 
-    lua_pushcfunction(state, &GetY);
-    lua_setfield(state, -2, "getY");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
 
-    lua_pushcfunction(state, &GetWorldX);
-    lua_setfield(state, -2, "getWorldX");
+    lua_pushnumber(state, GetFrameTime());
 
-    lua_pushcfunction(state, &GetWorldY);
-    lua_setfield(state, -2, "getWorldY");
+    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'OnPause' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+    }
+}
+// run(self) goes on as a coroutine owned by the object, main state only
+static void StartRun(ScriptComponent *script)
+{
+    if (!script->hasCallback(ScriptRun) || script->worker >= 0)
+        return;
+    lua_rawgeti(script->state, LUA_REGISTRYINDEX, script->callbacks[ScriptRun]);
+    lua_rawgeti(script->state, LUA_REGISTRYINDEX, script->self_ref);
+    CoroutineScheduler::Instance().Start(script->state, 1, script->gameObject);
+}
 
-    lua_pushcfunction(state, &Kill);
-    lua_setfield(state, -2, "kill");
+void ScriptComponent::callOnReady()
+{
+    if (panic)
+        return;
 
-    lua_pushcfunction(state, &CenterPivot);
-    lua_setfield(state, -2, "centerPivot");
+    if (!hasCallback(ScriptOnReady))
+    {
+        callOnReadyDone = true;
+        if (module != nullptr)
+            module->AddToBatch(this);
+        StartRun(this);
+        return;
+    }
 
-    lua_pushcfunction(state, &CenterOrigin);
-    lua_setfield(state, -2, "centerOrigin");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptOnReady]);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
+    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'OnReady' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+        callOnReadyDone = false;
+        return;
+    }
+    callOnReadyDone = true;
+    if (module != nullptr)
+        module->AddToBatch(this);
+    StartRun(this);
+}
 
-    lua_pushcfunction(state, &SetScale);
-    lua_setfield(state, -2, "setScale");
+void ScriptComponent::callOnRemove()
+{
+    if (panic || !callOnReadyDone)
+        return;
+    if (!hasCallback(ScriptOnRemove))
+        return;
 
-    lua_pushcfunction(state, &GetScale);
-    lua_setfield(state, -2, "getScale");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptOnRemove]);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
 
-    lua_pushcfunction(state, &SetRotation);
-    lua_setfield(state, -2, "setRotation");
+    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'OnRemove' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+    }
+}
 
-    lua_pushcfunction(state, &GetRotation);
-    lua_setfield(state, -2, "getRotation");
+void ScriptComponent::callOnRender()
+{
+    if (panic || !callOnReadyDone)
+        return;
+    if (!hasCallback(ScriptRender))
+        return;
 
-    lua_pushcfunction(state, &GetWorldRotation);
-    lua_setfield(state, -2, "getWorldRotation");
+    ProfileScope scope(module, ScriptRender);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptRender]);
 
-    lua_pushcfunction(state, &SetPivot);
-    lua_setfield(state, -2, "setPivot");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
 
-    lua_pushcfunction(state, &SetOrigin);
-    lua_setfield(state, -2, "setOrigin");
+    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'render' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+    }
+}
 
-    lua_pushcfunction(state, &SetSize);
-    lua_setfield(state, -2, "setSize");
+// values crossing lua states are copied, tables a few levels deep, functions and userdata arrive as nil
+static void CopyValue(lua_State *from, int index, lua_State *to, int depth = 0)
+{
+    index = lua_absindex(from, index);
+    switch (lua_type(from, index))
+    {
+    case LUA_TBOOLEAN:
+        lua_pushboolean(to, lua_toboolean(from, index));
+        break;
+    case LUA_TNUMBER:
+        if (lua_isinteger(from, index))
+            lua_pushinteger(to, lua_tointeger(from, index));
+        else
+            lua_pushnumber(to, lua_tonumber(from, index));
+        break;
+    case LUA_TSTRING:
+    {
+        size_t len = 0;
+        const char *text = lua_tolstring(from, index, &len);
+        lua_pushlstring(to, text, len);
+        break;
+    }
+    case LUA_TTABLE:
+        if (depth < 4)
+        {
+            lua_newtable(to);
+            lua_pushnil(from);
+            while (lua_next(from, index) != 0)
+            {
+                CopyValue(from, -2, to, depth + 1);
+                CopyValue(from, -1, to, depth + 1);
+                if (lua_isnil(to, -2))
+                    lua_pop(to, 2);
+                else
+                    lua_rawset(to, -3);
+                lua_pop(from, 1);
+            }
+            break;
+        }
+        lua_pushnil(to);
+        break;
+    default:
+        lua_pushnil(to);
+        break;
+    }
+}
 
-    lua_pushcfunction(state, &SetCenterPivot);
-    lua_setfield(state, -2, "centerPivot");
+static lua_State *MainThread(lua_State *L)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+    lua_State *main = lua_tothread(L, -1);
+    lua_pop(L, 1);
+    return main;
+}
 
-    lua_pushcfunction(state, &GetPivot);
-    lua_setfield(state, -2, "getPivot");
+// coroutines share values with their lua state, only a worker state on the other side needs a copy
+static void PushValue(lua_State *from, int index, lua_State *to)
+{
+    if (MainThread(from) == MainThread(to))
+    {
+        lua_pushvalue(from, index);
+        lua_xmove(from, to, 1);
+    }
+    else
+        CopyValue(from, index, to);
+}
 
-    lua_pushcfunction(state, &TurnTo);
-    lua_setfield(state, -2, "turnTo");
+void ScriptComponent::callOnMessage(lua_State *from, int payload, const char *channel)
+{
+    if (panic || !callOnReadyDone)
+        return;
 
-    lua_pushcfunction(state, &PointToMouse);
-    lua_setfield(state, -2, "pointToMouse");
+    if (!hasCallback(ScriptOnMessage))
+        return;
 
-    lua_pushcfunction(state, &Advance);
-    lua_setfield(state, -2, "advance");
+    ProfileScope scope(module, ScriptOnMessage);
+    lua_rawgeti(state, LUA_REGISTRYINDEX, callbacks[ScriptOnMessage]);
 
-    lua_pushcfunction(state, &XAdvance);
-    lua_setfield(state, -2, "advanceTo");
+    lua_rawgeti(state, LUA_REGISTRYINDEX, self_ref); // Empilha a tabela do objeto
 
-    lua_pushcfunction(state, &AddBoxCollider);
-    lua_setfield(state, -2, "addBoxCollider");
+    PushValue(from, payload, state);
+    lua_pushstring(state, channel);
 
-    lua_pushcfunction(state, &AddCircleCollider);
-    lua_setfield(state, -2, "addCircleCollider");
+    // enviamos a table recebida do lua para os scripts 'OnMessage'
+    if (lua_pcall(state, 3, 0, 0) != LUA_OK)
+    {
+        const char *errMsg = lua_tostring(state, -1);
+        Log(LOG_ERROR, "Failed to call 'OnMessage' function in script: %s", errMsg);
+        lua_pop(state, 1);
+        panic = true;
+    }
+}
 
-    lua_pushcfunction(state, &LoadSprite);
-    lua_setfield(state, -2, "addSprite");
+//*********************************************************************************************************************
+//**                         Profiler                                                                               **
+//*********************************************************************************************************************
 
-    lua_pushcfunction(state, &LoadTileLayer);
-    lua_setfield(state, -2, "addTiles");
+bool Profiler::active = false;
 
-    lua_pushcfunction(state, &AddAnimator);
-    lua_setfield(state, -2, "addAnimator");
+void Profiler::Start(lua_State *L, bool withSampling, int instructions)
+{
+    Reset();
+    active = true;
+    sampling = withSampling;
+    interval = instructions > 0 ? instructions : 1000;
+    if (sampling)
+        lua_sethook(L, Hook, LUA_MASKCOUNT, interval);
+    Log(LOG_INFO, "Profiler started%s", sampling ? TextFormat(", sampling every %d instructions", interval) : "");
+}
 
-    lua_pushcfunction(state, &getAnimator);
-    lua_setfield(state, -2, "getAnimator");
+void Profiler::Stop(lua_State *L)
+{
+    if (sampling)
+        lua_sethook(L, nullptr, 0, 0);
+    active = false;
+    sampling = false;
+    Log(LOG_INFO, "Profiler stopped after %d frames", frames);
+}
 
-    lua_pushcfunction(state, &GetSprite);
-    lua_setfield(state, -2, "getSprite");
+void Profiler::Reset()
+{
+    for (auto &it : scriptModules)
+        it.second->ResetProfile();
+    samples.clear();
+    frames = 0;
+    sampleCount = 0;
+    luaTime = 0;
+}
 
-    lua_pushcfunction(state, &LoadScript);
-    lua_setfield(state, -2, "addScript");
+void Profiler::Record(ScriptModule *module, ScriptCallback id, double seconds)
+{
+    ScriptModule::CallStats &stats = module->profile[id];
+    stats.time += seconds;
+    stats.calls++;
+    if (seconds > stats.maxTime)
+        stats.maxTime = seconds;
+    luaTime += seconds;
+}
 
-    lua_pushcfunction(state, &SetSpriteClip);
-    lua_setfield(state, -2, "setSpriteClip");
+void Profiler::Hook(lua_State *L, lua_Debug *ar)
+{
+    (void)ar;
+    Profiler &profiler = Instance();
+    profiler.sampleCount++;
 
-    lua_pushcfunction(state, &SetSpriteColor);
-    lua_setfield(state, -2, "setSpriteColor");
+    // key and seen are reused, a sample allocates only for functions never seen before
+    static std::string key;
+    static std::vector<Sample *> seen;
+    seen.clear();
+    lua_Debug info;
+    for (int level = 0; lua_getstack(L, level, &info); level++)
+    {
+        lua_getinfo(L, "Sn", &info);
+        key.assign(info.short_src);
+        key += ':';
+        key += std::to_string(info.linedefined);
+        key += ' ';
+        key += info.name != nullptr ? info.name : "?";
 
-    lua_pushcfunction(state, &SetSpriteFlip);
-    lua_setfield(state, -2, "setSpriteFlip");
+        auto it = profiler.samples.find(key);
+        if (it == profiler.samples.end())
+            it = profiler.samples.insert(std::make_pair(key, Sample{0, 0})).first;
+        Sample *sample = &it->second;
+        if (level == 0)
+            sample->self++;
+        // recursion counts once toward total
+        if (std::find(seen.begin(), seen.end(), sample) == seen.end())
+        {
+            sample->total++;
+            seen.push_back(sample);
+        }
+    }
+}
 
-    lua_pushcfunction(state, &SetSpriteGraph);
-    lua_setfield(state, -2, "setSpriteGraph");
+struct ProfileEntry
+{
+    const ScriptModule *module;
+    int id;
+    double time;
+};
 
-    lua_pushcfunction(state, &SetTable);
-    lua_setfield(state, -2, "setTable");
+static void CollectProfile(std::vector<ProfileEntry> &entries)
+{
+    entries.clear();
+    for (auto &it : scriptModules)
+    {
+        const ScriptModule *module = it.second;
+        for (int i = 0; i < ScriptCallbackCount; i++)
+        {
+            if (module->profile[i].calls > 0)
+                entries.push_back(ProfileEntry{module, i, module->profile[i].time});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const ProfileEntry &a, const ProfileEntry &b)
+              { return a.time > b.time; });
+}
 
-    lua_pushcfunction(state, &sendMessageData);
-    lua_setfield(state, -2, "sendMessage");
+static void CollectSamples(const std::unordered_map<std::string, Profiler::Sample> &samples,
+                           std::vector<std::pair<std::string, Profiler::Sample>> &sorted)
+{
+    sorted.assign(samples.begin(), samples.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, Profiler::Sample> &a, const std::pair<std::string, Profiler::Sample> &b)
+              { return a.second.self != b.second.self ? a.second.self > b.second.self : a.second.total > b.second.total; });
+}
 
-    lua_pushcfunction(state, &sendMessageDataTo);
-    lua_setfield(state, -2, "sendMessageTo");
+bool Profiler::Dump(const char *fileName)
+{
+    FILE *file = fopen(fileName, "w");
+    if (file == nullptr)
+    {
+        Log(LOG_ERROR, "Can't write profile %s", fileName);
+        return false;
+    }
+    int count = frames > 0 ? frames : 1;
+    fprintf(file, "frames %d, lua callbacks %.3f ms/frame\n\n", frames, luaTime * 1000.0 / count);
 
-    lua_pushcfunction(state, &PlaceFree);
-    lua_setfield(state, -2, "place_free");
+    std::vector<ProfileEntry> entries;
+    CollectProfile(entries);
+    fprintf(file, "%-40s %-18s %10s %12s %12s %10s\n", "script", "callback", "calls", "total ms", "ms/frame", "max ms");
+    for (const ProfileEntry &entry : entries)
+    {
+        const ScriptModule::CallStats &stats = entry.module->profile[entry.id];
+        fprintf(file, "%-40s %-18s %10d %12.3f %12.4f %10.3f\n", entry.module->path.c_str(), scriptCallbackNames[entry.id],
+                stats.calls, stats.time * 1000.0, stats.time * 1000.0 / count, stats.maxTime * 1000.0);
+    }
 
-    lua_pushcfunction(state, &PlaceMeeting);
-    lua_setfield(state, -2, "place_meeting");
+    if (sampleCount > 0)
+    {
+        // samples only give shares, times are those shares of the timed callbacks
+        std::vector<std::pair<std::string, Sample>> sorted;
+        CollectSamples(samples, sorted);
+        fprintf(file, "\n%d samples, every %d instructions\n", sampleCount, interval);
+        fprintf(file, "%8s %8s %12s %12s  %s\n", "self %", "total %", "self ms", "total ms", "function");
+        for (const auto &it : sorted)
+        {
+            double self = (double)it.second.self / sampleCount;
+            double total = (double)it.second.total / sampleCount;
+            fprintf(file, "%8.2f %8.2f %12.3f %12.3f  %s\n", self * 100.0, total * 100.0,
+                    self * luaTime * 1000.0, total * luaTime * 1000.0, it.first.c_str());
+        }
+    }
+    fclose(file);
+    Log(LOG_INFO, "Profile written to %s", fileName);
+    return true;
+}
 
-    lua_pushcfunction(state, &LayerPlaceMeeting);
-    lua_setfield(state, -2, "layer_place_meeting");
+void Profiler::Draw(int x, int y)
+{
+    const int rows = 8;
+    const int size = 10;
+    const int line = 12;
+    int count = frames > 0 ? frames : 1;
 
-    lua_pushcfunction(state, &SetAnimation);
-    lua_setfield(state, -2, "setAnimation");
+    static std::vector<ProfileEntry> entries;
+    static std::vector<std::pair<std::string, Sample>> sorted;
+    CollectProfile(entries);
+    int callbackRows = std::min(rows, (int)entries.size());
+    int sampleRows = 0;
+    if (sampleCount > 0)
+    {
+        CollectSamples(samples, sorted);
+        sampleRows = std::min(rows, (int)sorted.size());
+    }
 
-    lua_pushcfunction(state, &PlayAnimation);
-    lua_setfield(state, -2, "play");
+    int height = (2 + callbackRows + (sampleCount > 0 ? 1 + sampleRows : 0)) * line + 8;
+    DrawRectangle(x, y, 400, height, Fade(BLACK, 0.7f));
+    DrawRectangleLines(x, y, 400, height, BLUE);
+    x += 6;
+    y += 4;
 
-    lua_pushcfunction(state, &StopAnimation);
-    lua_setfield(state, -2, "stop");
+    DrawText(TextFormat("Profiler  %d frames  lua %.3f ms/frame", frames, luaTime * 1000.0 / count), x, y, size, YELLOW);
+    y += line;
+    DrawText("ms/frame  calls/frame  callback", x, y, size, GRAY);
+    y += line;
+    for (int i = 0; i < callbackRows; i++)
+    {
+        const ScriptModule::CallStats &stats = entries[i].module->profile[entries[i].id];
+        DrawText(TextFormat("%8.3f  %11.1f  %s %s", stats.time * 1000.0 / count, (double)stats.calls / count,
+                            GetFileName(entries[i].module->path.c_str()), scriptCallbackNames[entries[i].id]),
+                 x, y, size, LIME);
+        y += line;
+    }
+    if (sampleCount == 0)
+        return;
 
-    lua_pushcfunction(state, &SetAnimationMode);
-    lua_setfield(state, -2, "mode");
+    DrawText("self %   total %   function", x, y, size, GRAY);
+    y += line;
+    for (int i = 0; i < sampleRows; i++)
+    {
+        DrawText(TextFormat("%6.1f  %7.1f   %s", 100.0 * sorted[i].second.self / sampleCount,
+                            100.0 * sorted[i].second.total / sampleCount, sorted[i].first.c_str()),
+                 x, y, size, SKYBLUE);
+        y += line;
+    }
+}
 
-    lua_pushcfunction(state, &PauseAnimation);
-    lua_setfield(state, -2, "pause");
+//*********************************************************************************************************************
+//**                         CoroutineScheduler                                                                     **
+//*********************************************************************************************************************
 
-    lua_pushcfunction(state, &StopAnimation);
-    lua_setfield(state, -2, "stop");
+void CoroutineScheduler::Start(lua_State *caller, int nargs, GameObject *owner)
+{
+    L = getState();
+    lua_State *thread = lua_newthread(caller);
+    lua_insert(caller, -(nargs + 2));
+    lua_xmove(caller, thread, nargs + 1);
+    int ref = luaL_ref(caller, LUA_REGISTRYINDEX);
 
-    lua_pushcfunction(state, &SetSolid);
-    lua_setfield(state, -2, "setSolid");
+    int index = 0;
+    if (!freeTasks.empty())
+    {
+        index = freeTasks.back();
+        freeTasks.pop_back();
+    }
+    else
+    {
+        index = (int)tasks.size();
+        tasks.push_back(Task());
+        tasks[index].serial = 0;
+    }
+    Task &task = tasks[index];
+    task.thread = thread;
+    task.ref = ref;
+    task.predicate = LUA_NOREF;
+    task.owner = owner;
+    task.waiting = false;
+    task.running = false;
+    task.cancelled = false;
+    threads[thread] = index;
+    if (owner != nullptr)
+        owners[owner]++;
 
-    lua_pushcfunction(state, &SetVisible);
-    lua_setfield(state, -2, "setVisible");
+    Resume(index, nargs);
+}
 
-    lua_pushcfunction(state, &SetActive);
-    lua_setfield(state, -2, "setActive");
+int CoroutineScheduler::Find(lua_State *thread)
+{
+    auto it = threads.find(thread);
+    if (it == threads.end())
+        return -1;
+    return it->second;
+}
 
-    lua_pushcfunction(state, &SetCollidable);
-    lua_setfield(state, -2, "setCollidable");
+unsigned int CoroutineScheduler::Suspend(int index)
+{
+    Task &task = tasks[index];
+    task.serial++;
+    task.waiting = true;
+    return task.serial;
+}
 
-    lua_pushcfunction(state, &SetPrefab);
-    lua_setfield(state, -2, "setPrefab");
+bool CoroutineScheduler::WaitTime(lua_State *thread, double seconds)
+{
+    int index = Find(thread);
+    if (index < 0)
+        return false;
+    Due due = {clock + seconds, index, Suspend(index)};
+    timers.push(due);
+    return true;
+}
 
-    lua_pushcfunction(state, &SetPersistent);
-    lua_setfield(state, -2, "setPersistent");
+bool CoroutineScheduler::WaitFrames(lua_State *thread, int count)
+{
+    int index = Find(thread);
+    if (index < 0)
+        return false;
+    Due due = {(double)(frame + (count < 1 ? 1 : count)), index, Suspend(index)};
+    frames.push(due);
+    return true;
+}
 
-    lua_pushcfunction(state, &lAddComponent);
-    lua_setfield(state, -2, "addComponent");
+bool CoroutineScheduler::WaitUntil(lua_State *thread, int predicate)
+{
+    int index = Find(thread);
+    if (index < 0)
+        return false;
+    Task &task = tasks[index];
+    if (task.predicate != LUA_NOREF)
+        luaL_unref(L, LUA_REGISTRYINDEX, task.predicate);
+    task.predicate = predicate;
+    Due due = {0, index, Suspend(index)};
+    predicates.push_back(due);
+    return true;
+}
 
-    lua_pushcfunction(state, &lGetComponent);
-    lua_setfield(state, -2, "getComponent");
+bool CoroutineScheduler::WaitSignal(lua_State *thread, const std::string &name)
+{
+    int index = Find(thread);
+    if (index < 0)
+        return false;
+    Due due = {0, index, Suspend(index)};
+    signals[name].push_back(due);
+    return true;
+}
 
-    lua_pushcfunction(state, &GetState);
-    lua_setfield(state, -2, "getState");
+// the waiting coroutines resume on the next Update
+void CoroutineScheduler::Signal(const std::string &name)
+{
+    auto it = signals.find(name);
+    if (it == signals.end())
+        return;
+    ready.insert(ready.end(), it->second.begin(), it->second.end());
+    signals.erase(it);
+}
 
-    lua_pushcfunction(state, &SetState);
-    lua_setfield(state, -2, "setState");
+void CoroutineScheduler::Resume(int index, int nargs)
+{
+    lua_State *thread = tasks[index].thread;
+    if (tasks[index].predicate != LUA_NOREF)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, tasks[index].predicate);
+        tasks[index].predicate = LUA_NOREF;
+    }
+    tasks[index].waiting = false;
+    tasks[index].running = true;
+    int results = 0;
+    int status = lua_resume(thread, L, nargs, &results);
 
-    lua_pushcfunction(state, &FaceTo);
-    lua_setfield(state, -2, "faceTo");
+    // Start from inside the coroutine may have grown tasks
+    Task &task = tasks[index];
+    task.running = false;
+    if (status == LUA_YIELD && !task.cancelled)
+    {
+        lua_pop(thread, results);
+        // a plain coroutine.yield waits one frame
+        if (!task.waiting)
+            WaitFrames(thread, 1);
+        return;
+    }
+    if (status != LUA_OK && status != LUA_YIELD)
+    {
+        luaL_traceback(L, thread, lua_tostring(thread, -1), 0);
+        Log(LOG_ERROR, "Coroutine failed: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+    Free(index);
+}
 
-    lua_pop(state, 1); // Remove a tabela do objeto da pilha
-    lua_rawgeti(state, LUA_REGISTRYINDEX, table_ref);
+void CoroutineScheduler::Free(int index)
+{
+    Task &task = tasks[index];
+    if (task.thread == nullptr)
+        return;
+    // the owner may be going away now, a later object at its address must not match
+    if (task.owner != nullptr)
+    {
+        auto it = owners.find(task.owner);
+        if (it != owners.end() && --it->second <= 0)
+            owners.erase(it);
+        task.owner = nullptr;
+    }
+    if (task.running)
+    {
+        task.cancelled = true;
+        return;
+    }
+    if (task.predicate != LUA_NOREF)
+        luaL_unref(L, LUA_REGISTRYINDEX, task.predicate);
+    luaL_unref(L, LUA_REGISTRYINDEX, task.ref);
+    threads.erase(task.thread);
+    task.thread = nullptr;
+    task.predicate = LUA_NOREF;
+    task.serial++;
+    freeTasks.push_back(index);
 }
-//*********************************************************************************************************************
-//**                         ScriptComponent                                                                          **
-//*********************************************************************************************************************
 
-ScriptComponent::ScriptComponent(GameObject *gameObject, const char *lua, lua_State *L)
-    : gameObject(gameObject), state(L)
+void CoroutineScheduler::Cancel(GameObject *owner)
 {
-    script = lua;
-    callOnReadyDone = false;
-    watch = false;
-    gameObject->script = this;
+    if (owners.find(owner) == owners.end())
+        return;
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        if (tasks[i].thread != nullptr && tasks[i].owner == owner)
+            Free((int)i);
+    }
+}
 
-    lua_getglobal(L, "script_refs");
-    lua_getfield(L, -1, lua);
-    script_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+void CoroutineScheduler::Update(lua_State *state, float dt)
+{
+    L = state;
+    clock += dt;
+    frame++;
 
-    timeLoad = GetFileModTime(lua);
-    if (script_ref == LUA_REFNIL) // O script ainda não está carregado
+    while (!timers.empty() && timers.top().time <= clock)
+    {
+        ready.push_back(timers.top());
+        timers.pop();
+    }
+    while (!frames.empty() && frames.top().time <= (double)frame)
     {
-        char *data = LoadFileText(lua);
-        size_t size = strlen(data);
+        ready.push_back(frames.top());
+        frames.pop();
+    }
 
-        if (luaL_loadbufferx(L, data, size, lua, nullptr) != LUA_OK)
+    // predicates are the only waits polled every frame
+    resuming.swap(predicates);
+    for (const Due &due : resuming)
+    {
+        Task &task = tasks[due.index];
+        if (task.serial != due.serial)
+            continue;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, task.predicate);
+        if (lua_pcall(L, 0, 1, 0) != LUA_OK)
         {
-            const char *errMsg = lua_tostring(L, -1);
-            Log(LOG_ERROR, "Failed to load script %s : %s ", lua, errMsg);
+            Log(LOG_ERROR, "Failed to call 'waitUntil' function: %s", lua_tostring(L, -1));
             lua_pop(L, 1);
-            free(data);
-            panic = true;
-            return;
+            Free(due.index);
+            continue;
         }
+        bool done = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+        if (done)
+            ready.push_back(due);
+        else
+            predicates.push_back(due);
+    }
+    resuming.clear();
 
-        free(data);
-
-        if (lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK)
-        {
-            const char *errMsg = lua_tostring(L, -1);
-            Log(LOG_ERROR, "Failed to execute script %s : %s ", lua, errMsg);
-            lua_pop(L, 1);
-            panic = true;
-            return;
-        }
+    // a wait made while resuming lands in the heaps or in ready, due next frame at the earliest
+    resuming.swap(ready);
+    for (const Due &due : resuming)
+    {
+        if (tasks[due.index].serial == due.serial)
+            Resume(due.index, 0);
+    }
+    resuming.clear();
+}
 
-        if (!lua_istable(L, -1))
-        {
-            Log(LOG_ERROR, "Script %s must return a table.", lua);
-            lua_pop(L, 1);
-            panic = true;
-            return;
-        }
+void CoroutineScheduler::Clear(lua_State *state)
+{
+    for (Task &task : tasks)
+    {
+        if (task.thread == nullptr)
+            continue;
+        if (task.predicate != LUA_NOREF)
+            luaL_unref(state, LUA_REGISTRYINDEX, task.predicate);
+        luaL_unref(state, LUA_REGISTRYINDEX, task.ref);
+    }
+    tasks.clear();
+    freeTasks.clear();
+    threads.clear();
+    owners.clear();
+    timers = DueHeap();
+    frames = DueHeap();
+    predicates.clear();
+    signals.clear();
+    ready.clear();
+    clock = 0;
+    frame = 0;
+}
 
-        // Store a reference to the script in the global table
-        lua_getglobal(L, "script_refs");
-        lua_pushvalue(L, -2);     // Push the script table
-        lua_setfield(L, -2, lua); // Store a reference to the script table in the global table using 'lua' instead of 'GetFileNameWithoutExt(lua)'
-        lua_pop(L, 1);            // Remove the global table from the stack
+//*********************************************************************************************************************
+//**                         TimerWheel                                                                             **
+//*********************************************************************************************************************
 
-        // Get the script reference
-        lua_getglobal(L, "script_refs");
-        lua_getfield(L, -1, lua);
-        script_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+unsigned int TimerWheel::ToTicks(double seconds)
+{
+    double ticks = seconds * TicksPerSecond + 0.5;
+    if (ticks < 1)
+        return 1;
+    if (ticks > 4294967295.0)
+        return 4294967295u;
+    return (unsigned int)ticks;
+}
 
-        lua_pop(L, 1); // Remove the global table from the stack
+lua_Integer TimerWheel::Add(lua_State *state, double delay, double period, GameObject *owner)
+{
+    L = state;
+    int index = 0;
+    if (!freeEntries.empty())
+    {
+        index = freeEntries.back();
+        freeEntries.pop_back();
     }
-
-    LuaBind();
-
-    panic = false;
+    else
+    {
+        index = (int)entries.size();
+        entries.push_back(Entry());
+        entries[index].serial = 1;
+    }
+    Entry &entry = entries[index];
+    entry.callback = luaL_ref(state, LUA_REGISTRYINDEX);
+    entry.due = now + ToTicks(delay);
+    entry.period = period > 0 ? ToTicks(period) : 0;
+    entry.owner = owner;
+    if (owner != nullptr)
+        owners[owner]++;
+    Link(index);
+    count++;
+    return IdOf(index);
+}
+
+// the lowest wheel whose span covers the delay, the slot from the due tick's digit there
+void TimerWheel::Link(int index)
+{
+    Entry &entry = entries[index];
+    unsigned long long delta = entry.due > now ? entry.due - now : 0;
+    int level = 0;
+    while (level < Levels - 1 && delta >= (1ull << (8 * (level + 1))))
+        level++;
+    int slot = (int)((entry.due >> (8 * level)) & (Slots - 1));
+
+    entry.level = level;
+    entry.slot = slot;
+    entry.prev = -1;
+    entry.next = heads[level][slot];
+    if (entry.next >= 0)
+        entries[entry.next].prev = index;
+    heads[level][slot] = index;
+}
+
+void TimerWheel::Unlink(int index)
+{
+    Entry &entry = entries[index];
+    if (entry.prev >= 0)
+        entries[entry.prev].next = entry.next;
+    else
+        heads[entry.level][entry.slot] = entry.next;
+    if (entry.next >= 0)
+        entries[entry.next].prev = entry.prev;
+    entry.prev = entry.next = -1;
 }
 
-ScriptComponent::~ScriptComponent()
+void TimerWheel::Release(int index)
 {
-    for (const auto &entry : luaFunctions)
+    Entry &entry = entries[index];
+    if (entry.owner != nullptr)
     {
-        luaL_unref(state, LUA_REGISTRYINDEX, entry.second);
+        auto it = owners.find(entry.owner);
+        if (it != owners.end() && --it->second <= 0)
+            owners.erase(it);
+        entry.owner = nullptr;
     }
-    luaL_unref(state, LUA_REGISTRYINDEX, script_ref);
-
-    gameObject = nullptr;
-
-    //  return luaL_error(L, "ScriptComponent destroyed");
+    entry.level = -1;
+    entry.callback = LUA_NOREF;
+    entry.serial++;
+    freeEntries.push_back(index);
+    count--;
 }
 
-bool ScriptComponent::isFunctionRegistered(const char *functionName)
+bool TimerWheel::Cancel(lua_Integer id)
 {
-    auto it = luaFunctions.find(functionName);
-    return it != luaFunctions.end();
+    int index = (int)(id & 0xffffffff);
+    unsigned int serial = (unsigned int)(id >> 32);
+    if (index < 0 || index >= (int)entries.size())
+        return false;
+    Entry &entry = entries[index];
+    if (entry.serial != serial || entry.level == -1)
+        return false;
+    // level -2: a one shot already taken off the wheel, about to fire this frame
+    if (entry.level >= 0)
+        Unlink(index);
+    luaL_unref(L, LUA_REGISTRYINDEX, entry.callback);
+    Release(index);
+    return true;
 }
 
-void ScriptComponent::registerFunction(const char *functionName)
+void TimerWheel::Cancel(GameObject *owner)
 {
-
-    lua_rawgeti(state, LUA_REGISTRYINDEX, script_ref);
-    lua_getfield(state, -1, functionName);
-    if (!lua_isfunction(state, -1))
-    {
-        lua_pop(state, 2);
+    if (owners.find(owner) == owners.end())
         return;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].level != -1 && entries[i].owner == owner)
+            Cancel(IdOf((int)i));
     }
-
-    int ref = luaL_ref(state, LUA_REGISTRYINDEX);
-    lua_pop(state, 1);
-    luaFunctions[functionName] = ref;
 }
 
-void ScriptComponent::LuaBind()
+// a higher slot comes due: its timers move down to the wheels that now cover them
+void TimerWheel::Cascade(int level)
 {
-
-    for (const auto &entry : luaFunctions)
+    int slot = (int)((now >> (8 * level)) & (Slots - 1));
+    int index = heads[level][slot];
+    heads[level][slot] = -1;
+    while (index >= 0)
     {
-        luaL_unref(state, LUA_REGISTRYINDEX, entry.second);
+        int next = entries[index].next;
+        Link(index);
+        index = next;
     }
-
-    luaFunctions.clear();
-    registerFunction("OnReady");
-    registerFunction("OnRemove");
-
-    registerFunction("OnAnimationEnd");
-    registerFunction("OnAnimationStart");
-    registerFunction("OnAnimation");
-
-    registerFunction("render");
-    registerFunction("update");
-
-    registerFunction("OnPause");
-
-    registerFunction("OnMessage");
-    registerFunction("OnCollision");
 }
 
-bool ScriptComponent::Reload()
+void TimerWheel::Tick()
 {
-    if (!state)
-        return false;
-
-    if (!watch)
-        if (!panic)
-            return false;
-    //  if (gameObject->prefab)
-    //      return false;
-
-    Log(LOG_WARNING, "Relod %s", script.c_str());
+    now++;
+    if ((now & (Slots - 1)) == 0)
+    {
+        if (((now >> 8) & (Slots - 1)) == 0)
+        {
+            if (((now >> 16) & (Slots - 1)) == 0)
+                Cascade(3);
+            Cascade(2);
+        }
+        Cascade(1);
+    }
 
-    // Desreferenciar o script anterior, se houver
-    if (script_ref != LUA_NOREF)
+    int slot = (int)(now & (Slots - 1));
+    int index = heads[0][slot];
+    heads[0][slot] = -1;
+    while (index >= 0)
     {
-        luaL_unref(state, LUA_REGISTRYINDEX, script_ref);
+        Entry &entry = entries[index];
+        int next = entry.next;
+        Fire fire = {index, entry.serial, entry.callback, IdOf(index), entry.period == 0};
+        if (fire.once)
+        {
+            entry.level = -2;
+        }
+        else
+        {
+            entry.due = now + entry.period;
+            Link(index);
+        }
+        firing.push_back(fire);
+        index = next;
     }
+}
 
-    // Carregar o novo script
-    char *data = LoadFileText(script.c_str());
-    size_t size = strlen(data);
+void TimerWheel::Update(lua_State *state, float dt)
+{
+    L = state;
+    remainder += dt * (double)TicksPerSecond;
+    int ticks = (int)remainder;
+    remainder -= ticks;
 
-    if (luaL_loadbufferx(state, data, size, script.c_str(), nullptr) != LUA_OK)
+    if (count == 0)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to reload script %s : %s ", script.c_str(), errMsg);
-        lua_pop(state, 1);
-        free(data);
-        panic = true;
-        return false;
+        now += ticks;
+        return;
     }
-    free(data);
+    for (int i = 0; i < ticks; i++)
+        Tick();
 
-    if (lua_pcall(state, 0, LUA_MULTRET, 0) != LUA_OK)
+    // callbacks run after the wheels are settled, they may add or cancel timers
+    for (size_t i = 0; i < firing.size(); i++)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to execute reloaded script %s : %s ", script.c_str(), errMsg);
-        lua_pop(state, 1);
-        panic = true;
-        return false;
+        Fire fire = firing[i];
+        if (entries[fire.index].serial != fire.serial)
+            continue;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, fire.callback);
+        lua_pushinteger(L, fire.id);
+        if (lua_pcall(L, 1, 0, 0) != LUA_OK)
+        {
+            Log(LOG_ERROR, "Failed to call timer function: %s", lua_tostring(L, -1));
+            lua_pop(L, 1);
+            if (!fire.once)
+                Cancel(fire.id);
+        }
+        // the one shot is done unless it cancelled itself
+        if (fire.once && entries[fire.index].serial == fire.serial)
+        {
+            luaL_unref(L, LUA_REGISTRYINDEX, fire.callback);
+            Release(fire.index);
+        }
     }
+    firing.clear();
+}
 
-    if (!lua_istable(state, -1))
+void TimerWheel::Clear(lua_State *state)
+{
+    for (Entry &entry : entries)
     {
-        Log(LOG_ERROR, "Reloaded script %s must return a table.", script.c_str());
-        lua_pop(state, 1);
-        panic = true;
-        return false;
+        if (entry.level != -1)
+            luaL_unref(state, LUA_REGISTRYINDEX, entry.callback);
     }
+    entries.clear();
+    freeEntries.clear();
+    firing.clear();
+    owners.clear();
+    for (int level = 0; level < Levels; level++)
+        for (int slot = 0; slot < Slots; slot++)
+            heads[level][slot] = -1;
+    now = 0;
+    remainder = 0;
+    count = 0;
+}
 
-    // Store a reference to the script in the global table
-    lua_getglobal(state, "script_refs");
-    lua_pushvalue(state, -2);                // Push the script table
-    lua_setfield(state, -2, script.c_str()); // Store a reference to the script table in the global table using 'lua' instead of 'GetFileNameWithoutExt(lua)'
-    lua_pop(state, 1);                       // Remove the global table from the stack
-
-    // Get the script reference
-    lua_getglobal(state, "script_refs");
-    lua_getfield(state, -1, script.c_str());
-    script_ref = luaL_ref(state, LUA_REGISTRYINDEX);
+//*********************************************************************************************************************
+//**                         MessageBus                                                                             **
+//*********************************************************************************************************************
 
-    lua_pop(state, 1); // Remove the global table from the stack
+const char *MessageBus::Broadcast = "*";
 
-    LuaBind();
-    panic = false;
-    watch = false;
-    timeLoad = GetFileModTime(script.c_str());
-    //callOnReadyDone = false;
-    Log(LOG_INFO, "Reloaded script %s completed", script.c_str());
+bool MessageBus::Subscribe(ScriptComponent *script, const std::string &name)
+{
+    if (std::find(script->channels.begin(), script->channels.end(), name) != script->channels.end())
+        return false;
+    Channel &channel = channels[name];
+    channel.subscribers.push_back(script);
+    script->channels.push_back(name);
     return true;
 }
 
-void ScriptComponent::callOnAnimationFrame(int frame, const std::string &name)
+bool MessageBus::Unsubscribe(ScriptComponent *script, const std::string &name)
 {
+    auto own = std::find(script->channels.begin(), script->channels.end(), name);
+    if (own == script->channels.end())
+        return false;
+    script->channels.erase(own);
+
+    auto it = channels.find(name);
+    if (it == channels.end())
+        return true;
+    Channel &channel = it->second;
+    auto found = std::find(channel.subscribers.begin(), channel.subscribers.end(), script);
+    if (found == channel.subscribers.end())
+        return true;
+    // delivery walks the list by index, so it only gets a hole until the end
+    if (delivering)
+    {
+        *found = nullptr;
+        channel.dirty = true;
+    }
+    else
+        channel.subscribers.erase(found);
+    return true;
 }
 
-void ScriptComponent::callOnAnimationEnd(const std::string &name)
+void MessageBus::Attach(ScriptComponent *script)
 {
+    if (script->hasCallback(ScriptOnMessage))
+        Subscribe(script, Broadcast);
+    else
+        Unsubscribe(script, Broadcast);
 }
-void ScriptComponent::callOnAnimationStart(const std::string &name)
+
+void MessageBus::Detach(ScriptComponent *script)
 {
+    while (!script->channels.empty())
+    {
+        std::string name = script->channels.back();
+        Unsubscribe(script, name);
+    }
 }
 
-void ScriptComponent::callOnCollide(GameObject *other)
+void MessageBus::Publish(lua_State *from, int payload, GameObject *sender, const std::string &name, const std::string &target)
 {
-    if (panic || !callOnReadyDone)
-        return;
-    if (!isFunctionRegistered("OnCollision"))
+    // nobody listening, nothing queued
+    auto it = channels.find(name);
+    if (it == channels.end() || it->second.subscribers.empty())
         return;
 
-    int ref = luaFunctions["OnCollision"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
+    lua_State *L = getState();
+    PushValue(from, payload, L);
+
+    Message message;
+    message.channel = &it->second;
+    message.name = &it->first;
+    message.payload = luaL_ref(L, LUA_REGISTRYINDEX);
+    message.sender = sender;
+    message.target = target;
+    queue.push_back(message);
+}
+
+// published while delivering goes out next frame
+void MessageBus::Deliver(lua_State *L)
+{
+    if (queue.empty())
+        return;
+    sending.swap(queue);
+    delivering = true;
 
-    if (other->script)
+    for (const Message &message : sending)
     {
-        lua_rawgeti(state, LUA_REGISTRYINDEX, other->table_ref);
+        std::vector<ScriptComponent *> &subscribers = message.channel->subscribers;
+        size_t count = subscribers.size();
+        lua_rawgeti(L, LUA_REGISTRYINDEX, message.payload);
+        int payload = lua_gettop(L);
+        for (size_t i = 0; i < count; i++)
+        {
+            ScriptComponent *script = subscribers[i];
+            if (script == nullptr)
+                continue;
+            GameObject *gameObject = script->gameObject;
+            // pooled objects and prefabs are out of the scene, children are in through their root
+            GameObject *root = gameObject;
+            while (root->parent != nullptr)
+                root = root->parent;
+            if (!gameObject->alive || root->scene == nullptr)
+                continue;
+            if (message.target.empty() ? gameObject == message.sender : gameObject->name != message.target)
+                continue;
+            script->callOnMessage(L, payload, message.name->c_str());
+        }
+        lua_settop(L, payload - 1);
+        luaL_unref(L, LUA_REGISTRYINDEX, message.payload);
     }
-    else
-        lua_pushstring(state, other->name.c_str());
+    sending.clear();
+    delivering = false;
 
-    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+    for (auto &it : channels)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'OnCollision' function in script: %s", errMsg);
-        lua_pop(state, 1);
+        Channel &channel = it.second;
+        if (!channel.dirty)
+            continue;
+        channel.subscribers.erase(std::remove(channel.subscribers.begin(), channel.subscribers.end(), nullptr),
+                                  channel.subscribers.end());
+        channel.dirty = false;
     }
 }
 
-void ScriptComponent::callOnUpdate(float dt)
+int MessageBus::Subscribers(const std::string &name) const
 {
-    if (IsKeyReleased(KEY_F5))
-        Reload();
+    auto it = channels.find(name);
+    if (it == channels.end())
+        return 0;
+    return (int)it->second.subscribers.size();
+}
 
-    if (panic || !callOnReadyDone)
-        return;
-    if (!isFunctionRegistered("update"))
-        return;
+void MessageBus::Clear(lua_State *L)
+{
+    for (const Message &message : queue)
+        luaL_unref(L, LUA_REGISTRYINDEX, message.payload);
+    queue.clear();
+    channels.clear();
+}
 
-    int ref = luaFunctions["update"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
-    lua_pushnumber(state, dt);
+//*********************************************************************************************************************
+//**                         ScriptWorkers                                                                          **
+//*********************************************************************************************************************
 
-    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+namespace BinScriptWorkers
+{
+
+    // upvalue 1 is the method name, upvalue 2 the method: callable from the main thread
+    // (OnReady, OnMessage...) but not from a parallel update; without a method it binds
+    // components or scripts to the calling state and is never available
+    static int Guarded(lua_State *L)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'update' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
+        lua_CFunction method = lua_tocfunction(L, lua_upvalueindex(2));
+        if (method == nullptr || ScriptWorkers::Instance().Running())
+            return luaL_error(L, "[%s] not available in an isolated script", lua_tostring(L, lua_upvalueindex(1)));
+        return method(L);
     }
-}
 
-void ScriptComponent::callOnPause()
-{
-    if (panic || !callOnReadyDone)
-        return;
-    if (!isFunctionRegistered("OnPause"))
-        return;
+    static int QueueMessage(lua_State *L, ScriptWorkers::Command::Type type, const char *name, int index)
+    {
+        GameObject *gameObject = GameObject::FromLua(L, 1);
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[sendMessage] gameObject is null");
+        }
+        lua_pushvalue(L, index);
+        int payload = luaL_ref(L, LUA_REGISTRYINDEX);
 
-    int ref = luaFunctions["OnPause"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
+        ScriptWorkers::Command command;
+        command.type = type;
+        command.sender = gameObject;
+        command.name = name != nullptr ? name : "";
+        command.x = command.y = 0;
+        command.layer = -1;
+        command.payload = payload;
+        command.now = false;
+        ScriptWorkers::Instance().Push(L, command);
+        return 0;
+    }
 
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
+    // upvalue 1 is the immediate version, used outside the parallel update
+    static int SendMessage(lua_State *L)
+    {
+        if (!ScriptWorkers::Instance().Running())
+            return lua_tocfunction(L, lua_upvalueindex(1))(L);
+        if (lua_gettop(L) != 2)
+        {
+            return luaL_error(L, "[sendMessage]  function requires 1 arguments");
+        }
+        return QueueMessage(L, ScriptWorkers::Command::Message, nullptr, 2);
+    }
 
-    lua_pushnumber(state, GetFrameTime());
+    static int Publish(lua_State *L)
+    {
+        if (!ScriptWorkers::Instance().Running())
+            return lua_tocfunction(L, lua_upvalueindex(1))(L);
+        const char *channel = luaL_checkstring(L, 2);
+        lua_settop(L, 3);
+        return QueueMessage(L, ScriptWorkers::Command::Publish, channel, 3);
+    }
 
-    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+    static int SendMessageTo(lua_State *L)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'OnPause' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
+        if (!ScriptWorkers::Instance().Running())
+            return lua_tocfunction(L, lua_upvalueindex(1))(L);
+        if (lua_gettop(L) != 3)
+        {
+            return luaL_error(L, "[sendMessageTo]  function requires 2 arguments");
+        }
+        const char *name = luaL_checkstring(L, 3);
+        return QueueMessage(L, ScriptWorkers::Command::MessageTo, name, 2);
+    }
+
+    // scene.instantiate(name, x, y [, layer]) in a worker state, the instance appears next frame
+    static int Instantiate(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        float x = (float)luaL_optnumber(L, 2, 0);
+        float y = (float)luaL_optnumber(L, 3, 0);
+        int layer = (int)luaL_optinteger(L, 4, -1);
+
+        ScriptWorkers::Command command;
+        command.type = ScriptWorkers::Command::Spawn;
+        command.sender = nullptr;
+        command.name = name;
+        command.x = x;
+        command.y = y;
+        command.layer = layer;
+        command.payload = LUA_NOREF;
+        command.now = false;
+        ScriptWorkers::Instance().Push(L, command);
+        return 0;
+    }
+
+    // animation names are interned in a table shared by every state, the switch waits for Apply
+    static int SetAnimation(lua_State *L)
+    {
+        if (!ScriptWorkers::Instance().Running())
+            return lua_tocfunction(L, lua_upvalueindex(1))(L);
+        GameObject *gameObject = GameObject::FromLua(L, 1);
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[setAnimation] gameObject is null");
+        }
+        const char *name = luaL_checkstring(L, 2);
+
+        ScriptWorkers::Command command;
+        command.type = ScriptWorkers::Command::SetAnimation;
+        command.sender = gameObject;
+        command.name = name;
+        command.x = command.y = 0;
+        command.layer = -1;
+        command.payload = LUA_NOREF;
+        command.now = lua_toboolean(L, 3) != 0;
+        ScriptWorkers::Instance().Push(L, command);
+        return 0;
+    }
+
+} // namespace BinScriptWorkers
+
+// methods table of a worker state, on top of the stack
+void ScriptWorkers::IsolateMethods(lua_State *L)
+{
+    static const char *bindings[] = {"addChild", "addScript", "addSprite", "addTiles", "addAnimator",
+                                     "getAnimator", "getSprite", "addComponent", "getComponent"};
+    static const char *sceneQueries[] = {"addBoxCollider", "addCircleCollider", "setSpriteGraph", "setTable",
+                                         "place_free", "place_meeting", "layer_place_meeting", "faceTo",
+                                         "subscribe", "unsubscribe"};
+    for (const char *name : bindings)
+    {
+        lua_pushstring(L, name);
+        lua_pushnil(L);
+        lua_pushcclosure(L, BinScriptWorkers::Guarded, 2);
+        lua_setfield(L, -2, name);
+    }
+    for (const char *name : sceneQueries)
+    {
+        lua_pushstring(L, name);
+        lua_getfield(L, -2, name);
+        lua_pushcclosure(L, BinScriptWorkers::Guarded, 2);
+        lua_setfield(L, -2, name);
     }
+
+    lua_getfield(L, -1, "sendMessage");
+    lua_pushcclosure(L, BinScriptWorkers::SendMessage, 1);
+    lua_setfield(L, -2, "sendMessage");
+    lua_getfield(L, -1, "sendMessageTo");
+    lua_pushcclosure(L, BinScriptWorkers::SendMessageTo, 1);
+    lua_setfield(L, -2, "sendMessageTo");
+    lua_getfield(L, -1, "setAnimation");
+    lua_pushcclosure(L, BinScriptWorkers::SetAnimation, 1);
+    lua_setfield(L, -2, "setAnimation");
+    lua_getfield(L, -1, "publish");
+    lua_pushcclosure(L, BinScriptWorkers::Publish, 1);
+    lua_setfield(L, -2, "publish");
+}
+
+bool ScriptWorkers::Start(int count)
+{
+    if (!workers.empty())
+        return false;
+    if (count <= 0)
+    {
+        count = (int)std::thread::hardware_concurrency();
+        if (count > 4)
+            count = 4;
+    }
+    if (count < 1)
+        count = 1;
+    if (count > 8)
+        count = 8;
+
+    workers.resize(count);
+    for (Worker &worker : workers)
+    {
+        worker.state = NewWorkerState();
+        worker.scripts = 0;
+        worker.time = 0;
+        lua_newtable(worker.state);
+        lua_pushcfunction(worker.state, BinScriptWorkers::Instantiate);
+        lua_setfield(worker.state, -2, "instantiate");
+        lua_setglobal(worker.state, "scene");
+    }
+    for (int i = 1; i < count; i++)
+        threads.push_back(std::thread(&ScriptWorkers::Loop, this, i));
+    Log(LOG_INFO, "Script workers started with %d lua states", count);
+    return true;
 }
-void ScriptComponent::callOnReady()
+
+void ScriptWorkers::Stop()
 {
-    if (panic)
+    if (workers.empty())
         return;
-
-    if (!isFunctionRegistered("OnReady"))
     {
-        callOnReadyDone = true;
-        return;
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
     }
+    wake.notify_all();
+    for (auto &thread : threads)
+        thread.join();
+    threads.clear();
+    quit = false;
+    generation = 0;
 
-    int ref = luaFunctions["OnReady"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
-    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
+    for (Worker &worker : workers)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'OnReady' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
-        callOnReadyDone = false;
-        return;
+        ScriptModule::Clear(worker.state);
+        lua_close(worker.state);
     }
-    callOnReadyDone = true;
+    workers.clear();
 }
 
-void ScriptComponent::callOnRemove()
+int ScriptWorkers::IndexOf(lua_State *L) const
 {
-    if (panic || !callOnReadyDone)
-        return;
-    if (!isFunctionRegistered("OnRemove"))
-        return;
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (workers[i].state == L)
+            return (int)i;
+    }
+    return -1;
+}
 
-    int ref = luaFunctions["OnRemove"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
+// the state a new instance of path runs in: the worker with fewer scripts for isolated modules
+lua_State *ScriptWorkers::Assign(lua_State *L, const std::string &path)
+{
+    if (workers.empty() || IndexOf(L) >= 0)
+        return L;
+    ScriptModule *module = ScriptModule::Get(L, path);
+    if (module->failed || !module->isolated)
+        return L;
 
-    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
+    size_t best = 0;
+    for (size_t i = 1; i < workers.size(); i++)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'OnRemove' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
+        if (workers[i].scripts < workers[best].scripts)
+            best = i;
     }
+    workers[best].scripts++;
+    return workers[best].state;
 }
 
-void ScriptComponent::callOnRender()
+void ScriptWorkers::Release(int index)
 {
-    if (panic || !callOnReadyDone)
-        return;
-    if (!isFunctionRegistered("render"))
-        return;
+    if (index >= 0 && index < (int)workers.size())
+        workers[index].scripts--;
+}
 
-    int ref = luaFunctions["render"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
+void ScriptWorkers::Push(lua_State *L, const Command &command)
+{
+    int index = IndexOf(L);
+    if (index >= 0)
+        workers[index].commands.push_back(command);
+}
 
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
+void ScriptWorkers::Run(float dt)
+{
+    int scripts = 0;
+    for (const Worker &worker : workers)
+        scripts += worker.scripts;
+    if (scripts == 0)
+        return;
 
-    if (lua_pcall(state, 1, 0, 0) != LUA_OK)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'render' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        delta = dt;
+        running = true;
+        pending = (int)threads.size();
+        generation++;
     }
+    wake.notify_all();
+    Execute(workers[0]);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]
+              { return pending == 0; });
+    running = false;
 }
 
-void ScriptComponent::callOnMessage()
+void ScriptWorkers::Loop(int index)
 {
-    if (panic || !callOnReadyDone)
-        return;
+    unsigned int seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]
+                      { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
 
-    if (!isFunctionRegistered("OnMessage"))
-        return;
+        Execute(workers[index]);
 
-    int ref = luaFunctions["OnMessage"];
-    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
+
+// a worker only touches its own state and the objects it owns
+void ScriptWorkers::Execute(Worker &worker)
+{
+    double start = GetTime();
+    for (ScriptComponent *script : worker.queue)
+        script->callOnUpdate(delta);
+    worker.queue.clear();
+    ScriptModule::UpdateBatches(worker.state, delta);
+    worker.time = GetTime() - start;
+}
+
+// main thread, workers idle: queued spawns and messages in the order each worker made them,
+// the messages go out with the rest of the bus right after
+void ScriptWorkers::Apply(Scene *scene)
+{
+    for (Worker &worker : workers)
+    {
+        for (Command &command : worker.commands)
+        {
+            if (command.type == Command::Spawn)
+            {
+                GameObject *gameObject = scene->Instantiate(command.name, command.x, command.y);
+                if (gameObject == nullptr)
+                    Log(LOG_WARNING, "[instantiate] prefab %s not found", command.name.c_str());
+                else if (command.layer >= 0)
+                    gameObject->layer = command.layer;
+                continue;
+            }
+            if (command.type == Command::SetAnimation)
+            {
+                if (command.sender->HasComponent<Animator>())
+                {
+                    Animator *animator = command.sender->GetComponent<Animator>();
+                    animator->SetAnimation(command.name, command.now);
+                    if (command.now)
+                        animator->Play();
+                }
+                continue;
+            }
 
-    lua_rawgeti(state, LUA_REGISTRYINDEX, gameObject->table_ref); // Empilha a tabela do objeto
+            lua_State *L = worker.state;
+            MessageBus &bus = MessageBus::Instance();
+            lua_rawgeti(L, LUA_REGISTRYINDEX, command.payload);
+            if (command.type == Command::Message)
+                bus.Publish(L, lua_gettop(L), command.sender, MessageBus::Broadcast);
+            else if (command.type == Command::MessageTo)
+                bus.Publish(L, lua_gettop(L), command.sender, MessageBus::Broadcast, command.name);
+            else
+                bus.Publish(L, lua_gettop(L), command.sender, command.name);
+            lua_pop(L, 1);
+            luaL_unref(L, LUA_REGISTRYINDEX, command.payload);
+        }
+        worker.commands.clear();
+    }
+}
 
-    lua_pushvalue(state, 2);
+void ScriptWorkers::Reload(const std::string &path)
+{
+    for (Worker &worker : workers)
+        ScriptModule::Reload(worker.state, path);
+}
 
-    // enviamos a table recebida do lua para os scripts 'OnMessage'
-    if (lua_pcall(state, 2, 0, 0) != LUA_OK)
+void ScriptWorkers::SetGlobal(const char *name, lua_Integer value)
+{
+    for (Worker &worker : workers)
     {
-        const char *errMsg = lua_tostring(state, -1);
-        Log(LOG_ERROR, "Failed to call 'OnMessage' function in script: %s", errMsg);
-        lua_pop(state, 1);
-        panic = true;
+        lua_pushinteger(worker.state, value);
+        lua_setglobal(worker.state, name);
     }
 }
 
@@ -4973,7 +8269,7 @@ bool compareGameObjectDepth(const GameObject *a, const GameObject *b)
 }
 Scene *Scene::m_instance = nullptr;
 
-Scene::Scene() : lastCheckTime(0), checkInterval(5)
+Scene::Scene() : lastCheckTime(0), checkInterval(5), loadCallback(LUA_NOREF)
 {
     m_instance = this;
     timer.start();
@@ -5024,6 +8320,7 @@ void Scene::addToLayer(GameObject *e)
         }
     }
     layers[e->layer].emplace_back(e);
+    invalidateLayer(e->layer);
 }
 
 int Scene::layersCount()
@@ -5055,6 +8352,7 @@ void Scene::ClearScene()
                                return true;
                            }),
             std::end(layers[layer]));
+        invalidateLayer(layer);
     }
 
     for (auto gameObject : gameObjectsToAdd)
@@ -5086,6 +8384,113 @@ void Scene::ClearScene()
     Collect();
 }
 
+void Scene::SetPool(const std::string &key, int capacity)
+{
+    auto it = pools.find(key);
+    if (capacity <= 0)
+    {
+        if (it == pools.end())
+            return;
+        for (GameObject *gameObject : it->second.objects)
+            delete gameObject;
+        pools.erase(it);
+        return;
+    }
+    ObjectPool &pool = pools[key];
+    pool.capacity = capacity;
+    while ((int)pool.objects.size() > capacity)
+    {
+        delete pool.objects.back();
+        pool.objects.pop_back();
+    }
+    pool.objects.reserve(capacity);
+}
+
+GameObject *Scene::Spawn(const std::string &name, int layer, bool *reused, const GameObject *prefab)
+{
+    GameObject *gameObject = nullptr;
+    bool fromPool = false;
+    auto it = pools.find(name);
+    if (it != pools.end() && !it->second.objects.empty())
+    {
+        fromPool = true;
+        gameObject = it->second.objects.back();
+        it->second.objects.pop_back();
+        it->second.reused++;
+        gameObject->name = name;
+        gameObject->layer = layer;
+        // reset to constructor defaults when pooled, a prefab instance gets the template's back
+        if (prefab != nullptr)
+            gameObject->CopyFields(prefab);
+    }
+    else
+    {
+        gameObject = prefab != nullptr ? prefab->Clone() : new GameObject(name, layer);
+        if (it != pools.end())
+        {
+            gameObject->poolKey = name;
+            it->second.created++;
+        }
+    }
+    if (reused != nullptr)
+        *reused = fromPool;
+    return gameObject;
+}
+
+bool Scene::ReturnToPool(GameObject *gameObject)
+{
+    if (gameObject->poolKey.empty() || gameObject->parent != nullptr)
+        return false;
+    auto it = pools.find(gameObject->poolKey);
+    if (it == pools.end() || (int)it->second.objects.size() >= it->second.capacity)
+        return false;
+    gameObject->ResetForPool();
+    it->second.objects.push_back(gameObject);
+    return true;
+}
+
+void Scene::AddPrefab(const std::string &name, GameObject *gameObject)
+{
+    auto it = prefabs.find(name);
+    if (it != prefabs.end())
+        delete it->second;
+    // the template keeps its script only for the resolved path, it never runs
+    gameObject->name = name;
+    gameObject->prefab = true;
+    prefabs[name] = gameObject;
+}
+
+GameObject *Scene::Instantiate(const std::string &name, float x, float y, bool *reused)
+{
+    auto it = prefabs.find(name);
+    if (it == prefabs.end())
+        return nullptr;
+    const GameObject *prefab = it->second;
+    GameObject *gameObject = Spawn(name, prefab->layer, reused, prefab);
+    gameObject->prefab = false;
+    gameObject->transform->position.x = x;
+    gameObject->transform->position.y = y;
+    AddQueueObject(gameObject);
+    return gameObject;
+}
+
+void Scene::FreePrefabs()
+{
+    for (auto &it : prefabs)
+        delete it.second;
+    prefabs.clear();
+}
+
+void Scene::FreePools()
+{
+    for (auto &it : pools)
+    {
+        for (GameObject *gameObject : it.second.objects)
+            delete gameObject;
+    }
+    pools.clear();
+}
+
 void Scene::ClearAndFree()
 {
     Log(LOG_INFO, "Clearing and free scene GameObject");
@@ -5095,6 +8500,7 @@ void Scene::ClearAndFree()
         layers[layer].clear();
     }
     layers.clear();
+    FreeLayerCache();
 
     for (auto gameObject : gameObjects)
     {
@@ -5117,6 +8523,8 @@ void Scene::ClearAndFree()
         gameObject = nullptr;
     }
     gameObjectsToAdd.clear();
+    FreePools();
+    FreePrefabs();
 }
 
 void Scene::Init(const std::string &title, float fps, int windowWidth, int windowHeight, bool fullscreen)
@@ -5136,6 +8544,9 @@ void Scene::Init(const std::string &title, float fps, int windowWidth, int windo
 
     lua_pushinteger(getState(), windowHeight);
     lua_setglobal(getState(), "WindowHeight");
+
+    ScriptWorkers::Instance().SetGlobal("WindowWidth", windowWidth);
+    ScriptWorkers::Instance().SetGlobal("WindowHeight", windowHeight);
 }
 
 void Scene::SetWorld(float width, float height)
@@ -5148,6 +8559,9 @@ void Scene::SetWorld(float width, float height)
 
     lua_pushinteger(getState(), (int)height);
     lua_setglobal(getState(), "WorldHeight");
+
+    ScriptWorkers::Instance().SetGlobal("WorldWidth", (lua_Integer)width);
+    ScriptWorkers::Instance().SetGlobal("WorldHeight", (lua_Integer)height);
 }
 
 void Scene::SetBackground(int r, int g, int b)
@@ -5254,9 +8668,15 @@ json serializeGameObject(GameObject *obj)
         for (auto &pair : animComponent->animations)
         {
             Animation *anim = pair.second;
-            std::string name = pair.first;
             json animJson;
-            animJson["name"] = name;
+            animJson["name"] = GetAnimationName(pair.first);
+            if (anim->rows == 0)
+            {
+                // sheet clip, frames come from the library
+                animJson["clip"] = anim->key;
+                animation["animations"].push_back(animJson);
+                continue;
+            }
             animJson["graph"] = anim->graphID;
             animJson["count"] = anim->frameCount;
             animJson["duration"] = anim->frameDuration;
@@ -5268,6 +8688,40 @@ json serializeGameObject(GameObject *obj)
         objJson["components"].push_back(animation);
     }
 
+    if (obj->HasComponent<ParallaxComponent>())
+    {
+        json parallax;
+        ParallaxComponent *parallaxComponent = obj->GetComponent<ParallaxComponent>();
+        parallax["type"] = "ParallaxComponent";
+        parallax["backgrounds"] = json::array();
+        for (auto &layer : parallaxComponent->backgrounds)
+        {
+            json layerJson;
+            layerJson["graph"] = layer.graphID;
+            layerJson["factorX"] = layer.factorX;
+            layerJson["factorY"] = layer.factorY;
+            layerJson["repeat"] = layer.repeat;
+            parallax["backgrounds"].push_back(layerJson);
+        }
+        objJson["components"].push_back(parallax);
+    }
+
+    if (obj->HasComponent<TextComponent>())
+    {
+        json text;
+        TextComponent *textComponent = obj->GetComponent<TextComponent>();
+        text["type"] = "TextComponent";
+        text["text"] = textComponent->layout.GetText();
+        text["size"] = textComponent->layout.GetSize();
+        json colorJson;
+        colorJson["r"] = textComponent->color.r;
+        colorJson["g"] = textComponent->color.g;
+        colorJson["b"] = textComponent->color.b;
+        colorJson["a"] = textComponent->color.a;
+        text["color"] = colorJson;
+        objJson["components"].push_back(text);
+    }
+
     return objJson;
 }
 
@@ -5327,20 +8781,26 @@ GameObject *deserializeGameObject(const json &objJson)
                     for (const auto &animJson : componentsJson["animations"])
                     {
                         std::string name = animJson["name"].get<std::string>();
+                        if (animJson.contains("clip"))
+                        {
+                            anim->AddClip(name, animJson["clip"].get<std::string>());
+                            continue;
+                        }
                         std::string graphID = animJson["graph"].get<std::string>();
                         int frameCount = animJson["count"].get<int>();
                         float duration = animJson["duration"].get<float>();
                         int rows = animJson["rows"].get<int>();
                         int columns = animJson["columns"].get<int>();
 
-                        Animation *animation = new Animation(graphID, rows, columns, frameCount, duration);
-                        anim->AddAnimation(name, animation);
+                        Animation *animation = Assets::Instance().sharedClip(graphID, rows, columns, frameCount, duration);
+                        if (animation != nullptr)
+                            anim->AddAnimation(name, animation);
 
                         //              Log(LOG_INFO, "Adding animation %s %s %d %f %d %d", name.c_str(),graphID.c_str(),frameCount,duration,rows,columns);
                     }
                     if (anim->animations.size() > 0)
                     {
-                        anim->SetAnimation(anim->animations.begin()->first);
+                        anim->SetAnimation(0, true);
                         anim->Play();
                     }
                 }
@@ -5358,6 +8818,28 @@ GameObject *deserializeGameObject(const json &objJson)
                     TileLayerComponent *tileLayer = obj->AddComponent<TileLayerComponent>(width, height, tileWidth, tileHeight, spacing, margin, graphID);
                     tileLayer->loadFromString(componentsJson["tiles"].get<std::string>(),0);
                 }
+                else if (componentType == "ParallaxComponent")
+                {
+                    ParallaxComponent *parallax = obj->AddComponent<ParallaxComponent>();
+                    for (const auto &layerJson : componentsJson["backgrounds"])
+                    {
+                        parallax->Add(layerJson["graph"].get<std::string>(),
+                                      layerJson["factorX"].get<float>(),
+                                      layerJson["factorY"].get<float>(),
+                                      layerJson["repeat"].get<int>());
+                    }
+                }
+                else if (componentType == "TextComponent")
+                {
+                    std::string value = componentsJson["text"].get<std::string>();
+                    TextComponent *text = obj->AddComponent<TextComponent>(value, componentsJson["size"].get<int>());
+
+                    json colorJson = componentsJson["color"];
+                    text->color.r = colorJson["r"].get<int>();
+                    text->color.g = colorJson["g"].get<int>();
+                    text->color.b = colorJson["b"].get<int>();
+                    text->color.a = colorJson["a"].get<int>();
+                }
                 else
                 {
                     Log(LOG_ERROR, "Unknown component type %s", componentType.c_str());
@@ -5385,14 +8867,14 @@ bool Scene::LoadTiled(const char *filename)
 {
 
     Log(LOG_INFO, "Loading Tiled from %s", filename);
-    char *sceneData = LoadFileText(filename);
+    char *sceneData = LoadAssetText(filename);
     if (sceneData == nullptr)
     {
         Log(LOG_ERROR, "Failed to load tile map from %s", filename);
         return false;
     }
     json tileMap = json::parse(sceneData);
-    free(sceneData);
+    UnloadAssetText(sceneData);
 
     int width = tileMap["width"].get<int>();
     int height = tileMap["height"].get<int>();
@@ -5559,6 +9041,15 @@ bool Scene::Save(const char *filename)
     }
     sceneJson["GameObjects"] = gameObjectsJson;
 
+    json prefabsJson = json::array();
+    for (auto &it : prefabs)
+    {
+        json prefabJson = serializeGameObject(it.second);
+        prefabJson["name"] = it.first;
+        prefabsJson.push_back(prefabJson);
+    }
+    sceneJson["Prefabs"] = prefabsJson;
+
     json imagesJson = json::array();
     for (auto &graph : Assets::Instance().graphs)
     {
@@ -5603,9 +9094,9 @@ bool Scene::Save(const char *filename)
     // return SaveFileText(filename, (char *)sceneJson.dump(4).c_str());
 }
 
-bool Scene::Load(const char *filename)
+bool Scene::Load(const char *filename, bool async)
 {
-    char *sceneData = LoadFileText(filename);
+    char *sceneData = LoadAssetText(filename);
     if (sceneData == nullptr)
     {
         TraceLog(LOG_ERROR, "Failed to load scene from %s", filename);
@@ -5621,23 +9112,23 @@ bool Scene::Load(const char *filename)
     catch (const json::parse_error &e)
     {
         Log(LOG_ERROR, " parsing  JSON: %s ", e.what());
-        UnloadFileText(sceneData);
+        UnloadAssetText(sceneData);
         return false;
     }
     catch (const std::exception &e)
     {
         Log(LOG_ERROR, " parsingJSON: %s ", e.what());
-        UnloadFileText(sceneData);
+        UnloadAssetText(sceneData);
         return false;
     }
     catch (...)
     {
         Log(LOG_ERROR, " parsing JSON.");
-        UnloadFileText(sceneData);
+        UnloadAssetText(sceneData);
         return false;
     }
 
-    UnloadFileText(sceneData);
+    UnloadAssetText(sceneData);
 
     std::string sceneName = sceneJson["SceneName"].get<std::string>();
     sceneJson["NumObjects"].get<int>();
@@ -5679,7 +9170,16 @@ bool Scene::Load(const char *filename)
 
         std::string key = imgJson["key"].get<std::string>();
         std::string filename = imgJson["filename"].get<std::string>();
-        Assets::Instance().loadGraph(key, filename);
+        if (async)
+            Assets::Instance().loadGraphAsync(key, filename);
+        else
+            Assets::Instance().loadGraph(key, filename);
+    }
+
+    if (sceneJson.contains("Prefabs"))
+    {
+        for (const auto &prefabJson : sceneJson["Prefabs"])
+            AddPrefab(prefabJson["name"].get<std::string>(), deserializeGameObject(prefabJson));
     }
 
     const auto &objectsJson = sceneJson["GameObjects"];
@@ -5888,10 +9388,136 @@ bool Scene::inView(const  Rectangle& r )
     return true;//CheckCollisionRecs(r, cameraView);
 }
 
-void Scene::Render()
+//*********************************************************************************************************************
+//**                         Layer cache                                                                            **
+//*********************************************************************************************************************
+
+void Scene::setLayerStatic(int layer, bool enable, float margin)
+{
+    auto it = layerCache.find(layer);
+    if (!enable)
+    {
+        if (it != layerCache.end())
+        {
+            if (it->second.target.id != 0)
+                UnloadRenderTexture(it->second.target);
+            layerCache.erase(it);
+        }
+        return;
+    }
+
+    if (it == layerCache.end())
+    {
+        LayerCache cache;
+        cache.target.id = 0;
+        cache.zoom = 0;
+        cache.region = {0, 0, 0, 0};
+        it = layerCache.emplace(layer, cache).first;
+    }
+    it->second.dirty = true;
+    it->second.ready = false;
+    it->second.margin = margin;
+}
+
+void Scene::invalidateLayer(int layer)
+{
+    if (layerCache.empty())
+        return;
+    auto it = layerCache.find(layer);
+    if (it != layerCache.end())
+        it->second.dirty = true;
+}
+
+void Scene::FreeLayerCache()
+{
+    for (auto &it : layerCache)
+    {
+        if (it.second.target.id != 0)
+            UnloadRenderTexture(it.second.target);
+    }
+    layerCache.clear();
+}
+
+void Scene::RenderLayer(int layer)
+{
+    auto it = layers.find(layer);
+    if (it == layers.end())
+        return;
+    for (auto &e : it->second)
+    {
+        if (e->alive && e->visible && inView(e->bound))
+        {
+            e->Render();
+            objectRender++;
+        }
+    }
+}
+
+void Scene::UpdateLayerCache()
 {
+    if (layerCache.empty())
+        return;
+
+    // only axis aligned cameras, with rotation the layers are drawn normally
+    bool rotated = (camera.rotation != 0.0f);
+
+    Vector2 view = GetScreenToWorld2D({0, 0}, camera);
+    float viewWidth = GetScreenWidth() / camera.zoom;
+    float viewHeight = GetScreenHeight() / camera.zoom;
+
+    for (auto &it : layerCache)
+    {
+        LayerCache &cache = it.second;
+        if (rotated)
+        {
+            cache.ready = false;
+            continue;
+        }
+
+        bool inside = view.x >= cache.region.x && view.y >= cache.region.y &&
+                      view.x + viewWidth <= cache.region.x + cache.region.width &&
+                      view.y + viewHeight <= cache.region.y + cache.region.height;
+
+        if (cache.ready && !cache.dirty && inside && cache.zoom == camera.zoom)
+            continue;
+
+        cache.region.x = floorf(view.x - cache.margin);
+        cache.region.y = floorf(view.y - cache.margin);
+        cache.region.width = viewWidth + cache.margin * 2 + 1;
+        cache.region.height = viewHeight + cache.margin * 2 + 1;
+
+        int width = (int)ceilf(cache.region.width * camera.zoom);
+        int height = (int)ceilf(cache.region.height * camera.zoom);
+        if (cache.target.id == 0 || cache.target.texture.width != width || cache.target.texture.height != height)
+        {
+            if (cache.target.id != 0)
+                UnloadRenderTexture(cache.target);
+            cache.target = LoadRenderTexture(width, height);
+        }
 
+        Camera2D view_camera;
+        view_camera.target = {cache.region.x, cache.region.y};
+        view_camera.offset = {0, 0};
+        view_camera.rotation = 0;
+        view_camera.zoom = camera.zoom;
 
+        BeginTextureMode(cache.target);
+        ClearBackground(BLANK);
+        BeginMode2D(view_camera);
+        RenderLayer(it.first);
+        EndMode2D();
+        EndTextureMode();
+
+        cache.zoom = camera.zoom;
+        cache.dirty = false;
+        cache.ready = true;
+    }
+}
+
+void Scene::Render()
+{
+
+    UpdateLayerCache();
 
     ClearBackground(background);
     BeginMode2D(camera);
@@ -5900,14 +9526,15 @@ void Scene::Render()
 
     for (int i = 0; i < (int)layers.size(); i++)
     {
-        for (auto &e : layers[i])
+        auto it = layerCache.find(i);
+        if (it != layerCache.end() && it->second.ready)
         {
-            if (e->alive && e->visible && inView(e->bound))
-            {
-                e->Render();
-                objectRender++;
-            }
+            const LayerCache &cache = it->second;
+            Rectangle clip = {0, 0, (float)cache.target.texture.width, (float)cache.target.texture.height};
+            RenderTile(cache.target.texture, cache.region.x, cache.region.y, cache.region.width, cache.region.height, clip, false, true, 0);
+            continue;
         }
+        RenderLayer(i);
     }
 
     if (showDebug)
@@ -5970,12 +9597,15 @@ void Scene::Render()
         DrawRectangleLines(11, Y+1, 168, index * 22-2, BLUE);
         Y = GetScreenHeight() - 40;
         index = 0;
+        if ((int)layersText.size() < layersCount())
+            layersText.resize(layersCount());
         for (int i = 0; i < layersCount(); i++)
         {
             if (layers[i].size() > 0)
             {
                 Y = GetScreenHeight() - 20 - index * 22;
-                DrawText(TextFormat("Layer [%d]  Objects [%d] ", i, layers[i].size()), 28, Y, 10, LIME);
+                layersText[i].SetText(TextFormat("Layer [%d]  Objects [%d] ", i, layers[i].size()));
+                layersText[i].Draw(28, Y, LIME);
                 index++;
             }
         }
@@ -5984,21 +9614,50 @@ void Scene::Render()
         float y = 18;
         float s = 18;
 
-        DrawRectangle(10, 10, 220, 100, BLACK);
-        DrawRectangle(10, 10, 220, 100, Fade(SKYBLUE, 0.5f));
-        DrawRectangleLines(10, 10, 220, 100, BLUE);
-
-        DrawFPS(x, y);
-        DrawText(TextFormat("Objects: %i/%d", gameObjects.size(),objectRender), x, y + 1 * s, s, LIME);
-        DrawText(TextFormat("Elapsed time: %.2f", timer.getElapsedTime()), x, y + 2 * s, s, LIME);
-        DrawText(TextFormat("Delta time: %.2f", timer.getDeltaTime()), x, y + 3 * s, s, LIME);
-        DrawText(TextFormat("GC: %s", formatSize(getLuaMemoryUsage()).c_str()), x, y + 4 * s, s, LIME);
+        const int lines = sizeof(statsText) / sizeof(statsText[0]);
+        int boxHeight = (int)(lines * s) + 10;
+        DrawRectangle(10, 10, 220, boxHeight, BLACK);
+        DrawRectangle(10, 10, 220, boxHeight, Fade(SKYBLUE, 0.5f));
+        DrawRectangleLines(10, 10, 220, boxHeight, BLUE);
+
+        int fps = GetFPS();
+        Color fpsColor = LIME;
+        if (fps < 30 && fps >= 15)
+            fpsColor = ORANGE;
+        else if (fps < 15)
+            fpsColor = RED;
+
+        for (int i = 0; i < lines; i++)
+            statsText[i].SetSize((int)s);
+
+        statsText[0].SetText(TextFormat("%2i FPS", fps));
+        statsText[1].SetText(TextFormat("Objects: %i/%d", gameObjects.size(), objectRender));
+        statsText[2].SetText(TextFormat("Elapsed time: %.2f", timer.getElapsedTime()));
+        statsText[3].SetText(TextFormat("Delta time: %.2f", timer.getDeltaTime()));
+        statsText[4].SetText(TextFormat("GC: %s", formatSize(getLuaMemoryUsage()).c_str()));
+        const Assets &assets = Assets::Instance();
+        statsText[5].SetText(TextFormat("Textures: %s", formatSize((size_t)assets.textureBytes).c_str()));
+        statsText[6].SetText(TextFormat("Hit %d Miss %d Evict %d", assets.cacheHits, assets.cacheMisses, assets.cacheEvictions));
+        statsText[7].SetText(TextFormat("GC step: %.2f ms %s", GetGCFrameTime() * 1000.0, IsGCGenerational() ? "gen" : "inc"));
+        std::size_t frameCount = 0;
+        std::size_t frameBytes = GetLuaFrameAllocations(&frameCount);
+        std::size_t peak = 0;
+        std::size_t live = GetLuaMemory(&peak);
+        statsText[8].SetText(TextFormat("Lua: %s peak %s", formatSize(live).c_str(), formatSize(peak).c_str()));
+        statsText[9].SetText(TextFormat("Alloc/frame: %s (%d)", formatSize(frameBytes).c_str(), (int)frameCount));
+
+        statsText[0].Draw(x, y, fpsColor);
+        for (int i = 1; i < lines; i++)
+            statsText[i].Draw(x, y + i * s, LIME);
       //  DrawText(TextFormat("View: %f %f %f %f", cameraView.x,cameraView.y,cameraView.width,cameraView.height), x, y + 5 * s, s, LIME);
      //   DrawText(TextFormat("Camera: %f %f %f %f", camera.target.x,camera.target.y,camera.offset.x,camera.offset.y), x, y + 6 * s, s, LIME);
 
 
 
     }
+
+    if (Profiler::active)
+        Profiler::Instance().Draw(GetScreenWidth() - 410, 10);
 }
 
 void Scene::LiveReload()
@@ -6011,15 +9670,18 @@ void Scene::LiveReload()
     if (currentTime - lastCheckTime >= checkInterval)
     {
         lastCheckTime = currentTime;
-        //  Log(LOG_INFO, "Checking for script changes");
-        for (auto gameObject : gameObjects)
-        {
-            if (!gameObject->script)
-            {
-                continue;
-            }
-            gameObject->LiveReload();
-        }
+        VirtualFS::Instance().Refresh();
+    }
+
+    // one event per changed script, whatever the number of instances
+    changedScripts.clear();
+    if (!FileWatcher::Instance().Poll(changedScripts, (double)checkInterval))
+        return;
+    for (const std::string &path : changedScripts)
+    {
+        Log(LOG_INFO, "Script %s changed", path.c_str());
+        ScriptModule::Reload(getState(), path);
+        ScriptWorkers::Instance().Reload(path);
     }
 }
 
@@ -6039,6 +9701,23 @@ GameObject *Scene::GetGameObjectByName(const std::string &name)
 void Scene::Update()
 {
     timer.update();
+    Profiler::Instance().BeginFrame();
+
+    Assets::Instance().beginFrame();
+    Assets::Instance().updateStreaming();
+    if (loadCallback != LUA_NOREF && Assets::Instance().pendingGraphs() == 0)
+    {
+        lua_State *L = getState();
+        int callback = loadCallback;
+        loadCallback = LUA_NOREF;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callback);
+        luaL_unref(L, LUA_REGISTRYINDEX, callback);
+        if (lua_pcall(L, 0, 0, 0) != LUA_OK)
+        {
+            Log(LOG_ERROR, "[loadAsync] %s", lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+    }
 
     objectRender=0;
     cameraView.x= (-camera.offset.x/camera.zoom) + camera.target.x - (windowSize.x/2.0f/camera.zoom);
@@ -6074,6 +9753,11 @@ void Scene::Update()
         Collect();
     }
 
+    if (IsKeyReleased(KEY_F5))
+    {
+        ScriptModule::ReloadFailed();
+    }
+
     if (IsKeyReleased(KEY_F6))
     {
         enableLiveReload = !enableLiveReload;
@@ -6083,6 +9767,21 @@ void Scene::Update()
             Log(LOG_INFO, "Live reload disabled");
     }
 
+    // F7 profiles callbacks, shift+F7 also samples the lua stack, F8 writes profile.txt
+    if (IsKeyReleased(KEY_F7))
+    {
+        Profiler &profiler = Profiler::Instance();
+        if (Profiler::active)
+            profiler.Stop(getState());
+        else
+            profiler.Start(getState(), IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT));
+    }
+
+    if (IsKeyReleased(KEY_F8))
+    {
+        Profiler::Instance().Dump("profile.txt");
+    }
+
     if (IsKeyReleased(KEY_F3))
     {
         enableCollisions = !enableCollisions;
@@ -6100,20 +9799,37 @@ void Scene::Update()
 
     if (!timer.isPaused())
     {
+        // first, so objects a coroutine kills are removed this frame
+        CoroutineScheduler::Instance().Update(getState(), timer.getDeltaTime());
+        TimerWheel::Instance().Update(getState(), timer.getDeltaTime());
+
         for (auto gameObject : gameObjects)
         {
             if (gameObject->alive && gameObject->active)
             {
                 gameObject->Update(timer.getDeltaTime());
             }
+            if (gameObject->moved)
+            {
+                gameObject->moved = false;
+                invalidateLayer(gameObject->layer);
+            }
             if (!gameObject->alive)
             {
                 numObjectsRemoved++;
                 gameObjectsToRemove.push_back(gameObject);
             }
         }
+
+        // before the removals, the queued scripts are still alive
+        ScriptWorkers &workers = ScriptWorkers::Instance();
+        workers.Run(timer.getDeltaTime());
+        workers.Apply(this);
     }
 
+    // everything published since the last frame, paused or not
+    MessageBus::Instance().Deliver(getState());
+
     // auto partition_point = std::partition(gameObjects.begin(), gameObjects.end(),
     //                                         [](GameObject *obj) { return obj->alive; });
     // for (auto it = partition_point; it != gameObjects.end(); ++it)
@@ -6125,13 +9841,15 @@ void Scene::Update()
     for (auto gameObject : gameObjectsToRemove)
     {
         int layerKey = gameObject->layer;
-        if (layers.find(layerKey) != layers.end())
+        auto layer = layers.find(layerKey);
+        if (layer != layers.end())
         {
-            std::vector<GameObject *> &objectsInLayer = layers[layerKey];
+            std::vector<GameObject *> &objectsInLayer = layer->second;
             auto it = std::find(objectsInLayer.begin(), objectsInLayer.end(), gameObject);
             if (it != objectsInLayer.end())
             {
                 objectsInLayer.erase(it);
+                invalidateLayer(layerKey);
             }
         }
 
@@ -6141,12 +9859,21 @@ void Scene::Update()
             gameObject->OnRemove();
             gameObjects.erase(it);
             gameObject->scene = nullptr;
-            delete gameObject;
+            // a pooled object leaves nothing behind to collect
+            if (ReturnToPool(gameObject))
+                numObjectsRemoved--;
+            else
+                delete gameObject;
             gameObject = nullptr;
         }
     }
     gameObjectsToRemove.clear();
 
+    if (!timer.isPaused())
+    {
+        ScriptModule::UpdateBatches(getState(), timer.getDeltaTime());
+    }
+
     for (auto gameObject : gameObjectsToAdd)
     {
         gameObject->UpdateWorld();
@@ -6515,6 +10242,16 @@ void BoxColiderComponent::OnInit()
     }
 }
 
+Component *CircleColiderComponent::Clone() const
+{
+    return new CircleColiderComponent(*this);
+}
+
+Component *BoxColiderComponent::Clone() const
+{
+    return new BoxColiderComponent(*this);
+}
+
 //**************************************************************************************************
 //  ColideComponent
 //**************************************************************************************************
@@ -32,6 +32,11 @@
 #include <bitset>
 #include <cstring>
 #include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
 
 #define MAX_OBJECTS_REMOVE_TO_COLECT 250
 
@@ -140,19 +145,24 @@ private:
 class Graph
 {
 public:
-    Graph() : width(0), height(0)
+    Graph() : width(0), height(0), ready(true), refCount(0), lastUse(0), bytes(0), evicted(false), dropped(false), failed(false)
     {
     }
     Graph(const Graph &other)
-        : texture(other.texture), width(other.width), height(other.height)
+        : texture(other.texture), width(other.width), height(other.height), ready(other.ready),
+          refCount(0), lastUse(0), bytes(other.bytes), evicted(false), dropped(false), failed(false)
     {
     }
-    Graph(const char *filepath)
+    Graph(const char *filepath) : refCount(0), lastUse(0), evicted(false), dropped(false), failed(false)
     {
-        texture = LoadTexture(filepath);
+        Image image = LoadAssetImage(filepath);
+        texture = LoadTextureFromImage(image);
+        UnloadAssetImage(image);
         width = texture.width;
         height = texture.height;
         filename = filepath;
+        ready = true;
+        bytes = GetPixelDataSize(texture.width, texture.height, texture.format);
         //  Log(LOG_INFO, "Graph %s loaded %d %d ", filepath, width, height);
     }
 
@@ -161,6 +171,22 @@ public:
     Texture2D texture;
     int width;
     int height;
+    bool ready; // false while the texture is still streaming in
+    int refCount;               // components/clips holding this graph
+    unsigned long long lastUse; // frame of the last lookup
+    int bytes;                  // texture memory while resident
+    bool evicted;               // texture dropped by the cache, reloaded on next lookup
+    bool dropped;               // unloadGraph while still referenced, deleted on last release
+    bool failed;                // streamed decode failed, kept evicted until loaded again
+};
+
+class Animation;
+
+struct StreamNotify
+{
+    std::string key;
+    int callback;
+    bool ok;
 };
 
 class Assets
@@ -177,6 +203,12 @@ public:
         auto it = graphs.find(key);
         if (it != graphs.end())
         {
+            if (it->second->failed)
+            {
+                Log(LOG_WARNING, "Graph %s failed to load", key.c_str());
+                return nullptr;
+            }
+            touchGraph(it->second);
             return it->second;
         }
         Log(LOG_WARNING, "Graph %s not found", key.c_str());
@@ -195,50 +227,27 @@ public:
 
     Graph *loadGraph(const std::string &key, const std::string &filepath)
     {
-        Graph *graph = getGraph(key);
-        if (graph != nullptr)
+        auto it = graphs.find(key);
+        if (it != graphs.end())
         {
+            Graph *graph = it->second;
+            graph->failed = false;
+            // an evicted graph reloads in touchGraph and counts as a miss there
+            if (!graph->evicted)
+                cacheHits++;
+            touchGraph(graph);
+            graph->dropped = false;
             return graph;
         }
 
-        if (FileExists(filepath.c_str()))
-        {
-            graph = new Graph(filepath.c_str());
-        }
-        else if (FileExists((std::string("assets/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("assets/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("assets/images/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("assets/images/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("assets/textures/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("assets/textures/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("assets/levels/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("assets/levels/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("../assets/levels/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("../assets/levels/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("../assets/images/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("..assets/images/") + filepath).c_str());
-        }
-        else if (FileExists((std::string("../assets/textures/") + filepath).c_str()))
-        {
-            graph = new Graph((std::string("../assets/textures/") + filepath).c_str());
-        }
-        else
+        std::string path = findGraph(filepath);
+        if (path.empty())
         {
             Log(LOG_ERROR, "Failed to load  image %s", filepath.c_str());
             return nullptr;
         }
-
+        Graph *graph = new Graph(path.c_str());
+        cacheMisses++;
         // if (FileExists(filepath.c_str()) == false)
         // {
         //     Log(LOG_WARNING, "File %s not found", filepath.c_str());
@@ -246,35 +255,89 @@ public:
         // }
 
         graph->key = key;
+        graph->lastUse = cacheClock;
         graphs[key] = graph;
+        trackTexture(graph->bytes);
+        trimGraphs();
         return graph;
     }
 
-    void unloadGraph(const std::string &key)
-    {
-        auto it = graphs.find(key);
-        if (it != graphs.end())
-        {
-            UnloadTexture(it->second->texture);
-            graphs.erase(it);
-        }
-    }
+    void unloadGraph(const std::string &key);
     void clear()
     {
+        cancelStreaming();
+        clearClips();
         for (auto &graph : graphs)
         {
             Log(LOG_WARNING, " Unload image  %s ", graph.second->filename.c_str());
-            UnloadTexture(graph.second->texture);
+            if (graph.second->ready)
+            {
+                UnloadTexture(graph.second->texture);
+                trackTexture(-graph.second->bytes);
+            }
             delete graph.second;
         }
         graphs.clear();
+        textureBytes = 0;
     }
 
-    Assets() {}
+    // components and clips hold graphs through retain/release, only unreferenced
+    // textures are evicted (least recently used first) once over the budget
+    Graph *retainGraph(const std::string &key);
+    void retainGraph(Graph *graph);
+    void releaseGraph(Graph *graph);
+    void touchGraph(Graph *graph);
+    void evictGraph(Graph *graph);
+    void trackTexture(long long bytes); // textureBytes and the native count of memory.stats
+    void trimGraphs();
+    void setTextureBudget(long long bytes);
+
+    std::string findGraph(const std::string &filepath)
+    {
+        static const char *patterns[] = {"%s", "assets/%s", "assets/images/%s", "assets/textures/%s", "assets/levels/%s",
+                                         "../assets/levels/%s", "../assets/images/%s", "../assets/textures/%s"};
+        return VirtualFS::Instance().Resolve(filepath, patterns, 8);
+    }
+
+    // textures are decoded on worker threads and uploaded on the main thread,
+    // the graph holds a placeholder until then
+    Graph *loadGraphAsync(const std::string &key, const std::string &filepath, int callback = LUA_NOREF);
+    void updateStreaming();
+    void beginFrame() { cacheClock++; } // graphs looked up in the current frame are never evicted
+    int pendingGraphs() const { return streamPending; }
+    void cancelStreaming();
+    void stopStreaming();
+
+    // animation clips are shared by every animator, frame data is stored once
+    Animation *getClip(const std::string &name);
+    bool hasClip(const std::string &name);
+    Animation *addClip(const std::string &name, const std::string &graph, int rows, int columns, int frameCount, float framesPerSecond);
+    Animation *sharedClip(const std::string &graph, int rows, int columns, int frameCount, float frameDuration);
+    // one clip per frame name without its trailing number: run_1.png, run_2.png -> run.
+    // names that only differ in digits become one clip too (sister1.png, sister2.png -> sister),
+    // give single images a name that does not end in a number
+    int loadClips(const std::string &filepath, float framesPerSecond);
+    void clearClips();
+
+    Assets() : streamBudget(0.004), streamPending(0), textureBudget(256LL * 1024 * 1024), textureBytes(0),
+               cacheClock(0), cacheHits(0), cacheMisses(0), cacheEvictions(0) {}
     Assets(const Assets &) = delete;
     Assets &operator=(const Assets &) = delete;
 
     std::unordered_map<std::string, Graph *> graphs;
+    std::unordered_map<std::string, Animation *> clips;
+
+    double streamBudget; // seconds of texture upload per frame
+    int streamPending;
+    std::unordered_map<std::string, std::vector<int>> streamCallbacks;
+    std::vector<StreamNotify> streamNotify;
+
+    long long textureBudget; // bytes, 0 disables eviction
+    long long textureBytes;
+    unsigned long long cacheClock; // frames, see beginFrame
+    int cacheHits;
+    int cacheMisses;
+    int cacheEvictions;
 };
 
 class ScriptComponent;
@@ -296,6 +359,9 @@ public:
     virtual void OnDraw() {}
     virtual void OnDebug() {}
     virtual void OnDestroy() {}
+    virtual void OnReset() {} // a pooled object is being reused, setup is kept
+    // copy for prefab instances, GameObject::Clone sets the owner and lua binding
+    virtual Component *Clone() const { return nullptr; }
 };
 
 //*********************************************************************************************************************
@@ -341,6 +407,7 @@ public:
     bool IsColide(ColideComponent *other) override;
     void OnColide(ColideComponent *other) override;
     void OnInit() override;
+    Component *Clone() const override;
 };
 
 class CircleColiderComponent : public ColideComponent
@@ -362,6 +429,7 @@ public:
     void OnDebug() override;
     bool IsColide(ColideComponent *other) override;
     void OnColide(ColideComponent *other) override;
+    Component *Clone() const override;
 };
 
 //*********************************************************************************************************************
@@ -405,6 +473,11 @@ public:
     void OnDraw() override;
     void OnDebug() override;
     void OnInit() override;
+    void OnDestroy() override;
+    void OnReset() override;
+    Component *Clone() const override;
+
+    void SetGraph(Graph *graph);
 
     void SetClip(Rectangle clip);
     void SetClip(float x, float y, float width, float height);
@@ -415,6 +488,119 @@ private:
     bool isLoad;
 };
 
+//*********************************************************************************************************************
+//**                         TEXT                                                                                   **
+//*********************************************************************************************************************
+
+/*
+glyph quads are built once in layout space and only rebuilt from the first changed character,
+glyphs with the same advance (digits on a score/timer) just get new uvs
+*/
+class TextLayout
+{
+public:
+    TextLayout();
+
+    void SetFont(Font font, float size, float spacing);
+    void SetSize(int fontSize);
+    void SetText(const char *text);
+    void SetText(const std::string &text) { SetText(text.c_str()); }
+    void SetNumber(long value);
+
+    void Draw(float x, float y, Color color);
+    void Draw(const Matrix2D *matrix, Color color);
+
+    const std::string &GetText() const { return text; }
+    float GetWidth() const { return width; }
+    float GetHeight() const { return height; }
+    int GetSize() const { return (int)size; }
+
+private:
+    struct Glyph
+    {
+        int codepoint;
+        float x;
+        float y;
+        float advance;
+        bool visible;
+        rQuad quad;
+    };
+
+    void CheckFont();
+    void BuildGlyph(Glyph &glyph);
+    void Layout(size_t from);
+
+    Font font;
+    bool hasFont;
+    float size;
+    float spacing;
+    float lineHeight;
+    float width;
+    float height;
+    std::string text;
+    std::vector<int> codepoints;
+    std::vector<Glyph> glyphs;
+};
+
+class TextComponent : public Component
+{
+public:
+    TextLayout layout;
+    Color color;
+
+    TextComponent(const std::string &text, int size);
+    void OnDraw() override;
+    void OnDebug() override;
+    void OnReset() override;
+    Component *Clone() const override;
+
+    void BindLua(lua_State *L) override;
+
+private:
+    std::string initialText; // what it was created with, back on reset
+};
+
+//*********************************************************************************************************************
+//**                         PARALLAX                                                                               **
+//*********************************************************************************************************************
+
+enum ParallaxRepeat
+{
+    RepeatNone = 0,
+    RepeatX = 1,
+    RepeatY = 2,
+    RepeatBoth = 3
+};
+
+struct ParallaxLayer
+{
+    std::string graphID;
+    Graph *graph;
+    float factorX;
+    float factorY;
+    int repeat;
+};
+
+/*
+each background is one wrapped quad, uvs come from the scene camera
+factor 0 stays on screen, factor 1 moves with the world
+*/
+class ParallaxComponent : public Component
+{
+public:
+    std::vector<ParallaxLayer> backgrounds;
+    Color color;
+
+    ParallaxComponent();
+    void Add(const std::string &graph, float factorX, float factorY, int repeat);
+    void Clear();
+    void OnDraw() override;
+    void OnDestroy() override;
+    Component *Clone() const override;
+
+    void BindLua(lua_State *L) override;
+};
+
 struct Tileset
 {
     std::string name;
@@ -460,6 +646,8 @@ public:
     void OnDraw() override;
     void OnDebug() override;
     void OnInit() override;
+    void OnDestroy() override;
+    Component *Clone() const override;
     void BindLua(lua_State *L);
 
     void loadFromArray(const int *tiles);
@@ -501,6 +689,10 @@ enum AnimationMode
     Stop,
     Once
 };
+// animation names are interned once, the animator only works with ids
+int InternAnimationName(const std::string &name);
+const std::string &GetAnimationName(int id);
+
 class Animation
 {
 public:
@@ -512,54 +704,54 @@ public:
     int imageHeight;
 
     int frameCount;
-    int currentFrame;
     float frameDuration;
-    float currentTime;
-    bool isReversed;
     std::string graphID;
-    
+    std::string key;
+    std::vector<Rectangle> frames;
 
-    
     Animation(const std::string &graphID, int rows, int columns, int frameCount, float frameDuration);
+    Animation(const std::string &graphID, const std::vector<Rectangle> &frames, float frameDuration);
+    ~Animation();
 
-    Rectangle GetFrame();
-    void Update(float deltaTime, AnimationMode mode);
+    const Rectangle &GetFrame(int frame) const { return frames[frame]; }
+    bool IsValid() const { return graph != nullptr && !frames.empty() && frameDuration > 0; }
+    void Update(float deltaTime, AnimationMode mode, int &frame, float &time, bool &isReversed) const;
 };
 
 class Animator : public Component
 {
 public:
-    std::vector<std::pair<std::string, Animation *>> animations;
-    std::string currentAnimation;
-    std::string nextAnimation;
+    std::vector<std::pair<int, Animation *>> animations;
+    int current;
+    int next;
+    int frame;
+    float time;
     bool isPlaying;
+    bool isReversed;
+    bool isLoad;
 
     AnimationMode mode;
     SpriteComponent *sprite;
 
-    int frameCount;
-    int currentFrame;
-    float frameDuration;
-    float currentTime;
-    bool isReversed;
-    bool isLoad;
-    
-
     Animator();
 
     void OnDestroy() override;
     void OnDebug() override;
     void OnInit() override;
     void OnUpdate(float delta) override;
+    void OnReset() override;
+    Component *Clone() const override;
     Animation *GetAnimation();
+    int FindAnimation(int nameID) const;
 
-    
     void Add(const std::string &name, const std::string &graph, int rows, int columns, int frameCount, float framesPerSecond);
+    bool AddClip(const std::string &name, const std::string &clip);
     
     void AddAnimation(const std::string& name, Animation *animation);
 
     void SetMode(AnimationMode mode);
     void SetAnimation(const std::string &name, bool now = true);
+    void SetAnimation(int index, bool now);
     void Play();
     void Pause();
     void Stop();
@@ -567,12 +759,12 @@ public:
     void BindLua(lua_State *L) override;
 
     bool IsPlaying() { return isPlaying; }
-    int getFrameCount() { return frameCount; }
-    int getCurrentFrame() { return currentFrame; }
-    float getFrameDuration() { return frameDuration; }
-    float getCurrentTime() { return currentTime; }
+    int getFrameCount() { return current >= 0 ? animations[current].second->frameCount : 0; }
+    int getCurrentFrame() { return frame; }
+    float getFrameDuration() { return current >= 0 ? animations[current].second->frameDuration : 0; }
+    float getCurrentTime() { return time; }
     bool getIsReversed() { return isReversed; }
-    std::string getName() { return currentAnimation; }
+    std::string getName() { return current >= 0 ? GetAnimationName(animations[current].first) : ""; }
 };
 
 //*********************************************************************************************************************
@@ -598,6 +790,7 @@ public:
     bool active;
     bool prefab;
     bool persistent;
+    std::string poolKey; // set when spawned from a Scene pool, see Scene::SetPool
     long debugMask;
     int layer;
 
@@ -618,6 +811,7 @@ public:
     bool bbReset;
 
     Rectangle bound;
+    bool moved; // bound changed in the last UpdateWorld, read by the layer cache
 
     float radius;
     GameObject *parent;
@@ -642,11 +836,9 @@ public:
     void OnPause();
     void OnRemove();
     void OnCollision(GameObject *other);
+    void ResetForPool();
 
-    void sendMensageAll();
-    void sendMensageTo(const std::string &name);
     void setDebug(int mask);
-    void LiveReload();
     void UpdateWorld();
 
     Vec2 GetWorldPoint(float _x, float _y);
@@ -660,6 +852,10 @@ public:
     bool place_meeting_layer(float x, float y, int layer);
 
     void BindLua(lua_State *L);
+    int NewHandle(lua_State *L); // registry ref to a new handle of this object in L
+    static GameObject *FromLua(lua_State *L, int index);
+    GameObject *Clone() const;
+    void CopyFields(const GameObject *from); // the plain fields and transform Clone copies
 
     void centerPivot();
     void centerOrigin();
@@ -854,17 +1050,144 @@ protected:
     float _y;
 };
 
+//*********************************************************************************************************************
+//**                         ScriptCache                                                                            **
+//*********************************************************************************************************************
+
+// lua_dump of every script under cache/scripts, reused while the source keeps
+// its mod time and size and the lua version matches; pack entries are never cached.
+// the file name flattens the path, so the header keeps a hash of the full one
+class ScriptCache
+{
+public:
+    struct Header
+    {
+        char magic[4]; // "ULBC"
+        unsigned int luaVersion;
+        long long modTime;
+        long long sourceSize;
+        unsigned long long pathHash; // fnv-1a of the source path, two paths may share a cache name
+    };
+
+    static ScriptCache &Instance()
+    {
+        static ScriptCache instance;
+        return instance;
+    }
+
+    // pushes the compiled chunk, returns the luaL_loadbufferx status (message on the stack on error);
+    // refresh ignores the cached bytecode and compiles the source again, mtime only has second resolution
+    int Load(lua_State *L, const char *fileName, bool refresh = false);
+    void SetEnabled(bool value) { enabled = value; }
+    bool IsEnabled() const { return enabled; }
+
+    int hits;
+    int compiled;
+    double loadTime; // seconds spent in Load
+
+private:
+    ScriptCache() : hits(0), compiled(0), loadTime(0), enabled(true), directory("cache/scripts"), directoryReady(false) {}
+    ScriptCache(const ScriptCache &) = delete;
+    ScriptCache &operator=(const ScriptCache &) = delete;
+
+    std::string CachePath(const char *fileName) const;
+    void Store(lua_State *L, const std::string &cachePath, const Header &header);
+
+    bool enabled;
+    std::string directory;
+    bool directoryReady;
+};
+
+// callbacks a script may define, resolved once per bind into ScriptComponent::callbacks
+enum ScriptCallback
+{
+    ScriptOnReady,
+    ScriptOnRemove,
+    ScriptOnAnimationEnd,
+    ScriptOnAnimationStart,
+    ScriptOnAnimation,
+    ScriptRender,
+    ScriptUpdate,
+    ScriptOnPause,
+    ScriptOnMessage,
+    ScriptOnCollision,
+    ScriptRun, // started as a coroutine after OnReady, see CoroutineScheduler
+    ScriptCallbackCount
+};
+
+// one compiled module per script path, every instance of the script shares it;
+// a reload compiles once and rebinds all instances in one pass
+class ScriptModule
+{
+public:
+    std::string path;
+    lua_State *state; // modules are per state, worker states compile their own
+    int ref; // module table, also stored in script_refs[path]
+    long timeLoad;
+    bool failed;
+    bool isolated; // exports isolated = true, instances go to the ScriptWorkers
+    std::vector<ScriptComponent *> instances;
+
+    // opt-in batch mode: a module exporting updateAll(instances, dt) is called
+    // once per frame with the array of its ready instances instead of update per object
+    int updateAll;
+    int batchRef; // lua array mirroring batch
+    bool batchPanic;
+    std::vector<ScriptComponent *> batch;
+
+    // filled while the Profiler is active, one slot per ScriptCallback
+    struct CallStats
+    {
+        double time;
+        double maxTime;
+        int calls;
+    };
+    CallStats profile[ScriptCallbackCount];
+
+    static ScriptModule *Get(lua_State *L, const std::string &path);
+    static ScriptModule *Find(lua_State *L, const std::string &path);
+    static bool Reload(lua_State *L, const std::string &path);
+    static void ReloadFailed();
+    static void UpdateBatches(lua_State *L, float dt);
+    static void Clear(lua_State *L);
+
+    void Attach(ScriptComponent *script);
+    void Detach(ScriptComponent *script);
+    void AddToBatch(ScriptComponent *script);
+    void RemoveFromBatch(ScriptComponent *script);
+    void ResetProfile()
+    {
+        for (int i = 0; i < ScriptCallbackCount; i++)
+            profile[i].time = profile[i].maxTime = profile[i].calls = 0;
+    }
+
+private:
+    ScriptModule(lua_State *L, const std::string &path)
+        : path(path), state(L), ref(LUA_NOREF), timeLoad(0), failed(false), isolated(false), updateAll(LUA_NOREF), batchRef(LUA_NOREF), batchPanic(false) { ResetProfile(); }
+    bool Compile(lua_State *L, bool refresh = false);
+    void RebuildBatch(lua_State *L);
+    void SyncBatch();
+};
+
 class ScriptComponent
 {
 public:
     friend class GameObject;
-    std::unordered_map<std::string, int> luaFunctions;
+    friend class ScriptModule;
+    int callbacks[ScriptCallbackCount];
+    unsigned int callbackMask;
     bool callOnReadyDone;
     int script_ref;
+    ScriptModule *module;
+    int moduleIndex;
+    int batchIndex;
 
     std::string script;
     GameObject *gameObject;
     lua_State *state;
+    int worker;   // ScriptWorkers index, -1 in the main state
+    int self_ref; // the object handle in state, its own one in a worker state
+    std::vector<std::string> channels; // MessageBus subscriptions
     bool panic;
     bool watch;
     long timeLoad;
@@ -872,8 +1195,10 @@ public:
     ScriptComponent(GameObject *gameObject, const char *lua, lua_State *L);
     virtual ~ScriptComponent();
     ScriptComponent(const ScriptComponent &other)
-        : script(other.script)
+        : callbackMask(0), module(nullptr), moduleIndex(-1), batchIndex(-1), script(other.script), worker(-1), self_ref(LUA_NOREF)
     {
+        for (int i = 0; i < ScriptCallbackCount; i++)
+            callbacks[i] = LUA_NOREF;
     }
     void callOnReady();
     void callOnRemove();
@@ -881,19 +1206,368 @@ public:
     void callOnUpdate(float dt);
     void callOnRender();
     void callOnCollide(GameObject *other);
-    void callOnMessage();
+    // payload is the value at that index of from, copied when the script lives in another state
+    void callOnMessage(lua_State *from, int payload, const char *channel);
 
     void callOnAnimationFrame(int frame, const std::string &name);
     void callOnAnimationEnd(const std::string &name);
     void callOnAnimationStart(const std::string &name);
 
-    void registerFunction(const char *functionName);
-    bool isFunctionRegistered(const char *functionName);
+    void registerFunction(ScriptCallback id);
+    bool hasCallback(ScriptCallback id) const { return (callbackMask & (1u << id)) != 0; }
+    void unregisterFunctions();
 
     bool Reload();
     void LuaBind();
 };
 
+//*********************************************************************************************************************
+//**                         Profiler                                                                               **
+//*********************************************************************************************************************
+
+// times every script callback into ScriptModule::profile and, when sampling, runs a
+// lua count hook that walks the call stack; off it costs one flag test per callback
+class Profiler
+{
+public:
+    struct Sample
+    {
+        int self;  // samples with the function on top of the stack
+        int total; // samples with the function anywhere on the stack
+    };
+
+    static bool active;
+
+    static Profiler &Instance()
+    {
+        static Profiler instance;
+        return instance;
+    }
+
+    void Start(lua_State *L, bool sampling, int interval = 1000);
+    void Stop(lua_State *L);
+    void Reset();
+    void BeginFrame()
+    {
+        if (active)
+            frames++;
+    }
+    void Record(ScriptModule *module, ScriptCallback id, double seconds);
+    bool Dump(const char *fileName);
+    void Draw(int x, int y);
+
+    bool sampling;
+    int interval; // lua instructions between samples
+    int frames;
+    int sampleCount;
+    double luaTime; // seconds inside timed callbacks
+    std::unordered_map<std::string, Sample> samples;
+
+private:
+    Profiler() : sampling(false), interval(1000), frames(0), sampleCount(0), luaTime(0) {}
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    static void Hook(lua_State *L, lua_Debug *ar);
+};
+
+//*********************************************************************************************************************
+//**                         CoroutineScheduler                                                                     **
+//*********************************************************************************************************************
+
+// script coroutines of the main state: a suspended one sits in a timer heap, a frame heap,
+// the predicate list or a signal list and is resumed only when due, so waiting costs nothing
+// per frame except for waitUntil; the clock is the scene's, it stops while the scene is paused
+class CoroutineScheduler
+{
+public:
+    static CoroutineScheduler &Instance()
+    {
+        static CoroutineScheduler instance;
+        return instance;
+    }
+
+    // function and nargs arguments on top of L, resumed right away
+    void Start(lua_State *L, int nargs, GameObject *owner);
+    void Update(lua_State *L, float dt);
+    void Cancel(GameObject *owner);
+    void Signal(const std::string &name);
+    void Clear(lua_State *L);
+    int Count() const { return (int)threads.size(); }
+
+    // called by the wait primitives from the running coroutine, false outside one
+    bool WaitTime(lua_State *thread, double seconds);
+    bool WaitFrames(lua_State *thread, int frames);
+    bool WaitUntil(lua_State *thread, int predicate);
+    bool WaitSignal(lua_State *thread, const std::string &name);
+
+private:
+    struct Task
+    {
+        lua_State *thread;
+        int ref;       // keeps the thread alive
+        int predicate; // waitUntil function
+        GameObject *owner;
+        unsigned int serial; // bumped on every wait and on free, stale entries are skipped
+        bool waiting;
+        bool running;
+        bool cancelled; // freed while running, done once it yields
+    };
+
+    struct Due
+    {
+        double time; // seconds or frame number
+        int index;
+        unsigned int serial;
+        bool operator>(const Due &other) const { return time > other.time; }
+    };
+
+    typedef std::priority_queue<Due, std::vector<Due>, std::greater<Due>> DueHeap;
+
+    CoroutineScheduler() : L(nullptr), clock(0), frame(0) {}
+    CoroutineScheduler(const CoroutineScheduler &) = delete;
+    CoroutineScheduler &operator=(const CoroutineScheduler &) = delete;
+
+    int Find(lua_State *thread);
+    unsigned int Suspend(int index);
+    void Resume(int index, int nargs);
+    void Free(int index);
+
+    lua_State *L;
+    std::vector<Task> tasks;
+    std::vector<int> freeTasks;
+    std::unordered_map<lua_State *, int> threads;
+    std::unordered_map<GameObject *, int> owners; // tasks per owner, Cancel skips the rest
+    DueHeap timers;
+    DueHeap frames;
+    std::vector<Due> predicates;
+    std::unordered_map<std::string, std::vector<Due>> signals;
+    std::vector<Due> ready;
+    std::vector<Due> resuming;
+    double clock;
+    long frame;
+};
+
+//*********************************************************************************************************************
+//**                         TimerWheel                                                                             **
+//*********************************************************************************************************************
+
+// lua callbacks after a delay or every period, in millisecond ticks on four wheels of 256
+// slots; a timer sits in an intrusive list so scheduling and cancelling are O(1), the wheels
+// advance once per frame with the scene clock and lua runs only when a timer fires
+class TimerWheel
+{
+public:
+    static const int Levels = 4;
+    static const int Slots = 256;
+    static const int TicksPerSecond = 1000;
+
+    static TimerWheel &Instance()
+    {
+        static TimerWheel instance;
+        return instance;
+    }
+
+    // callback on top of L, popped; returns the id for Cancel
+    lua_Integer Add(lua_State *L, double delay, double period, GameObject *owner = nullptr);
+    bool Cancel(lua_Integer id);
+    void Cancel(GameObject *owner); // the timers of an object that is going away
+    void Update(lua_State *L, float dt);
+    void Clear(lua_State *L);
+    int Count() const { return count; }
+
+private:
+    struct Entry
+    {
+        int callback;
+        unsigned long long due;
+        unsigned int period; // ticks, 0 fires once
+        unsigned int serial; // part of the id, bumped when the entry is freed
+        int prev;
+        int next;
+        int level; // -1 while free, -2 fired once and waiting for its call
+        int slot;
+        GameObject *owner;
+    };
+
+    struct Fire
+    {
+        int index;
+        unsigned int serial;
+        int callback;
+        lua_Integer id;
+        bool once; // released after the call
+    };
+
+    TimerWheel() : L(nullptr), now(0), remainder(0), count(0)
+    {
+        for (int level = 0; level < Levels; level++)
+            for (int slot = 0; slot < Slots; slot++)
+                heads[level][slot] = -1;
+    }
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    static unsigned int ToTicks(double seconds);
+    lua_Integer IdOf(int index) const { return ((lua_Integer)entries[index].serial << 32) | (lua_Integer)index; }
+    void Link(int index);
+    void Unlink(int index);
+    void Release(int index);
+    void Cascade(int level);
+    void Tick();
+
+    lua_State *L;
+    std::vector<Entry> entries;
+    std::vector<int> freeEntries;
+    std::vector<Fire> firing;
+    int heads[Levels][Slots];
+    unsigned long long now;
+    double remainder; // fraction of a tick carried to the next frame
+    int count;
+    std::unordered_map<GameObject *, int> owners; // timers per owner, Cancel skips the rest
+};
+
+//*********************************************************************************************************************
+//**                         MessageBus                                                                             **
+//*********************************************************************************************************************
+
+// named channels: a script subscribes, a publish queues the payload once and every queued
+// message is delivered at one point of the frame to that channel's subscribers only, through
+// OnMessage(self, payload, channel); a script with OnMessage is always on the broadcast
+// channel, which sendMessage and sendMessageTo publish to
+class MessageBus
+{
+public:
+    static const char *Broadcast;
+
+    static MessageBus &Instance()
+    {
+        static MessageBus instance;
+        return instance;
+    }
+
+    bool Subscribe(ScriptComponent *script, const std::string &channel);
+    bool Unsubscribe(ScriptComponent *script, const std::string &channel);
+    void Attach(ScriptComponent *script); // broadcast subscription follows OnMessage
+    void Detach(ScriptComponent *script);
+
+    // the value at payload in from; target limits delivery to objects of that name,
+    // a message without target skips its sender
+    void Publish(lua_State *from, int payload, GameObject *sender, const std::string &channel, const std::string &target = "");
+    void Deliver(lua_State *L);
+    void Clear(lua_State *L);
+    int Subscribers(const std::string &channel) const;
+
+private:
+    struct Channel
+    {
+        std::vector<ScriptComponent *> subscribers;
+        bool dirty; // holes left by an unsubscribe during delivery
+    };
+
+    struct Message
+    {
+        Channel *channel;
+        const std::string *name;
+        int payload; // registry ref in the main state
+        GameObject *sender;
+        std::string target;
+    };
+
+    MessageBus() : delivering(false) {}
+    MessageBus(const MessageBus &) = delete;
+    MessageBus &operator=(const MessageBus &) = delete;
+
+    std::unordered_map<std::string, Channel> channels;
+    std::vector<Message> queue;
+    std::vector<Message> sending;
+    bool delivering;
+};
+
+//*********************************************************************************************************************
+//**                         ScriptWorkers                                                                          **
+//*********************************************************************************************************************
+
+class Scene;
+
+// modules exporting isolated = true run in worker lua states, each owning a share of the
+// instances; their update and updateAll run in parallel after the main update and what they
+// ask of the scene is queued, then applied on the main thread once every worker is done
+class ScriptWorkers
+{
+public:
+    struct Command
+    {
+        enum Type
+        {
+            Spawn,
+            Message,
+            MessageTo,
+            Publish,
+            SetAnimation
+        };
+        Type type;
+        GameObject *sender;
+        std::string name; // prefab, receiver, channel or animation
+        float x, y;
+        int layer;
+        int payload; // registry ref in the worker state
+        bool now;    // SetAnimation: switch and play at once
+    };
+
+    struct Worker
+    {
+        lua_State *state;
+        int scripts;
+        std::vector<ScriptComponent *> queue;
+        std::vector<Command> commands;
+        double time; // seconds of the last Run
+    };
+
+    static ScriptWorkers &Instance()
+    {
+        static ScriptWorkers instance;
+        return instance;
+    }
+
+    bool Start(int count);
+    void Stop();
+    int Count() const { return (int)workers.size(); }
+    bool Running() const { return running; }
+    const Worker &Get(int index) const { return workers[index]; }
+    int IndexOf(lua_State *L) const;
+    lua_State *Assign(lua_State *L, const std::string &path);
+    void Release(int index);
+    void Queue(ScriptComponent *script) { workers[script->worker].queue.push_back(script); }
+    void Push(lua_State *L, const Command &command);
+    void Run(float dt);
+    void Apply(Scene *scene);
+    void Reload(const std::string &path);
+    void SetGlobal(const char *name, lua_Integer value); // in every worker state
+
+    static void IsolateMethods(lua_State *L);
+
+private:
+    ScriptWorkers() : delta(0), generation(0), pending(0), running(false), quit(false) {}
+    ~ScriptWorkers() { Stop(); }
+    ScriptWorkers(const ScriptWorkers &) = delete;
+    ScriptWorkers &operator=(const ScriptWorkers &) = delete;
+
+    void Loop(int index);
+    void Execute(Worker &worker);
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads; // threads[i] runs workers[i + 1], the main thread runs workers[0]
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    float delta;
+    unsigned int generation;
+    int pending;
+    bool running;
+    bool quit;
+};
+
 //*********************************************************************************************************************
 //**                         Scene                                                                                   **
 //*********************************************************************************************************************
@@ -984,7 +1658,7 @@ public:
     void addToLayer(GameObject *e);
     int layersCount();
 
-    bool Load(const char *filename);
+    bool Load(const char *filename, bool async = false);
     bool Save(const char *filename);
 
     bool LoadTiled(const char *filename);
@@ -1017,9 +1691,40 @@ public:
         gameObjectsToRemove.push_back(gameObject);
     }
 
+    // killed objects of a pooled name are kept, configured, for the next spawn of that name
+    struct ObjectPool
+    {
+        std::vector<GameObject *> objects;
+        int capacity;
+        int reused;
+        int created;
+        ObjectPool() : capacity(0), reused(0), created(0) {}
+    };
+    std::unordered_map<std::string, ObjectPool> pools;
+
+    void SetPool(const std::string &key, int capacity); // capacity 0 drops the pool
+    GameObject *Spawn(const std::string &name, int layer, bool *reused, const GameObject *prefab = nullptr);
+    bool ReturnToPool(GameObject *gameObject);
+    void FreePools();
+
+    // configured objects cloned by Instantiate, never in the scene themselves
+    std::unordered_map<std::string, GameObject *> prefabs;
+
+    void AddPrefab(const std::string &name, GameObject *gameObject); // takes ownership
+    GameObject *Instantiate(const std::string &name, float x, float y, bool *reused = nullptr);
+    void FreePrefabs();
+
     GameObject *GetGameObjectByName(const std::string &name);
     bool inView(const  Rectangle& r );
 
+    // static layers are rendered once to a texture (view + margin) and drawn as one quad,
+    // redrawn when an object is added, removed or moves; invalidateLayer for anything else
+    void setLayerStatic(int layer, bool enable, float margin);
+    void invalidateLayer(int layer);
+    void UpdateLayerCache();
+    void RenderLayer(int layer);
+    void FreeLayerCache();
+
     void Update();
     void Render();
     void Collision();
@@ -1039,6 +1744,18 @@ public:
     std::map<int, std::vector<GameObject *>> layers;
     int m_num_layers;
 
+    // dirty is set when an object of the layer is added, removed or moves
+    struct LayerCache
+    {
+        bool dirty;
+        bool ready;
+        float margin;
+        float zoom;
+        Rectangle region;
+        RenderTexture2D target;
+    };
+    std::map<int, LayerCache> layerCache;
+
     int numObjectsRemoved;
     bool needSort;
     bool enableLiveReload;
@@ -1047,6 +1764,8 @@ public:
     bool enableEditor;
     bool showStats;
     int objectRender;
+    TextLayout statsText[10];
+    std::vector<TextLayout> layersText;
     
  
     Camera2D camera;
@@ -1056,6 +1775,8 @@ public:
     Timer timer;
     std::time_t lastCheckTime;
     std::time_t checkInterval;
+    std::vector<std::string> changedScripts;
+    int loadCallback; // scene.loadAsync completion, fired once every streamed graph is uploaded
     TransformMode currentMode;
     GameObject *selectedObject;
     Vec2 initialObjectPosition;
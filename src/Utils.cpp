@@ -12,6 +12,19 @@
 
 #include "Utils.hpp"
 #include <raylib.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+#if !defined(_WIN32) && !defined(PLATFORM_ANDROID)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && !defined(PLATFORM_ANDROID)
+#include <sys/inotify.h>
+#endif
 
 void Log(int severity, const char *fmt, ...)
 {
@@ -349,6 +362,42 @@ void RenderNormal(Texture2D texture, float x, float y, int blend)
 
     RenderQuad(&quad);
 }
+void RenderUV(Texture2D texture, float x, float y, float width, float height, float u, float v, float u2, float v2, Color color, int blend)
+{
+
+    rQuad quad;
+    quad.tex = texture;
+    quad.blend = blend;
+
+    float fx2 = x + width;
+    float fy2 = y + height;
+
+    quad.v[1].x = x;
+    quad.v[1].y = y;
+    quad.v[1].tx = u;
+    quad.v[1].ty = v;
+
+    quad.v[0].x = x;
+    quad.v[0].y = fy2;
+    quad.v[0].tx = u;
+    quad.v[0].ty = v2;
+
+    quad.v[3].x = fx2;
+    quad.v[3].y = fy2;
+    quad.v[3].tx = u2;
+    quad.v[3].ty = v2;
+
+    quad.v[2].x = fx2;
+    quad.v[2].y = y;
+    quad.v[2].tx = u2;
+    quad.v[2].ty = v;
+
+    quad.v[0].z = quad.v[1].z = quad.v[2].z = quad.v[3].z = 0.0f;
+    quad.v[0].col = quad.v[1].col = quad.v[2].col = quad.v[3].col = color;
+
+    RenderQuad(&quad);
+}
+
 void RenderTile(Texture2D texture, float x, float y, float width, float height, Rectangle clip, bool flipx, bool flipy, int blend)
 {
 
@@ -1260,72 +1309,663 @@ std::string base64_decode(const std::string &base64_string)
     return ret;
 }
 
-std::string GetPath(const std::string &path)
+//*********************************************************************************************************************
+//**                         VirtualFS                                                                              **
+//*********************************************************************************************************************
+
+static const char *vfsRoots[] = {"assets", "../assets"};
+
+static std::string NormalizePath(const std::string &path)
 {
-    if (FileExists(TextFormat("assets/%s", path.c_str())))
-    {
-        return TextFormat("assets/%s", path.c_str());
-    }else if (FileExists(TextFormat("../assets/%s", path.c_str())))
-    {
-        return TextFormat("../assets/%s", path.c_str());
-    } else if (FileExists(TextFormat("assets/images/%s", path.c_str())))
+    std::string result = path;
+    std::replace(result.begin(), result.end(), '\\', '/');
+    while (result.compare(0, 2, "./") == 0)
+        result.erase(0, 2);
+    return result;
+}
+
+void VirtualFS::ScanDirectory(const std::string &dir, bool recursive)
+{
+    directories.push_back(std::make_pair(dir, GetFileModTime(dir.c_str())));
+
+    FilePathList list = LoadDirectoryFiles(dir.c_str());
+    for (unsigned int i = 0; i < list.count; i++)
     {
-        return TextFormat("assets/images/%s", path.c_str());
-    } else if (FileExists(TextFormat("../assets/images/%s", path.c_str())))
+        std::string path = NormalizePath(list.paths[i]);
+        // one stat gives the kind and the size, no file is opened while indexing
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            continue;
+        if ((info.st_mode & S_IFMT) == S_IFREG)
+        {
+            if (files.find(path) == files.end())
+            {
+                Entry entry;
+                entry.path = path;
+                entry.size = (int)info.st_size;
+                files[path] = entry;
+            }
+        }
+        else if ((info.st_mode & S_IFMT) == S_IFDIR && recursive)
+        {
+            ScanDirectory(path, true);
+        }
+    }
+    UnloadDirectoryFiles(list);
+}
+
+void VirtualFS::Scan()
+{
+    double start = GetTime();
+    files.clear();
+    directories.clear();
+    scanned = true;
+
+    // working directory files only, the asset trees in full
+    ScanDirectory(".", false);
+    for (const char *root : vfsRoots)
     {
-        return TextFormat("../assets/images/%s", path.c_str());
-    } else if (FileExists(TextFormat("assets/textures/%s", path.c_str())))
+        if (DirectoryExists(root))
+            ScanDirectory(root, true);
+        else
+            directories.push_back(std::make_pair(std::string(root), 0L));
+    }
+
+    Log(LOG_INFO, "VFS indexed %d files in %d directories (%.2f ms)", (int)files.size(), (int)directories.size(), (GetTime() - start) * 1000.0);
+}
+
+bool VirtualFS::Refresh()
+{
+    if (!scanned)
     {
-        return TextFormat("assets/textures/%s", path.c_str());
+        Scan();
+        return true;
     }
-    else if (FileExists(TextFormat("../assets/textures/%s", path.c_str())))
+    for (auto &dir : directories)
     {
-        return TextFormat("../assets/textures/%s", path.c_str());
+        if (GetFileModTime(dir.first.c_str()) != dir.second)
+        {
+            Log(LOG_INFO, "VFS %s changed, rescanning", dir.first.c_str());
+            Scan();
+            return true;
+        }
     }
-    else if (FileExists(TextFormat("assets/sounds/%s", path.c_str())))
+    return false;
+}
+
+bool VirtualFS::Indexed(const std::string &path) const
+{
+    if (path.find('/') == std::string::npos)
+        return true;
+    for (const char *root : vfsRoots)
     {
-        return TextFormat("assets/sounds/%s", path.c_str());
-    }else if (FileExists(TextFormat("../assets/sounds/%s", path.c_str())))
+        size_t len = strlen(root);
+        if (path.compare(0, len, root) == 0 && path.size() > len && path[len] == '/')
+            return true;
+    }
+    return false;
+}
+
+bool VirtualFS::Exists(const std::string &path)
+{
+    if (AssetPack::Instance().Find(path) != nullptr)
+        return true;
+#if defined(PLATFORM_ANDROID)
+    return FileExists(path.c_str());
+#else
+    if (!scanned)
+        Scan();
+    std::string key = NormalizePath(path);
+    if (files.find(key) != files.end())
+        return true;
+    if (Indexed(key))
+        return false;
+    return FileExists(path.c_str());
+#endif
+}
+
+int VirtualFS::FileSize(const std::string &path)
+{
+    const AssetPack::Entry *entry = AssetPack::Instance().Find(path);
+    if (entry != nullptr)
+        return (int)entry->size;
+    if (!scanned)
+        Scan();
+    auto it = files.find(NormalizePath(path));
+    if (it != files.end())
+        return it->second.size;
+    return FileExists(path.c_str()) ? GetFileLength(path.c_str()) : 0;
+}
+
+std::string VirtualFS::Resolve(const std::string &name, const char *const *patterns, int count)
+{
+    for (int i = 0; i < count; i++)
     {
-        return TextFormat("../assets/sounds/%s", path.c_str());
+        std::string path = patterns[i];
+        size_t pos = path.find("%s");
+        if (pos != std::string::npos)
+            path.replace(pos, 2, name);
+        if (Exists(path))
+            return path;
     }
-    return path;
+    return std::string();
+}
+
+static const char *assetPatterns[] = {"assets/%s", "../assets/%s", "assets/images/%s", "../assets/images/%s",
+                                      "assets/textures/%s", "../assets/textures/%s", "assets/sounds/%s", "../assets/sounds/%s"};
+
+std::string GetPath(const std::string &path)
+{
+    std::string result = VirtualFS::Instance().Resolve(path, assetPatterns, 8);
+    if (result.empty())
+        return path;
+    return result;
 }
+
 bool FileInPath(const std::string &path)
 {
-    
-    if (FileExists(path.c_str()))
+    if (VirtualFS::Instance().Exists(path))
+        return true;
+    return !VirtualFS::Instance().Resolve(path, assetPatterns, 8).empty();
+}
+
+static bool GetImageSize(const unsigned char *h, size_t count, bool tga, int *width, int *height)
+{
+    if (count >= 24 && h[0] == 0x89 && h[1] == 'P' && h[2] == 'N' && h[3] == 'G')
     {
+        *width = (h[16] << 24) | (h[17] << 16) | (h[18] << 8) | h[19];
+        *height = (h[20] << 24) | (h[21] << 16) | (h[22] << 8) | h[23];
         return true;
     }
-    else if (FileExists(TextFormat("assets/%s", path.c_str())))
+    if (count >= 14 && h[0] == 'q' && h[1] == 'o' && h[2] == 'i' && h[3] == 'f')
     {
+        *width = (h[4] << 24) | (h[5] << 16) | (h[6] << 8) | h[7];
+        *height = (h[8] << 24) | (h[9] << 16) | (h[10] << 8) | h[11];
         return true;
-    }else if (FileExists(TextFormat("../assets/%s", path.c_str())))
+    }
+    if (count >= 26 && h[0] == 'B' && h[1] == 'M')
     {
+        *width = h[18] | (h[19] << 8) | (h[20] << 16) | (h[21] << 24);
+        *height = abs(h[22] | (h[23] << 8) | (h[24] << 16) | (h[25] << 24));
         return true;
-    } else if (FileExists(TextFormat("assets/images/%s", path.c_str())))
+    }
+    if (count >= 4 && h[0] == 0xFF && h[1] == 0xD8)
     {
-        return true;
-    } else if (FileExists(TextFormat("../assets/images/%s", path.c_str())))
+        // walk the segments until the start of frame marker
+        size_t offset = 2;
+        while (offset + 9 <= count && h[offset] == 0xFF)
+        {
+            unsigned char marker = h[offset + 1];
+            int length = (h[offset + 2] << 8) | h[offset + 3];
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            {
+                *height = (h[offset + 5] << 8) | h[offset + 6];
+                *width = (h[offset + 7] << 8) | h[offset + 8];
+                return true;
+            }
+            offset += 2 + length;
+        }
+        return false;
+    }
+    if (count >= 18 && tga)
     {
+        *width = h[12] | (h[13] << 8);
+        *height = h[14] | (h[15] << 8);
         return true;
-    } else if (FileExists(TextFormat("assets/textures/%s", path.c_str())))
+    }
+    return false;
+}
+
+// reads only the file header, used to size a texture before it is decoded
+bool GetImageFileSize(const char *fileName, int *width, int *height)
+{
+    bool tga = IsFileExtension(fileName, ".tga");
+    const AssetPack::Entry *entry = AssetPack::Instance().Find(fileName);
+    if (entry != nullptr)
     {
-        return true;
+        if (entry->type == AssetPack::PackImage)
+        {
+            *width = (int)entry->width;
+            *height = (int)entry->height;
+            return true;
+        }
+        return GetImageSize(AssetPack::Instance().Data(entry), (size_t)entry->size, tga, width, height);
     }
-    else if (FileExists(TextFormat("../assets/textures/%s", path.c_str())))
+
+    FILE *file = fopen(fileName, "rb");
+    if (file == nullptr)
+        return false;
+
+    // large enough for the jpeg segments that come before the frame header
+    std::vector<unsigned char> header(64 * 1024);
+    size_t count = fread(header.data(), 1, header.size(), file);
+    fclose(file);
+    return GetImageSize(header.data(), count, tga, width, height);
+}
+
+//*********************************************************************************************************************
+//**                         AssetPack                                                                              **
+//*********************************************************************************************************************
+
+bool AssetPack::Open(const char *fileName)
+{
+    Close();
+
+#if defined(_WIN32) || defined(PLATFORM_ANDROID)
+    // no mmap here, the pack is read in one go
+    unsigned int bytesRead = 0;
+    base = LoadFileData(fileName, &bytesRead);
+    size = (size_t)bytesRead;
+    mapped = false;
+    if (base == nullptr)
+        return false;
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header))
     {
-        return true;
+        close(fd);
+        return false;
     }
-    else if (FileExists(TextFormat("assets/sounds/%s", path.c_str())))
+    void *map = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    base = (unsigned char *)map;
+    size = (size_t)info.st_size;
+    mapped = true;
+#endif
+
+    Header header;
+    memcpy(&header, base, sizeof(Header));
+    if (memcmp(header.magic, "UPAK", 4) != 0 || header.version != Version ||
+        header.indexOffset + (unsigned long long)header.count * sizeof(Record) > size ||
+        header.namesOffset + header.namesSize > size)
     {
-        return true;
-    }else if (FileExists(TextFormat("../assets/sounds/%s", path.c_str())))
+        Log(LOG_ERROR, "Invalid asset pack %s", fileName);
+        Close();
+        return false;
+    }
+
+    const Record *records = (const Record *)(base + header.indexOffset);
+    const char *names = (const char *)(base + header.namesOffset);
+    entries.reserve(header.count);
+    for (unsigned int i = 0; i < header.count; i++)
     {
-        return true;
+        const Record &record = records[i];
+        if (record.offset + record.size > size || record.nameOffset + record.nameLength > header.namesSize)
+        {
+            Log(LOG_ERROR, "Asset pack %s has a broken entry %d", fileName, i);
+            continue;
+        }
+        Entry entry;
+        entry.type = record.type;
+        entry.width = record.width;
+        entry.height = record.height;
+        entry.format = record.format;
+        entry.offset = record.offset;
+        entry.size = record.size;
+        entries[std::string(names + record.nameOffset, record.nameLength)] = entry;
     }
-    
-    
-    return false;
-}
\ No newline at end of file
+
+    this->fileName = fileName;
+    Log(LOG_INFO, "Asset pack %s mounted, %d entries (%.2f MB)", fileName, (int)entries.size(), size / (1024.0f * 1024.0f));
+    return true;
+}
+
+void AssetPack::Close()
+{
+    if (base != nullptr)
+    {
+#if defined(_WIN32) || defined(PLATFORM_ANDROID)
+        UnloadFileData(base);
+#else
+        if (mapped)
+            munmap(base, size);
+#endif
+    }
+    base = nullptr;
+    size = 0;
+    mapped = false;
+    entries.clear();
+    fileName.clear();
+}
+
+const AssetPack::Entry *AssetPack::Find(const std::string &path) const
+{
+    if (base == nullptr)
+        return nullptr;
+    std::string key = path;
+    std::replace(key.begin(), key.end(), '\\', '/');
+    while (key.compare(0, 2, "./") == 0)
+        key.erase(0, 2);
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return nullptr;
+    return &it->second;
+}
+
+bool AssetPack::Owns(const void *ptr) const
+{
+    const unsigned char *p = (const unsigned char *)ptr;
+    return base != nullptr && p >= base && p < base + size;
+}
+
+//*********************************************************************************************************************
+//**                         FileWatcher                                                                            **
+//*********************************************************************************************************************
+
+long FileWatcher::Watch(const std::string &path)
+{
+    auto it = files.find(path);
+    if (it != files.end())
+        return it->second;
+
+    long time = GetFileModTime(path.c_str());
+    files[path] = time;
+
+#if defined(__linux__) && !defined(PLATFORM_ANDROID)
+    if (!started)
+    {
+        started = true;
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            Log(LOG_WARNING, "inotify not available, script changes are polled");
+    }
+    if (fd >= 0)
+    {
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+        if (directoryWatch.find(dir) == directoryWatch.end())
+        {
+            int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0)
+                directories[wd] = dir;
+            directoryWatch[dir] = wd;
+        }
+    }
+#endif
+    return time;
+}
+
+bool FileWatcher::Poll(std::vector<std::string> &changed, double interval)
+{
+    size_t count = changed.size();
+
+#if defined(__linux__) && !defined(PLATFORM_ANDROID)
+    if (fd >= 0)
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        for (;;)
+        {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+            for (char *p = buffer; p < buffer + length;)
+            {
+                struct inotify_event *event = (struct inotify_event *)p;
+                p += sizeof(struct inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+                auto dir = directories.find(event->wd);
+                if (dir == directories.end())
+                    continue;
+                std::string path = dir->second == "." ? std::string(event->name) : dir->second + "/" + event->name;
+                auto file = files.find(path);
+                if (file == files.end())
+                    continue;
+                file->second = GetFileModTime(path.c_str());
+                if (std::find(changed.begin() + count, changed.end(), path) == changed.end())
+                    changed.push_back(path);
+            }
+        }
+        return changed.size() > count;
+    }
+#endif
+
+    double now = GetTime();
+    if (now - lastPoll < interval)
+        return false;
+    lastPoll = now;
+    for (auto &file : files)
+    {
+        long time = GetFileModTime(file.first.c_str());
+        if (time > file.second)
+        {
+            file.second = time;
+            changed.push_back(file.first);
+        }
+    }
+    return changed.size() > count;
+}
+
+void FileWatcher::Close()
+{
+#if defined(__linux__) && !defined(PLATFORM_ANDROID)
+    if (fd >= 0)
+        close(fd);
+#endif
+    fd = -1;
+    started = false;
+    files.clear();
+    directories.clear();
+    directoryWatch.clear();
+}
+
+// blobs in the pack are followed by a zero byte, so text is served straight from the mapping
+char *LoadAssetText(const char *fileName)
+{
+    const AssetPack::Entry *entry = AssetPack::Instance().Find(fileName);
+    if (entry != nullptr && entry->type == AssetPack::PackFile)
+        return (char *)AssetPack::Instance().Data(entry);
+    return LoadFileText(fileName);
+}
+
+void UnloadAssetText(char *text)
+{
+    if (text != nullptr && !AssetPack::Instance().Owns(text))
+        UnloadFileText(text);
+}
+
+unsigned char *LoadAssetData(const char *fileName, unsigned int *bytesRead)
+{
+    const AssetPack::Entry *entry = AssetPack::Instance().Find(fileName);
+    if (entry != nullptr && entry->type != AssetPack::PackImage)
+    {
+        *bytesRead = (unsigned int)entry->size;
+        return (unsigned char *)AssetPack::Instance().Data(entry);
+    }
+    return LoadFileData(fileName, bytesRead);
+}
+
+void UnloadAssetData(unsigned char *data)
+{
+    if (data != nullptr && !AssetPack::Instance().Owns(data))
+        UnloadFileData(data);
+}
+
+Image LoadAssetImage(const char *fileName)
+{
+    const AssetPack::Entry *entry = AssetPack::Instance().Find(fileName);
+    if (entry == nullptr)
+        return LoadImage(fileName);
+
+    if (entry->type == AssetPack::PackImage)
+    {
+        Image image;
+        image.data = (void *)AssetPack::Instance().Data(entry);
+        image.width = (int)entry->width;
+        image.height = (int)entry->height;
+        image.mipmaps = 1;
+        image.format = (int)entry->format;
+        return image;
+    }
+    return LoadImageFromMemory(GetFileExtension(fileName), AssetPack::Instance().Data(entry), (int)entry->size);
+}
+
+void UnloadAssetImage(Image image)
+{
+    if (image.data != nullptr && !AssetPack::Instance().Owns(image.data))
+        UnloadImage(image);
+}
+
+//*********************************************************************************************************************
+//**                         BlockAllocator                                                                         **
+//*********************************************************************************************************************
+
+static const size_t blockClassSizes[BlockAllocator::ClassCount] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+BlockAllocator::BlockAllocator()
+    : live(0), peak(0), large(0), frameBytes(0), frameCount(0), lastFrameBytes(0), lastFrameCount(0), pages(0)
+{
+    for (int i = 0; i < ClassCount; i++)
+        freeLists[i] = nullptr;
+}
+
+BlockAllocator::~BlockAllocator()
+{
+    Release();
+}
+
+int BlockAllocator::ClassOf(size_t size)
+{
+    // size in 16 byte units -> smallest class that fits
+    static int table[MaxBlock / 16 + 1];
+    static bool ready = false;
+    if (!ready)
+    {
+        int sizeClass = 0;
+        for (size_t units = 0; units <= MaxBlock / 16; units++)
+        {
+            while (blockClassSizes[sizeClass] < units * 16)
+                sizeClass++;
+            table[units] = sizeClass;
+        }
+        ready = true;
+    }
+    return table[(size + 15) / 16];
+}
+
+bool BlockAllocator::Refill(int sizeClass)
+{
+    unsigned char *page = (unsigned char *)malloc(PageSize);
+    if (page == nullptr)
+        return false;
+    pageList.push_back(page);
+    pages++;
+
+    size_t blockSize = blockClassSizes[sizeClass];
+    size_t count = PageSize / blockSize;
+    for (size_t i = 0; i < count; i++)
+    {
+        FreeBlock *block = (FreeBlock *)(page + i * blockSize);
+        block->next = freeLists[sizeClass];
+        freeLists[sizeClass] = block;
+    }
+    return true;
+}
+
+void *BlockAllocator::Allocate(size_t size)
+{
+    void *ptr = nullptr;
+    if (size > MaxBlock)
+    {
+        ptr = malloc(size);
+        if (ptr == nullptr)
+            return nullptr;
+        large += size;
+    }
+    else
+    {
+        int sizeClass = ClassOf(size);
+        if (freeLists[sizeClass] == nullptr && !Refill(sizeClass))
+            return nullptr;
+        FreeBlock *block = freeLists[sizeClass];
+        freeLists[sizeClass] = block->next;
+        ptr = block;
+    }
+
+    live += size;
+    if (live > peak)
+        peak = live;
+    frameBytes += size;
+    frameCount++;
+    return ptr;
+}
+
+void BlockAllocator::Free(void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+    live -= size;
+    if (size > MaxBlock)
+    {
+        large -= size;
+        free(ptr);
+        return;
+    }
+    int sizeClass = ClassOf(size);
+    FreeBlock *block = (FreeBlock *)ptr;
+    block->next = freeLists[sizeClass];
+    freeLists[sizeClass] = block;
+}
+
+void *BlockAllocator::Reallocate(void *ptr, size_t oldSize, size_t newSize)
+{
+    if (ptr == nullptr)
+        return Allocate(newSize);
+
+    if (oldSize > MaxBlock && newSize > MaxBlock)
+    {
+        void *block = realloc(ptr, newSize);
+        if (block == nullptr)
+            return nullptr;
+        live = live - oldSize + newSize;
+        large = large - oldSize + newSize;
+        if (live > peak)
+            peak = live;
+        if (newSize > oldSize)
+            frameBytes += newSize - oldSize;
+        frameCount++;
+        return block;
+    }
+
+    if (oldSize <= MaxBlock && newSize <= MaxBlock && ClassOf(oldSize) == ClassOf(newSize))
+    {
+        // same block, only the accounting moves
+        live = live - oldSize + newSize;
+        if (live > peak)
+            peak = live;
+        return ptr;
+    }
+
+    void *block = Allocate(newSize);
+    if (block == nullptr)
+        return nullptr;
+    memcpy(block, ptr, oldSize < newSize ? oldSize : newSize);
+    Free(ptr, oldSize);
+    return block;
+}
+
+void BlockAllocator::BeginFrame()
+{
+    lastFrameBytes = frameBytes;
+    lastFrameCount = frameCount;
+    frameBytes = 0;
+    frameCount = 0;
+}
+
+void BlockAllocator::Release()
+{
+    if (live != large)
+        Log(LOG_WARNING, "BlockAllocator released with %d bytes still pooled", (int)(live - large));
+    for (void *page : pageList)
+        free(page);
+    pageList.clear();
+    pages = 0;
+    for (int i = 0; i < ClassCount; i++)
+        freeLists[i] = nullptr;
+    live = large;
+}
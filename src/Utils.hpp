@@ -16,6 +16,8 @@
 #include <math.h>
 #include <string>
 #include <random>
+#include <vector>
+#include <unordered_map>
 
 
 #define CONSOLE_COLOR_RESET "\033[0m"
@@ -218,6 +220,8 @@ void RenderTransformFlipClip(Texture2D texture, int width, int height, Rectangle
 void RenderQuad(const rQuad *quad);
 void RenderNormal(Texture2D texture, float x, float y, int blend);
 void RenderTile(Texture2D texture, float x, float y, float width, float height, Rectangle clip, bool flipx, bool flipy, int blend);
+// uvs outside 0..1 repeat when the texture wrap is TEXTURE_WRAP_REPEAT
+void RenderUV(Texture2D texture, float x, float y, float width, float height, float u, float v, float u2, float v2, Color color, int blend);
 
 void Random_Seed(const int seed);
 int Random_Int(const int min, const int max);
@@ -249,5 +253,221 @@ float memoryIn(size_t bytes);
 
 std::string base64_decode(const std::string &base64_string) ;
 
+//*********************************************************************************************************************
+//**                         VirtualFS                                                                              **
+//*********************************************************************************************************************
+
+// the asset roots are scanned once into a hash index, lookups never touch the disk,
+// paths outside the roots fall back to FileExists
+class VirtualFS
+{
+public:
+    struct Entry
+    {
+        std::string path;
+        int size;
+    };
+
+    static VirtualFS &Instance()
+    {
+        static VirtualFS instance;
+        return instance;
+    }
+
+    void Scan();
+    bool Refresh();
+    bool Exists(const std::string &path);
+    int FileSize(const std::string &path);
+    // first pattern ("%s" is replaced by name) that exists, empty if none
+    std::string Resolve(const std::string &name, const char *const *patterns, int count);
+    int Count() const { return (int)files.size(); }
+
+private:
+    VirtualFS() : scanned(false) {}
+    VirtualFS(const VirtualFS &) = delete;
+    VirtualFS &operator=(const VirtualFS &) = delete;
+
+    void ScanDirectory(const std::string &dir, bool recursive);
+    bool Indexed(const std::string &path) const;
+
+    bool scanned;
+    std::unordered_map<std::string, Entry> files;
+    std::vector<std::pair<std::string, long>> directories;
+};
+
+//*********************************************************************************************************************
+//**                         AssetPack                                                                              **
+//*********************************************************************************************************************
+
+// single file asset pack built by tools/pack.cpp, mapped read only and served without copies
+// layout: Header, blobs (16 byte aligned, each followed by a zero byte), Record[count], names
+class AssetPack
+{
+public:
+    enum Type
+    {
+        PackFile = 0,     // file bytes as they are on disk
+        PackImage = 1,    // decoded pixels, width/height/format set
+        PackBytecode = 2, // precompiled lua chunk
+    };
+
+    static const unsigned int Version = 1;
+    static const unsigned int Alignment = 16;
+
+    struct Header
+    {
+        char magic[4]; // "UPAK"
+        unsigned int version;
+        unsigned int count;
+        unsigned int namesSize;
+        unsigned long long indexOffset;
+        unsigned long long namesOffset;
+    };
+
+    struct Record
+    {
+        unsigned long long offset;
+        unsigned long long size;
+        unsigned int nameOffset;
+        unsigned int nameLength;
+        unsigned int type;
+        unsigned int width;
+        unsigned int height;
+        unsigned int format;
+    };
+
+    struct Entry
+    {
+        unsigned int type;
+        unsigned int width;
+        unsigned int height;
+        unsigned int format;
+        unsigned long long offset;
+        unsigned long long size;
+    };
+
+    static AssetPack &Instance()
+    {
+        static AssetPack instance;
+        return instance;
+    }
+
+    bool Open(const char *fileName);
+    void Close();
+    bool IsOpen() const { return base != nullptr; }
+    const Entry *Find(const std::string &path) const;
+    const unsigned char *Data(const Entry *entry) const { return base + entry->offset; }
+    bool Owns(const void *ptr) const;
+
+private:
+    AssetPack() : base(nullptr), size(0), mapped(false) {}
+    ~AssetPack() { Close(); }
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    unsigned char *base;
+    size_t size;
+    bool mapped;
+    std::string fileName;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+//*********************************************************************************************************************
+//**                         FileWatcher                                                                            **
+//*********************************************************************************************************************
+
+// each path is watched once; inotify on the parent directory (editors save by rename),
+// mod time polling where inotify is not available
+class FileWatcher
+{
+public:
+    static FileWatcher &Instance()
+    {
+        static FileWatcher instance;
+        return instance;
+    }
+
+    // returns the mod time known for the path
+    long Watch(const std::string &path);
+    // appends every changed path once, false when nothing changed
+    bool Poll(std::vector<std::string> &changed, double interval);
+    void Close();
+    int Count() const { return (int)files.size(); }
+    bool IsNotify() const { return fd >= 0; }
+
+private:
+    FileWatcher() : fd(-1), started(false), lastPoll(0) {}
+    ~FileWatcher() { Close(); }
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    int fd;
+    bool started;
+    double lastPoll;
+    std::unordered_map<std::string, long> files;
+    std::unordered_map<int, std::string> directories;
+    std::unordered_map<std::string, int> directoryWatch;
+};
+
+//*********************************************************************************************************************
+//**                         BlockAllocator                                                                         **
+//*********************************************************************************************************************
+
+// small blocks come from size class pools (free lists carved out of 64KB slab pages),
+// anything above MaxBlock from malloc; the caller passes the size back on free and
+// realloc, as lua_Alloc does, so blocks carry no header
+class BlockAllocator
+{
+public:
+    static const size_t MaxBlock = 512;
+    static const size_t PageSize = 64 * 1024;
+    static const int ClassCount = 10;
+
+    BlockAllocator();
+    ~BlockAllocator();
+
+    void *Allocate(size_t size);
+    void Free(void *ptr, size_t size);
+    void *Reallocate(void *ptr, size_t oldSize, size_t newSize);
+
+    // closes the per frame counters
+    void BeginFrame();
+    // returns every page to the system, only valid once nothing is live
+    void Release();
+
+    size_t live;  // bytes requested and not freed
+    size_t peak;
+    size_t large; // live bytes served by malloc
+    size_t frameBytes;
+    size_t frameCount;
+    size_t lastFrameBytes;
+    size_t lastFrameCount;
+    int pages;
+
+private:
+    BlockAllocator(const BlockAllocator &) = delete;
+    BlockAllocator &operator=(const BlockAllocator &) = delete;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static int ClassOf(size_t size);
+    bool Refill(int sizeClass);
+
+    FreeBlock *freeLists[ClassCount];
+    std::vector<void *> pageList;
+};
+
+// pack first, loose files otherwise; always release with the matching Unload
+char *LoadAssetText(const char *fileName);
+void UnloadAssetText(char *text);
+unsigned char *LoadAssetData(const char *fileName, unsigned int *bytesRead);
+void UnloadAssetData(unsigned char *data);
+Image LoadAssetImage(const char *fileName);
+void UnloadAssetImage(Image image);
+
 std::string GetPath(const std::string &path);
-bool FileInPath(const std::string &path);
\ No newline at end of file
+bool FileInPath(const std::string &path);
+bool GetImageFileSize(const char *fileName, int *width, int *height);
\ No newline at end of file
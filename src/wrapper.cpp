@@ -141,7 +141,14 @@ namespace nScene
         {
             layer = luaL_checkinteger(L, 2);
         }
-        GameObject *obj = new GameObject(name, layer);
+        // a pooled name may hand back a killed object that is already set up,
+        // the second result tells the script to skip addSprite/addScript
+        bool reused = false;
+        GameObject *obj = nullptr;
+        if (lua_isuserdata(L, 6))
+            obj = new GameObject(name, layer);
+        else
+            obj = scene.Spawn(name, layer, &reused);
         if (lua_gettop(L) >= 4)
         {
             x = luaL_checknumber(L, 3);
@@ -166,11 +173,9 @@ namespace nScene
 
         if (lua_gettop(L) >= 6)
         {
-            if (lua_istable(L, 6))
+            if (lua_isuserdata(L, 6))
             {
-                lua_getfield(L, 6, "gameObject");
-                GameObject *parent = static_cast<GameObject *>(lua_touserdata(L, -1));
-                lua_pop(L, 6);
+                GameObject *parent = GameObject::FromLua(L, 6);
 
                 if (parent != nullptr)
                 {
@@ -185,12 +190,83 @@ namespace nScene
         }
 
         // obj->prefab = true;
-        obj->BindLua(L);
+        if (reused)
+            lua_rawgeti(L, LUA_REGISTRYINDEX, obj->table_ref);
+        else
+            obj->BindLua(L);
         if (!isChild && add2Scene)
         {
             scene.AddQueueObject(obj);
         }
 
+        lua_pushboolean(L, reused);
+        return 2;
+    }
+
+    // obj is configured like any other object but created outside the scene
+    // (createGameObject with add = false); the scene owns it from now on
+    static int RegisterPrefab(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        GameObject *gameObject = GameObject::FromLua(L, 2);
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[registerPrefab] expected gameObject");
+        }
+        if (gameObject->scene != nullptr || gameObject->parent != nullptr)
+        {
+            return luaL_error(L, "[registerPrefab] %s is in the scene or has a parent", gameObject->name.c_str());
+        }
+        scene.AddPrefab(name, gameObject);
+        return 0;
+    }
+
+    static int Instantiate(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        float x = (float)luaL_optnumber(L, 2, 0);
+        float y = (float)luaL_optnumber(L, 3, 0);
+        GameObject *gameObject = scene.Instantiate(name, x, y);
+        if (gameObject == nullptr)
+        {
+            return luaL_error(L, "[instantiate] unknown prefab %s", name);
+        }
+        // still queued, the layer is only used when it enters the scene
+        if (lua_gettop(L) >= 4)
+            gameObject->layer = (int)luaL_checkinteger(L, 4);
+        if (gameObject->table_ref == LUA_NOREF)
+            gameObject->BindLua(L);
+        else
+            lua_rawgeti(L, LUA_REGISTRYINDEX, gameObject->table_ref);
+        return 1;
+    }
+
+    static int SetPool(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        int capacity = (int)luaL_checkinteger(L, 2);
+        scene.SetPool(name, capacity);
+        return 0;
+    }
+
+    static int PoolStats(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        auto it = scene.pools.find(name);
+        if (it == scene.pools.end())
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)it->second.objects.size());
+        lua_setfield(L, -2, "free");
+        lua_pushinteger(L, it->second.capacity);
+        lua_setfield(L, -2, "capacity");
+        lua_pushinteger(L, it->second.reused);
+        lua_setfield(L, -2, "reused");
+        lua_pushinteger(L, it->second.created);
+        lua_setfield(L, -2, "created");
         return 1;
     }
 
@@ -198,11 +274,9 @@ namespace nScene
     {
         GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
@@ -214,7 +288,7 @@ namespace nScene
         }
         else
         {
-            return luaL_error(L, "add Invalid argument type, expected table");
+            return luaL_error(L, "add Invalid argument type, expected gameObject");
         }
 
         lua_pushboolean(L, 0);
@@ -259,11 +333,9 @@ namespace nScene
     {
         GameObject *gameObject = nullptr;
 
-        if (lua_istable(L, 1))
+        if (lua_isuserdata(L, 1))
         {
-            lua_getfield(L, 1, "gameObject");
-            gameObject = static_cast<GameObject *>(lua_touserdata(L, -1));
-            lua_pop(L, 1);
+            gameObject = GameObject::FromLua(L, 1);
 
             if (gameObject == nullptr)
             {
@@ -275,7 +347,7 @@ namespace nScene
         }
         else
         {
-            return luaL_error(L, "remove Invalid argument type, expected table");
+            return luaL_error(L, "remove Invalid argument type, expected gameObject");
         }
 
         lua_pushboolean(L, 0);
@@ -289,6 +361,24 @@ namespace nScene
         return 0;
     }
 
+    int LoadSceneAsync(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        if (scene.loadCallback != LUA_NOREF)
+        {
+            luaL_unref(L, LUA_REGISTRYINDEX, scene.loadCallback);
+            scene.loadCallback = LUA_NOREF;
+        }
+        bool ok = scene.Load(name, true);
+        if (ok && lua_isfunction(L, 2))
+        {
+            lua_pushvalue(L, 2);
+            scene.loadCallback = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        lua_pushboolean(L, ok);
+        return 1;
+    }
+
     int SaveScene(lua_State *L)
     {
         const char *name = luaL_checkstring(L, 1);
@@ -471,6 +561,31 @@ namespace nScene
         return 0;
     }
 
+    int SetLayerStatic(lua_State *L)
+    {
+        if (lua_gettop(L) < 2)
+        {
+            return luaL_error(L, "setLayerStatic function requires 2/3 arguments (layer, static, margin)");
+        }
+        int layer = luaL_checkinteger(L, 1);
+        bool enable = lua_toboolean(L, 2);
+        float margin = 64;
+        if (lua_gettop(L) >= 3)
+            margin = luaL_checknumber(L, 3);
+        scene.setLayerStatic(layer, enable, margin);
+        return 0;
+    }
+
+    int InvalidateLayer(lua_State *L)
+    {
+        if (lua_gettop(L) != 1)
+        {
+            return luaL_error(L, "invalidateLayer function requires 1 argument");
+        }
+        scene.invalidateLayer(luaL_checkinteger(L, 1));
+        return 0;
+    }
+
     int SetState(lua_State *L)
     {
         if (lua_gettop(L) != 2)
@@ -515,7 +630,12 @@ namespace nScene
 
         LuaPushClassFuntion(L, "scene", "findGameObject", GetGameObjectByName);
         LuaPushClassFuntion(L, "scene", "createGameObject", CreateGameObject);
+        LuaPushClassFuntion(L, "scene", "registerPrefab", RegisterPrefab);
+        LuaPushClassFuntion(L, "scene", "instantiate", Instantiate);
+        LuaPushClassFuntion(L, "scene", "setPool", SetPool);
+        LuaPushClassFuntion(L, "scene", "poolStats", PoolStats);
         LuaPushClassFuntion(L, "scene", "load", LoadScene);
+        LuaPushClassFuntion(L, "scene", "loadAsync", LoadSceneAsync);
         LuaPushClassFuntion(L, "scene", "save", SaveScene);
         LuaPushClassFuntion(L, "scene", "loadTiles", LoadTiled);
         LuaPushClassFuntion(L, "scene", "clear", ClearScene);
@@ -526,6 +646,8 @@ namespace nScene
         LuaPushClassFuntion(L, "scene", "rectanglePick", RectanglePick);
         LuaPushClassFuntion(L, "scene", "circlePick", CirclePick);
         LuaPushClassFuntion(L, "scene", "setState", SetState);
+        LuaPushClassFuntion(L, "scene", "setLayerStatic", SetLayerStatic);
+        LuaPushClassFuntion(L, "scene", "invalidateLayer", InvalidateLayer);
 
         LuaPushClassFuntion(L, "scene", "setCamera", SetCamera);
         LuaPushClassFuntion(L, "scene", "setCameraPosition", SetCameraPosition);
@@ -1242,17 +1364,97 @@ namespace nCanvas
         return 0;
     }
 
+    // one layout per x, y, size and text, so strings drawn at the same place each keep theirs;
+    // a new text takes the layout its place had last frame, a hud line only relayouts what changed.
+    // dropped when text keeps moving to new places
+    const size_t MAX_TEXT_CACHE = 256;
+    struct CachedText
+    {
+        TextLayout *layout;
+        unsigned long long place;
+        unsigned long long frame; // last frame it was drawn
+    };
+    std::unordered_map<unsigned long long, CachedText> textCache;
+    std::unordered_map<unsigned long long, unsigned long long> textPlaces; // place -> key last drawn there
+    unsigned long long textFrame = 0;
+
+    void ClearTextCache()
+    {
+        for (auto &it : textCache)
+        {
+            delete it.second.layout;
+        }
+        textCache.clear();
+        textPlaces.clear();
+    }
+
+    void BeginFrame()
+    {
+        textFrame++;
+    }
+
+    static unsigned long long textHash(const char *string)
+    {
+        unsigned long long hash = 14695981039346656037ULL;
+        for (const char *c = string; *c != '\0'; c++)
+            hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+        return hash;
+    }
+
     static int drawText(lua_State *L)
     {
         if (lua_gettop(L) < 4)
         {
             return luaL_error(L, "drawText function requires 4 arguments");
         }
-        char *string = (char *)lua_tostring(L, 1);
+        const char *string = lua_tostring(L, 1);
         int x = lua_tointeger(L, 2);
         int y = lua_tointeger(L, 3);
         int s = lua_tointeger(L, 4);
-        DrawText(string, x, y, s, color);
+        if (string == nullptr)
+            return 0;
+
+        unsigned long long place = ((unsigned long long)(unsigned int)x << 32) ^ ((unsigned long long)(unsigned short)y << 16) ^ (unsigned short)s;
+        unsigned long long key = place ^ textHash(string);
+        auto it = textCache.find(key);
+        if (it == textCache.end() || it->second.place != place)
+        {
+            if (it != textCache.end())
+            {
+                // two places whose key collides, the newer one wins
+                delete it->second.layout;
+                textCache.erase(it);
+            }
+            TextLayout *layout = nullptr;
+            auto last = textPlaces.find(place);
+            if (last != textPlaces.end())
+            {
+                auto previous = textCache.find(last->second);
+                if (previous != textCache.end() && previous->second.frame != textFrame)
+                {
+                    layout = previous->second.layout;
+                    textCache.erase(previous);
+                }
+            }
+            if (layout == nullptr)
+            {
+                if (textCache.size() >= MAX_TEXT_CACHE)
+                    ClearTextCache();
+                layout = new TextLayout();
+                layout->SetSize(s);
+            }
+            CachedText entry;
+            entry.layout = layout;
+            entry.place = place;
+            entry.frame = textFrame;
+            it = textCache.emplace(key, entry).first;
+        }
+        it->second.frame = textFrame;
+        textPlaces[place] = key;
+
+        TextLayout *layout = it->second.layout;
+        layout->SetText(string);
+        layout->Draw((float)x, (float)y, color);
         return 0;
     }
 
@@ -1459,6 +1661,65 @@ namespace nEngine
         return 0;
     }
 
+    static int LoadGraphAsync(lua_State *L)
+    {
+        int top = lua_gettop(L);
+        if (top < 2 || top > 3)
+        {
+            return luaL_error(L, "loadGraphAsync function requires 2 or 3 arguments (KEY, PATH, [CALLBACK])");
+        }
+        const char *key = luaL_checkstring(L, 1);
+        const char *path = luaL_checkstring(L, 2);
+        int callback = LUA_NOREF;
+        if (top == 3 && !lua_isnil(L, 3))
+        {
+            luaL_checktype(L, 3, LUA_TFUNCTION);
+            lua_pushvalue(L, 3);
+            callback = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+
+        Graph *graph = Assets::Instance().loadGraphAsync(key, path, callback);
+        lua_pushboolean(L, graph != nullptr);
+        return 1;
+    }
+
+    static int PendingGraphs(lua_State *L)
+    {
+        lua_pushinteger(L, Assets::Instance().pendingGraphs());
+        return 1;
+    }
+
+    static int SetStreamBudget(lua_State *L)
+    {
+        double ms = luaL_checknumber(L, 1);
+        Assets::Instance().streamBudget = ms / 1000.0;
+        return 0;
+    }
+
+    static int SetTextureBudget(lua_State *L)
+    {
+        double mb = luaL_checknumber(L, 1);
+        Assets::Instance().setTextureBudget((long long)(mb * 1024.0 * 1024.0));
+        return 0;
+    }
+
+    static int CacheStats(lua_State *L)
+    {
+        const Assets &assets = Assets::Instance();
+        lua_newtable(L);
+        lua_pushinteger(L, assets.cacheHits);
+        lua_setfield(L, -2, "hits");
+        lua_pushinteger(L, assets.cacheMisses);
+        lua_setfield(L, -2, "misses");
+        lua_pushinteger(L, assets.cacheEvictions);
+        lua_setfield(L, -2, "evictions");
+        lua_pushinteger(L, assets.textureBytes);
+        lua_setfield(L, -2, "bytes");
+        lua_pushinteger(L, assets.textureBudget);
+        lua_setfield(L, -2, "budget");
+        return 1;
+    }
+
     static int HasGraph(lua_State *L)
     {
         if (lua_gettop(L) != 1)
@@ -1473,6 +1734,48 @@ namespace nEngine
         return 1;
     }
 
+    static int AddClip(lua_State *L)
+    {
+        if (lua_gettop(L) != 6)
+        {
+            return luaL_error(L, "addClip function requires 6 arguments (NAME, GRAPH, ROWS, COLUMNS, COUNT, FPS)");
+        }
+        const char *name = luaL_checkstring(L, 1);
+        const char *graph = luaL_checkstring(L, 2);
+        int rows = luaL_checkinteger(L, 3);
+        int columns = luaL_checkinteger(L, 4);
+        int count = luaL_checkinteger(L, 5);
+        float fps = luaL_checknumber(L, 6);
+
+        lua_pushboolean(L, Assets::Instance().addClip(name, graph, rows, columns, count, fps) != nullptr);
+        return 1;
+    }
+
+    static int LoadClips(lua_State *L)
+    {
+        if (lua_gettop(L) < 1)
+        {
+            return luaL_error(L, "loadClips function requires 1/2 arguments (PATH, [FPS])");
+        }
+        const char *path = luaL_checkstring(L, 1);
+        float fps = 12;
+        if (lua_gettop(L) >= 2)
+            fps = luaL_checknumber(L, 2);
+
+        lua_pushinteger(L, Assets::Instance().loadClips(path, fps));
+        return 1;
+    }
+
+    static int HasClip(lua_State *L)
+    {
+        if (lua_gettop(L) != 1)
+        {
+            return luaL_error(L, "hasClip function requires 1 argument (NAME)");
+        }
+        lua_pushboolean(L, Assets::Instance().hasClip(luaL_checkstring(L, 1)));
+        return 1;
+    }
+
     void RegisterAssets(lua_State *L)
     {
 
@@ -1480,10 +1783,569 @@ namespace nEngine
 
         LuaPushClassFuntion(L, "assets", "loadGraph", loadGraph);
         LuaPushClassFuntion(L, "assets", "hasGraph", HasGraph);
+        LuaPushClassFuntion(L, "assets", "loadGraphAsync", LoadGraphAsync);
+        LuaPushClassFuntion(L, "assets", "pendingGraphs", PendingGraphs);
+        LuaPushClassFuntion(L, "assets", "setStreamBudget", SetStreamBudget);
+        LuaPushClassFuntion(L, "assets", "setTextureBudget", SetTextureBudget);
+        LuaPushClassFuntion(L, "assets", "cacheStats", CacheStats);
+        LuaPushClassFuntion(L, "assets", "addClip", AddClip);
+        LuaPushClassFuntion(L, "assets", "loadClips", LoadClips);
+        LuaPushClassFuntion(L, "assets", "hasClip", HasClip);
     }
 
 }
 
+// drives the lua collector from the frame: the automatic collector is stopped and every
+// bit of work runs here, in the time left after update and render
+struct GCScheduler
+{
+    bool generational;
+    int pause;        // % of growth over the last cycle before a new one starts
+    int minorMul;     // % of growth before a minor collection in generational mode
+    int stepMul;      // collector speed relative to allocation
+    int stepSize;     // KB of work per LUA_GCSTEP
+    double maxSlice;  // seconds, upper bound per frame
+    double minSlice;  // seconds, lower bound once a cycle runs
+    bool requested;
+    bool running;     // an incremental cycle is in progress
+    bool switched;    // generational mode left for a requested cycle
+    int baseline;     // KB in use after the last finished cycle
+    int cycles;
+    double frameStart;
+    double frameTime; // seconds spent in the collector this frame
+
+    GCScheduler()
+    {
+        // incremental by default, only incremental cycles can be sliced over frames
+        generational = false;
+        pause = 200;
+        minorMul = 20;
+        stepMul = 100;
+        stepSize = 4;
+        maxSlice = 0.002;
+        minSlice = 0.0002;
+        requested = false;
+        running = false;
+        switched = false;
+        baseline = 0;
+        cycles = 0;
+        frameStart = 0;
+        frameTime = 0;
+    }
+
+    void Apply(lua_State *L)
+    {
+#if defined(LUA_GCGEN)
+        if (generational)
+            lua_gc(L, LUA_GCGEN, 0, 0);
+        else
+            lua_gc(L, LUA_GCINC, pause, stepMul, 0);
+#else
+        generational = false;
+        lua_gc(L, LUA_GCSETPAUSE, pause);
+        lua_gc(L, LUA_GCSETSTEPMUL, stepMul);
+#endif
+        // LUA_GCSTEP still runs while stopped, allocation alone never collects
+        lua_gc(L, LUA_GCSTOP, 0);
+        running = false;
+        switched = false;
+        baseline = lua_gc(L, LUA_GCCOUNT, 0);
+    }
+
+    void BeginFrame()
+    {
+        frameStart = GetTime();
+    }
+
+    void Step(lua_State *L, double frameBudget)
+    {
+        double start = GetTime();
+        frameTime = 0;
+        int used = lua_gc(L, LUA_GCCOUNT, 0);
+
+#if defined(LUA_GCGEN)
+        if (generational && !switched)
+        {
+            if (!requested)
+            {
+                // minor collections are short, one whenever the heap grew enough
+                if ((long)used * 100 < (long)baseline * (100 + minorMul))
+                    return;
+                lua_gc(L, LUA_GCSTEP, 0);
+                baseline = lua_gc(L, LUA_GCCOUNT, 0);
+                frameTime = GetTime() - start;
+                return;
+            }
+            // a requested cycle must reach old objects: run it incrementally, in slices
+            lua_gc(L, LUA_GCINC, pause, stepMul, 0);
+            switched = true;
+        }
+#endif
+
+        if (!requested && !running && (long)used * 100 < (long)baseline * pause)
+            return;
+
+        // keep a fifth of the frame for EndDrawing; nothing else collects, so a
+        // started cycle always gets at least minSlice
+        double slice = frameBudget * 0.8 - (start - frameStart);
+        if (slice > maxSlice)
+            slice = maxSlice;
+        if (slice < minSlice)
+            slice = minSlice;
+
+        running = true;
+        do
+        {
+            if (lua_gc(L, LUA_GCSTEP, stepSize))
+            {
+                requested = false;
+                running = false;
+                cycles++;
+#if defined(LUA_GCGEN)
+                // entering generational mode marks the heap once more
+                if (switched)
+                    lua_gc(L, LUA_GCGEN, 0, 0);
+#endif
+                switched = false;
+                baseline = lua_gc(L, LUA_GCCOUNT, 0);
+                break;
+            }
+        } while (GetTime() - start < slice);
+        frameTime = GetTime() - start;
+    }
+};
+
+static GCScheduler gcScheduler;
+
+namespace nGC
+{
+    static int SetMode(lua_State *L)
+    {
+        const char *mode = luaL_checkstring(L, 1);
+        if (strcmp(mode, "generational") == 0)
+            gcScheduler.generational = true;
+        else if (strcmp(mode, "incremental") == 0)
+            gcScheduler.generational = false;
+        else
+            return luaL_error(L, "[setMode] unknown mode %s (incremental, generational)", mode);
+        gcScheduler.Apply(L);
+        // false when this lua has no generational mode
+        lua_pushboolean(L, gcScheduler.generational == (strcmp(mode, "generational") == 0));
+        return 1;
+    }
+
+    static int SetPause(lua_State *L)
+    {
+        gcScheduler.pause = (int)luaL_checkinteger(L, 1);
+        gcScheduler.Apply(L);
+        return 0;
+    }
+
+    static int SetStepMul(lua_State *L)
+    {
+        gcScheduler.stepMul = (int)luaL_checkinteger(L, 1);
+        gcScheduler.Apply(L);
+        return 0;
+    }
+
+    static int SetBudget(lua_State *L)
+    {
+        gcScheduler.maxSlice = luaL_checknumber(L, 1) / 1000.0;
+        return 0;
+    }
+
+    static int Stats(lua_State *L)
+    {
+        lua_newtable(L);
+        lua_pushstring(L, gcScheduler.generational ? "generational" : "incremental");
+        lua_setfield(L, -2, "mode");
+        lua_pushnumber(L, gcScheduler.frameTime * 1000.0);
+        lua_setfield(L, -2, "frameMs");
+        lua_pushinteger(L, gcScheduler.cycles);
+        lua_setfield(L, -2, "cycles");
+        lua_pushinteger(L, lua_gc(L, LUA_GCCOUNT, 0));
+        lua_setfield(L, -2, "kb");
+        return 1;
+    }
+
+    void RegisterGC(lua_State *L)
+    {
+        LuaNewClass(L, "gc");
+        LuaPushClassFuntion(L, "gc", "setMode", SetMode);
+        LuaPushClassFuntion(L, "gc", "setPause", SetPause);
+        LuaPushClassFuntion(L, "gc", "setStepMul", SetStepMul);
+        LuaPushClassFuntion(L, "gc", "setBudget", SetBudget);
+        LuaPushClassFuntion(L, "gc", "stats", Stats);
+    }
+}
+
+namespace nProfiler
+{
+    static int Start(lua_State *L)
+    {
+        bool sampling = lua_toboolean(L, 1) != 0;
+        int interval = (int)luaL_optinteger(L, 2, 1000);
+        Profiler &profiler = Profiler::Instance();
+        if (Profiler::active)
+            profiler.Stop(L);
+        profiler.Start(L, sampling, interval);
+        return 0;
+    }
+
+    static int Stop(lua_State *L)
+    {
+        if (Profiler::active)
+            Profiler::Instance().Stop(L);
+        return 0;
+    }
+
+    static int Reset(lua_State *L)
+    {
+        (void)L;
+        Profiler::Instance().Reset();
+        return 0;
+    }
+
+    static int Dump(lua_State *L)
+    {
+        const char *fileName = luaL_optstring(L, 1, "profile.txt");
+        lua_pushboolean(L, Profiler::Instance().Dump(fileName));
+        return 1;
+    }
+
+    void RegisterProfiler(lua_State *L)
+    {
+        LuaNewClass(L, "profiler");
+        LuaPushClassFuntion(L, "profiler", "start", Start);
+        LuaPushClassFuntion(L, "profiler", "stop", Stop);
+        LuaPushClassFuntion(L, "profiler", "reset", Reset);
+        LuaPushClassFuntion(L, "profiler", "dump", Dump);
+    }
+}
+
+namespace nCoroutine
+{
+    // startCoroutine([object,] fn, ...): with an object it is cancelled when the object goes
+    static int StartCoroutine(lua_State *L)
+    {
+        GameObject *owner = nullptr;
+        int first = 1;
+        if (lua_isuserdata(L, 1))
+        {
+            owner = GameObject::FromLua(L, 1);
+            if (owner == nullptr)
+            {
+                return luaL_error(L, "[startCoroutine] gameObject is null");
+            }
+            first = 2;
+        }
+        luaL_checktype(L, first, LUA_TFUNCTION);
+        CoroutineScheduler::Instance().Start(L, lua_gettop(L) - first, owner);
+        return 0;
+    }
+
+    static int Wait(lua_State *L)
+    {
+        double seconds = luaL_checknumber(L, 1);
+        if (!CoroutineScheduler::Instance().WaitTime(L, seconds))
+            return luaL_error(L, "[wait] only inside a coroutine started by the engine");
+        return lua_yield(L, 0);
+    }
+
+    static int WaitFrames(lua_State *L)
+    {
+        int count = (int)luaL_optinteger(L, 1, 1);
+        if (!CoroutineScheduler::Instance().WaitFrames(L, count))
+            return luaL_error(L, "[waitFrames] only inside a coroutine started by the engine");
+        return lua_yield(L, 0);
+    }
+
+    // fn is called once per frame until it returns true
+    static int WaitUntil(lua_State *L)
+    {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+        lua_pushvalue(L, 1);
+        int predicate = luaL_ref(L, LUA_REGISTRYINDEX);
+        if (!CoroutineScheduler::Instance().WaitUntil(L, predicate))
+        {
+            luaL_unref(L, LUA_REGISTRYINDEX, predicate);
+            return luaL_error(L, "[waitUntil] only inside a coroutine started by the engine");
+        }
+        return lua_yield(L, 0);
+    }
+
+    static int WaitSignal(lua_State *L)
+    {
+        const char *name = luaL_checkstring(L, 1);
+        if (!CoroutineScheduler::Instance().WaitSignal(L, name))
+            return luaL_error(L, "[waitSignal] only inside a coroutine started by the engine");
+        return lua_yield(L, 0);
+    }
+
+    static int Signal(lua_State *L)
+    {
+        CoroutineScheduler::Instance().Signal(luaL_checkstring(L, 1));
+        return 0;
+    }
+
+    void RegisterCoroutine(lua_State *L)
+    {
+        LuaPushFunction(L, "startCoroutine", StartCoroutine);
+        LuaPushFunction(L, "wait", Wait);
+        LuaPushFunction(L, "waitFrames", WaitFrames);
+        LuaPushFunction(L, "waitUntil", WaitUntil);
+        LuaPushFunction(L, "waitSignal", WaitSignal);
+        LuaPushFunction(L, "signal", Signal);
+    }
+}
+
+namespace nTimer
+{
+    // with an object first the timer is cancelled when the object goes, like startCoroutine
+    static GameObject *Owner(lua_State *L, const char *name, int *first)
+    {
+        *first = 1;
+        if (!lua_isuserdata(L, 1))
+            return nullptr;
+        GameObject *owner = GameObject::FromLua(L, 1);
+        if (owner == nullptr)
+            luaL_error(L, "[%s] gameObject is null", name);
+        *first = 2;
+        return owner;
+    }
+
+    // timer.after([object,] seconds, fn) -> id, fn(id) runs once
+    static int After(lua_State *L)
+    {
+        int first = 1;
+        GameObject *owner = Owner(L, "after", &first);
+        double delay = luaL_checknumber(L, first);
+        luaL_checktype(L, first + 1, LUA_TFUNCTION);
+        lua_settop(L, first + 1);
+        lua_pushinteger(L, TimerWheel::Instance().Add(L, delay, 0, owner));
+        return 1;
+    }
+
+    // timer.every([object,] seconds, fn [, delay]) -> id, fn(id) runs until cancelled
+    static int Every(lua_State *L)
+    {
+        int first = 1;
+        GameObject *owner = Owner(L, "every", &first);
+        double period = luaL_checknumber(L, first);
+        luaL_checktype(L, first + 1, LUA_TFUNCTION);
+        double delay = luaL_optnumber(L, first + 2, period);
+        if (period <= 0)
+            return luaL_error(L, "[every] period must be greater than 0");
+        lua_pushvalue(L, first + 1);
+        lua_pushinteger(L, TimerWheel::Instance().Add(L, delay, period, owner));
+        return 1;
+    }
+
+    static int Cancel(lua_State *L)
+    {
+        lua_pushboolean(L, TimerWheel::Instance().Cancel(luaL_checkinteger(L, 1)));
+        return 1;
+    }
+
+    static int Count(lua_State *L)
+    {
+        lua_pushinteger(L, TimerWheel::Instance().Count());
+        return 1;
+    }
+
+    void RegisterTimer(lua_State *L)
+    {
+        LuaNewClass(L, "timer");
+        LuaPushClassFuntion(L, "timer", "after", After);
+        LuaPushClassFuntion(L, "timer", "every", Every);
+        LuaPushClassFuntion(L, "timer", "cancel", Cancel);
+        LuaPushClassFuntion(L, "timer", "count", Count);
+    }
+}
+
+namespace nBus
+{
+    // bus.publish(channel, payload) from scripts without an object
+    static int Publish(lua_State *L)
+    {
+        const char *channel = luaL_checkstring(L, 1);
+        lua_settop(L, 2);
+        MessageBus::Instance().Publish(L, 2, nullptr, channel);
+        return 0;
+    }
+
+    static int Subscribers(lua_State *L)
+    {
+        lua_pushinteger(L, MessageBus::Instance().Subscribers(luaL_checkstring(L, 1)));
+        return 1;
+    }
+
+    void RegisterBus(lua_State *L)
+    {
+        LuaNewClass(L, "bus");
+        LuaPushClassFuntion(L, "bus", "publish", Publish);
+        LuaPushClassFuntion(L, "bus", "subscribers", Subscribers);
+    }
+}
+
+namespace nWorkers
+{
+    // workers.start([count]) before the isolated objects are created, they stay where they were made
+    static int Start(lua_State *L)
+    {
+        int count = (int)luaL_optinteger(L, 1, 0);
+        lua_pushboolean(L, ScriptWorkers::Instance().Start(count));
+        return 1;
+    }
+
+    static int Count(lua_State *L)
+    {
+        lua_pushinteger(L, ScriptWorkers::Instance().Count());
+        return 1;
+    }
+
+    // workers.collect(): full collection in every worker state, their heaps are not the caller's
+    static int Collect(lua_State *L)
+    {
+        (void)L;
+        ScriptWorkers &workers = ScriptWorkers::Instance();
+        for (int i = 0; i < workers.Count(); i++)
+            lua_gc(workers.Get(i).state, LUA_GCCOLLECT, 0);
+        return 0;
+    }
+
+    // {{scripts=, ms=, kb=}, ...} one entry per worker, ms of its last update
+    static int Stats(lua_State *L)
+    {
+        ScriptWorkers &workers = ScriptWorkers::Instance();
+        lua_createtable(L, workers.Count(), 0);
+        for (int i = 0; i < workers.Count(); i++)
+        {
+            const ScriptWorkers::Worker &worker = workers.Get(i);
+            lua_createtable(L, 0, 3);
+            lua_pushinteger(L, worker.scripts);
+            lua_setfield(L, -2, "scripts");
+            lua_pushnumber(L, worker.time * 1000.0);
+            lua_setfield(L, -2, "ms");
+            lua_pushnumber(L, lua_gc(worker.state, LUA_GCCOUNT, 0) + lua_gc(worker.state, LUA_GCCOUNTB, 0) / 1024.0);
+            lua_setfield(L, -2, "kb");
+            lua_rawseti(L, -2, i + 1);
+        }
+        return 1;
+    }
+
+    void RegisterWorkers(lua_State *L)
+    {
+        LuaNewClass(L, "workers");
+        LuaPushClassFuntion(L, "workers", "start", Start);
+        LuaPushClassFuntion(L, "workers", "count", Count);
+        LuaPushClassFuntion(L, "workers", "stats", Stats);
+        LuaPushClassFuntion(L, "workers", "collect", Collect);
+    }
+}
+
+// every lua allocation goes through the pools, see BlockAllocator
+static BlockAllocator luaAllocator;
+static std::size_t nativeMemory = 0;
+
+static void *LuaAllocate(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    BlockAllocator *allocator = (BlockAllocator *)ud;
+    if (nsize == 0)
+    {
+        // ptr == nullptr means osize is a type tag, nothing to free
+        if (ptr != nullptr)
+            allocator->Free(ptr, osize);
+        return nullptr;
+    }
+    if (ptr == nullptr)
+        return allocator->Allocate(nsize);
+    return allocator->Reallocate(ptr, osize, nsize);
+}
+
+static int LuaPanic(lua_State *L)
+{
+    const char *msg = lua_tostring(L, -1);
+    Log(LOG_ERROR, "PANIC: unprotected error in call to Lua API (%s)", msg ? msg : "error object is not a string");
+    return 0;
+}
+
+namespace nMemory
+{
+    static int Stats(lua_State *L)
+    {
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)luaAllocator.live);
+        lua_setfield(L, -2, "live");
+        lua_pushinteger(L, (lua_Integer)luaAllocator.peak);
+        lua_setfield(L, -2, "peak");
+        lua_pushinteger(L, (lua_Integer)luaAllocator.large);
+        lua_setfield(L, -2, "large");
+        lua_pushinteger(L, (lua_Integer)(luaAllocator.pages * BlockAllocator::PageSize));
+        lua_setfield(L, -2, "pooled");
+        lua_pushinteger(L, (lua_Integer)luaAllocator.lastFrameBytes);
+        lua_setfield(L, -2, "frameBytes");
+        lua_pushinteger(L, (lua_Integer)luaAllocator.lastFrameCount);
+        lua_setfield(L, -2, "frameCount");
+        lua_pushinteger(L, (lua_Integer)nativeMemory);
+        lua_setfield(L, -2, "native");
+        return 1;
+    }
+
+    static int ResetPeak(lua_State *L)
+    {
+        (void)L;
+        luaAllocator.peak = luaAllocator.live;
+        return 0;
+    }
+
+    void RegisterMemory(lua_State *L)
+    {
+        LuaNewClass(L, "memory");
+        LuaPushClassFuntion(L, "memory", "stats", Stats);
+        LuaPushClassFuntion(L, "memory", "resetPeak", ResetPeak);
+    }
+}
+
+std::size_t GetAllocatedMemory()
+{
+    return luaAllocator.live + nativeMemory;
+}
+
+void addMemory(std::size_t size)
+{
+    nativeMemory += size;
+}
+
+void removeMemory(std::size_t size)
+{
+    nativeMemory -= size;
+}
+
+std::size_t GetLuaMemory(std::size_t *peak)
+{
+    if (peak != nullptr)
+        *peak = luaAllocator.peak;
+    return luaAllocator.live;
+}
+
+std::size_t GetLuaFrameAllocations(std::size_t *count)
+{
+    if (count != nullptr)
+        *count = luaAllocator.lastFrameCount;
+    return luaAllocator.lastFrameBytes;
+}
+
+double GetGCFrameTime()
+{
+    return gcScheduler.frameTime;
+}
+
+bool IsGCGenerational()
+{
+    return gcScheduler.generational;
+}
+
 double getLuaMemoryUsage()
 {
     lua_State *L = getState();
@@ -1498,12 +2360,21 @@ lua_State *L;
 
 struct MainScript
 {
+    enum Callback
+    {
+        CallOnCreate,
+        CallOnClose,
+        CallRender,
+        CallUpdate,
+        CallbackCount
+    };
 
     std::string path;
     bool isLoad;
     bool panic;
     long timeLoad;
-    std::unordered_map<std::string, int> luaFunctions;
+    int callbacks[CallbackCount];
+    unsigned int callbackMask;
 
     MainScript()
     {
@@ -1511,20 +2382,22 @@ struct MainScript
         isLoad = false;
         panic = false;
         timeLoad = 0;
+        callbackMask = 0;
+        for (int i = 0; i < CallbackCount; i++)
+            callbacks[i] = LUA_NOREF;
     }
-    bool isFunctionRegistered(const std::string &functionName)
+    bool isFunctionRegistered(Callback id) const
     {
-
-        auto it = luaFunctions.find(functionName);
-        return it != luaFunctions.end();
+        return (callbackMask & (1u << id)) != 0;
     }
 
-    void registerFunction(const char *functionName)
+    void registerFunction(Callback id, const char *functionName)
     {
         lua_getglobal(L, functionName);
         if (lua_isfunction(L, -1))
         {
-            luaFunctions[functionName] = luaL_ref(L, LUA_REGISTRYINDEX);
+            callbacks[id] = luaL_ref(L, LUA_REGISTRYINDEX);
+            callbackMask |= 1u << id;
         }
         else
         {
@@ -1533,37 +2406,43 @@ struct MainScript
     }
     void LuaBind()
     {
-        luaFunctions.clear();
-        registerFunction("OnCreate");
-        registerFunction("OnClose");
-        registerFunction("render");
-        registerFunction("update");
+        for (int i = 0; i < CallbackCount; i++)
+        {
+            if (callbacks[i] != LUA_NOREF)
+                luaL_unref(L, LUA_REGISTRYINDEX, callbacks[i]);
+            callbacks[i] = LUA_NOREF;
+        }
+        callbackMask = 0;
+        registerFunction(CallOnCreate, "OnCreate");
+        registerFunction(CallOnClose, "OnClose");
+        registerFunction(CallRender, "render");
+        registerFunction(CallUpdate, "update");
     }
     void Load()
     {
 
         isLoad = false;
-        if (FileExists("main.lua"))
+        if (VirtualFS::Instance().Exists("main.lua"))
         {
             this->path = "main.lua";
             Log(LOG_INFO, "Loading main.lua");
             isLoad = true;
         }
-        else if (FileExists("scripts/main.lua"))
+        else if (VirtualFS::Instance().Exists("scripts/main.lua"))
         {
 
             this->path = "scripts/main.lua";
             isLoad = true;
             Log(LOG_INFO, "Loading scripts/main.lua");
         }
-        else if (FileExists("assets/main.lua"))
+        else if (VirtualFS::Instance().Exists("assets/main.lua"))
         {
 
             this->path = "assets/main.lua";
             isLoad = true;
             Log(LOG_INFO, "Loading assets/main.lua");
         }
-        else if (FileExists("assets/scripts/main.lua"))
+        else if (VirtualFS::Instance().Exists("assets/scripts/main.lua"))
         {
 
             this->path = "assets/scripts/main.lua";
@@ -1579,21 +2458,15 @@ struct MainScript
 
         timeLoad = GetFileModTime(this->path.c_str());
 
-        char *data = LoadFileText(this->path.c_str());
-        size_t size = strlen(data);
-
-        if (luaL_loadbufferx(L, data, size, this->path.c_str(), nullptr) != LUA_OK)
+        if (ScriptCache::Instance().Load(L, this->path.c_str()) != LUA_OK)
         {
             const char *errMsg = lua_tostring(L, -1);
             Log(LOG_ERROR, "Failed to load script %s : %s ", this->path.c_str(), errMsg);
             lua_pop(L, 1);
-            free(data);
             panic = true;
             return;
         }
 
-        free(data);
-
         if (lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK)
         {
             const char *errMsg = lua_tostring(L, -1);
@@ -1614,13 +2487,12 @@ struct MainScript
             return;
         }
 
-        if (!isFunctionRegistered("update"))
+        if (!isFunctionRegistered(CallUpdate))
         {
             return;
         }
 
-        int updateRef = luaFunctions["update"];
-        lua_rawgeti(L, LUA_REGISTRYINDEX, updateRef);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callbacks[CallUpdate]);
         lua_pushnumber(L, dt);
 
         if (lua_pcall(L, 1, 0, 0) != LUA_OK)
@@ -1639,13 +2511,12 @@ struct MainScript
             return;
         }
 
-        if (!isFunctionRegistered("render"))
+        if (!isFunctionRegistered(CallRender))
         {
             return;
         }
 
-        int updateRef = luaFunctions["render"];
-        lua_rawgeti(L, LUA_REGISTRYINDEX, updateRef);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callbacks[CallRender]);
         if (lua_pcall(L, 0, 0, 0) != LUA_OK)
         {
             const char *errMsg = lua_tostring(L, -1);
@@ -1663,13 +2534,12 @@ struct MainScript
             return;
         }
 
-        if (!isFunctionRegistered("OnCreate"))
+        if (!isFunctionRegistered(CallOnCreate))
         {
             return;
         }
 
-        int updateRef = luaFunctions["OnCreate"];
-        lua_rawgeti(L, LUA_REGISTRYINDEX, updateRef);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callbacks[CallOnCreate]);
         if (lua_pcall(L, 0, 0, 0) != LUA_OK)
         {
             const char *errMsg = lua_tostring(L, -1);
@@ -1686,13 +2556,12 @@ struct MainScript
             return;
         }
 
-        if (!isFunctionRegistered("OnClose"))
+        if (!isFunctionRegistered(CallOnClose))
         {
             return;
         }
 
-        int updateRef = luaFunctions["OnClose"];
-        lua_rawgeti(L, LUA_REGISTRYINDEX, updateRef);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callbacks[CallOnClose]);
         if (lua_pcall(L, 0, 0, 0) != LUA_OK)
         {
             const char *errMsg = lua_tostring(L, -1);
@@ -1719,23 +2588,34 @@ void FreeEngine()
 {
     mainScript.Close();
     scene.ClearAndFree();
+    nCanvas::ClearTextCache();
+    Assets::Instance().stopStreaming();
     Assets::Instance().clear();
+    CoroutineScheduler::Instance().Clear(L);
+    TimerWheel::Instance().Clear(L);
+    MessageBus::Instance().Clear(L);
+    ScriptModule::Clear(L);
+    ScriptWorkers::Instance().Stop();
+    FileWatcher::Instance().Close();
 }
 
 void EngineRender()
 {
+    luaAllocator.BeginFrame();
+    gcScheduler.BeginFrame();
+    nCanvas::BeginFrame();
     mainScript.Update(GetFrameTime());
     scene.Update();
 
     mainScript.Render();
     scene.Render();
+    gcScheduler.Step(L, scene.fps > 0 ? 1.0 / scene.fps : 1.0 / 60.0);
 }
 
+// finishes a cycle over the next frames, see GCScheduler
 void Collect()
 {
-    lua_State *L = getState();
-    Log(LOG_INFO, "Collecting garbage");
-    lua_gc(L, LUA_GCCOLLECT, 0);
+    gcScheduler.requested = true;
 }
 
 // lua parte
@@ -1747,8 +2627,14 @@ lua_State *getState()
 
 void LoadLua()
 {
-    L = luaL_newstate();
+    // shipped builds mount the pack, anything not packed is still read from loose files
+    if (FileExists("assets.pak"))
+        AssetPack::Instance().Open("assets.pak");
+
+    L = lua_newstate(LuaAllocate, &luaAllocator);
+    lua_atpanic(L, LuaPanic);
     luaL_openlibs(L);
+    gcScheduler.Apply(L);
 
     nCanvas::RegisterCanvas(L);
     nInput::RegisterInput(L);
@@ -1756,6 +2642,13 @@ void LoadLua()
     nUtils::RegisterUtils(L);
     nScene::RegisterScene(L);
     nWindow::RegisterWindow(L);
+    nGC::RegisterGC(L);
+    nMemory::RegisterMemory(L);
+    nProfiler::RegisterProfiler(L);
+    nWorkers::RegisterWorkers(L);
+    nCoroutine::RegisterCoroutine(L);
+    nTimer::RegisterTimer(L);
+    nBus::RegisterBus(L);
 
     // LuaPushFunction(L,"cfibonacci", l_fibonacci);
     // LuaPushFunction(L,"cfactorial", l_factorial);
@@ -1773,10 +2666,48 @@ void LoadLua()
     mainScript.Load();
 }
 
+// a state for ScriptWorkers: input, utils and require, the rest belongs to the main thread;
+// default allocator, the pools are not thread safe
+lua_State *NewWorkerState()
+{
+    lua_State *state = luaL_newstate();
+    lua_atpanic(state, LuaPanic);
+    luaL_openlibs(state);
+    nInput::RegisterInput(state);
+    nUtils::RegisterUtils(state);
+
+#if defined(PLATFORM_ANDROID)
+    luaL_dostring(state, "package.path = package.path .. ';?.lua;/sdcard/lua?.lua;/sdcard/lua/assets/?.lua'");
+#endif
+
+#if defined(PLATFORM_DESKTOP)
+    luaL_dostring(state, "package.path = package.path .. ';assets/scripts/?.lua;assets/scripts/utils/?.lua'");
+#endif
+
+    lua_newtable(state);
+    lua_setglobal(state, "script_refs");
+
+    // the sizes scripts read, kept in sync by Scene::Init and SetWorld
+    static const char *sizes[] = {"WindowWidth", "WindowHeight", "WorldWidth", "WorldHeight"};
+    for (const char *name : sizes)
+    {
+        lua_getglobal(L, name);
+        lua_Integer value = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        lua_pushinteger(state, value);
+        lua_setglobal(state, name);
+    }
+    return state;
+}
+
 void CloseLua()
 {
+    if (Profiler::active)
+        Profiler::Instance().Stop(L);
     FreeEngine();
     lua_close(L);
+    luaAllocator.Release();
+    AssetPack::Instance().Close();
 }
 
 void PrintLuaStack(lua_State *L)
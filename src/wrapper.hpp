@@ -21,10 +21,15 @@ void EngineRender();
 
 double getLuaMemoryUsage();
 void Collect();
+double GetGCFrameTime();
+bool IsGCGenerational();
 lua_State *getState();
+lua_State *NewWorkerState();
 std::size_t GetAllocatedMemory();
 void addMemory(std::size_t size);
 void removeMemory(std::size_t size);
+std::size_t GetLuaMemory(std::size_t *peak);
+std::size_t GetLuaFrameAllocations(std::size_t *count);
 void PrintLuaStack(lua_State *L);
 void PrintLuaTable(lua_State *L);
 void PrintTopValue(lua_State *L);
\ No newline at end of file
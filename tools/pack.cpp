@@ -0,0 +1,194 @@
+// builds the asset pack read by AssetPack (src/Utils.hpp)
+//
+//   pack [-rgba] [-bytecode] <dir> <out.pak>
+//
+//   -rgba      store images as decoded RGBA8 pixels, uploaded without decoding
+//   -bytecode  store lua scripts precompiled with lua_dump
+//
+// entries are named by their path as given, so "pack assets assets.pak" stores
+// "assets/images/x.png" exactly as the engine resolves it
+
+#include "Utils.hpp"
+#include <lua.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+static int DumpWriter(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    (void)L;
+    std::vector<unsigned char> *out = (std::vector<unsigned char> *)ud;
+    const unsigned char *bytes = (const unsigned char *)p;
+    out->insert(out->end(), bytes, bytes + sz);
+    return 0;
+}
+
+static bool CompileScript(lua_State *L, const char *fileName, std::vector<unsigned char> &out)
+{
+    if (luaL_loadfile(L, fileName) != LUA_OK)
+    {
+        Log(LOG_WARNING, "%s stored as text: %s", fileName, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+    out.clear();
+    lua_dump(L, DumpWriter, &out, 0);
+    lua_pop(L, 1);
+    return true;
+}
+
+static void WritePadding(FILE *file, unsigned long long &offset)
+{
+    static const unsigned char zero[AssetPack::Alignment] = {0};
+    unsigned long long pad = (AssetPack::Alignment - (offset % AssetPack::Alignment)) % AssetPack::Alignment;
+    fwrite(zero, 1, (size_t)pad, file);
+    offset += pad;
+}
+
+int main(int argc, char **argv)
+{
+    bool rgba = false;
+    bool bytecode = false;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-rgba") == 0)
+            rgba = true;
+        else if (strcmp(argv[i], "-bytecode") == 0)
+            bytecode = true;
+        else
+            args.push_back(argv[i]);
+    }
+    if (args.size() != 2)
+    {
+        printf("usage: pack [-rgba] [-bytecode] <dir> <out.pak>\n");
+        return 1;
+    }
+    const std::string &dir = args[0];
+    const std::string &output = args[1];
+
+    if (!DirectoryExists(dir.c_str()))
+    {
+        Log(LOG_ERROR, "Directory %s not found", dir.c_str());
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    FILE *file = fopen(output.c_str(), "wb");
+    if (file == nullptr)
+    {
+        Log(LOG_ERROR, "Can't create %s", output.c_str());
+        return 1;
+    }
+
+    lua_State *L = luaL_newstate();
+
+    AssetPack::Header header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, file);
+    unsigned long long offset = sizeof(header);
+
+    std::vector<AssetPack::Record> records;
+    std::string names;
+    std::vector<unsigned char> buffer;
+
+    FilePathList list = LoadDirectoryFilesEx(dir.c_str(), nullptr, true);
+    for (unsigned int i = 0; i < list.count; i++)
+    {
+        std::string name = list.paths[i];
+        std::replace(name.begin(), name.end(), '\\', '/');
+        while (name.compare(0, 2, "./") == 0)
+            name.erase(0, 2);
+        if (name == output || IsFileExtension(name.c_str(), ".pak"))
+            continue;
+
+        AssetPack::Record record;
+        memset(&record, 0, sizeof(record));
+        record.type = AssetPack::PackFile;
+
+        const unsigned char *data = nullptr;
+        unsigned long long size = 0;
+        unsigned char *fileData = nullptr;
+        Image image = {nullptr, 0, 0, 0, 0};
+
+        if (rgba && IsFileExtension(name.c_str(), ".png;.bmp;.tga;.jpg;.qoi"))
+        {
+            image = LoadImage(name.c_str());
+            if (image.data != nullptr)
+            {
+                ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+                record.type = AssetPack::PackImage;
+                record.width = (unsigned int)image.width;
+                record.height = (unsigned int)image.height;
+                record.format = (unsigned int)image.format;
+                data = (const unsigned char *)image.data;
+                size = (unsigned long long)image.width * image.height * 4;
+            }
+        }
+        else if (bytecode && IsFileExtension(name.c_str(), ".lua") && CompileScript(L, name.c_str(), buffer))
+        {
+            record.type = AssetPack::PackBytecode;
+            data = buffer.data();
+            size = buffer.size();
+        }
+
+        if (data == nullptr)
+        {
+            unsigned int bytesRead = 0;
+            fileData = LoadFileData(name.c_str(), &bytesRead);
+            if (fileData == nullptr && GetFileLength(name.c_str()) > 0)
+            {
+                Log(LOG_WARNING, "Skip %s", name.c_str());
+                continue;
+            }
+            data = fileData;
+            size = bytesRead;
+        }
+
+        WritePadding(file, offset);
+        record.offset = offset;
+        record.size = size;
+        if (size > 0)
+            fwrite(data, 1, (size_t)size, file);
+        fputc(0, file); // lets text be used in place
+        offset += size + 1;
+
+        record.nameOffset = (unsigned int)names.size();
+        record.nameLength = (unsigned int)name.size();
+        names += name;
+        records.push_back(record);
+
+        if (fileData != nullptr)
+            UnloadFileData(fileData);
+        if (image.data != nullptr)
+            UnloadImage(image);
+
+        const char *types[] = {"file", "rgba", "bytecode"};
+        printf("%-10s %10llu  %s\n", types[record.type], size, name.c_str());
+    }
+    UnloadDirectoryFiles(list);
+    lua_close(L);
+
+    WritePadding(file, offset);
+    header.indexOffset = offset;
+    if (!records.empty())
+        fwrite(records.data(), sizeof(AssetPack::Record), records.size(), file);
+    offset += records.size() * sizeof(AssetPack::Record);
+    header.namesOffset = offset;
+    fwrite(names.data(), 1, names.size(), file);
+    offset += names.size();
+
+    memcpy(header.magic, "UPAK", 4);
+    header.version = AssetPack::Version;
+    header.count = (unsigned int)records.size();
+    header.namesSize = (unsigned int)names.size();
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+
+    printf("%s: %d entries, %llu bytes\n", output.c_str(), (int)records.size(), offset);
+    return 0;
+}